@@ -0,0 +1,114 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * aligned.h
+ */
+
+#ifndef ALIGNED_H_
+#define ALIGNED_H_
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// Alignment (in bytes) used for all swarm storage. One cache line, which is
+// also wide enough for AVX-512 loads.
+static const size_t kSwarmAlignment = 64;
+
+// Round a number of elements up so that each row starts on an aligned boundary.
+template<class T>
+inline size_t alignedStride(const size_t n)
+{
+    const size_t perLine = kSwarmAlignment / sizeof(T);
+    return ((n + perLine - 1) / perLine) * perLine;
+}
+
+// Fixed size, zero initialized, cache line aligned array.
+template<class T>
+class AlignedBuffer
+{
+public:
+    AlignedBuffer() : mData(0), mSize(0) {}
+
+    explicit AlignedBuffer(const size_t n) : mData(0), mSize(0)
+    {
+        resize(n);
+    }
+
+    ~AlignedBuffer()
+    {
+        free(mData);
+    }
+
+    // Previous contents are discarded.
+    void resize(const size_t n)
+    {
+        if (n != mSize)
+        {
+            free(mData);
+            mData = 0;
+            mSize = 0;
+            if (n > 0)
+            {
+                void* p = 0;
+                if (posix_memalign(&p, kSwarmAlignment, n * sizeof(T)) != 0)
+                {
+                    throw std::bad_alloc();
+                }
+                mData = static_cast<T*>(p);
+                mSize = n;
+            }
+        }
+        if (mSize > 0)
+        {
+            memset(mData, 0, mSize * sizeof(T));
+        }
+    }
+
+    T* data()
+    {
+        return mData;
+    }
+    const T* data() const
+    {
+        return mData;
+    }
+
+    size_t size() const
+    {
+        return mSize;
+    }
+
+    T& operator[](const size_t i)
+    {
+        return mData[i];
+    }
+    const T& operator[](const size_t i) const
+    {
+        return mData[i];
+    }
+
+private:
+    // Prevent copying and assignment
+    AlignedBuffer(const AlignedBuffer&);
+    void operator=(const AlignedBuffer&);
+
+    T*      mData;
+    size_t  mSize;
+};
+
+#endif /* ALIGNED_H_ */
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * arena.cpp
+ */
+#include "arena.h"
+
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+namespace
+{
+
+// Blocks kept for reuse by later arenas
+const size_t kNumCachedBlocks = 8;
+
+struct CachedBlock
+{
+    char*   data;
+    size_t  capacity;
+};
+
+std::mutex gCacheMutex;
+CachedBlock gCache[kNumCachedBlocks];
+unsigned long gNumSystemAllocations = 0;
+
+// Smallest cached block of at least numBytes, or 0. A block more than
+// twice as large is left for an arena that needs it, rather than tied up
+// by a small one.
+char* takeCached(const size_t numBytes, size_t* capacity)
+{
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+    size_t best = kNumCachedBlocks;
+    for (size_t i = 0; i < kNumCachedBlocks; i++)
+    {
+        if (gCache[i].data && gCache[i].capacity >= numBytes && gCache[i].capacity <= 2 * numBytes &&
+            (best == kNumCachedBlocks || gCache[i].capacity < gCache[best].capacity))
+        {
+            best = i;
+        }
+    }
+    if (best == kNumCachedBlocks)
+    {
+        return 0;
+    }
+    char* data = gCache[best].data;
+    *capacity = gCache[best].capacity;
+    gCache[best].data = 0;
+    gCache[best].capacity = 0;
+    return data;
+}
+
+// Keep a block for later, replacing a smaller one when the cache is full
+void giveBack(char* data, const size_t capacity)
+{
+    std::unique_lock<std::mutex> lock(gCacheMutex);
+    size_t slot = 0;
+    for (size_t i = 0; i < kNumCachedBlocks; i++)
+    {
+        if (!gCache[i].data)
+        {
+            slot = i;
+            break;
+        }
+        if (gCache[i].capacity < gCache[slot].capacity)
+        {
+            slot = i;
+        }
+    }
+    char* evicted = 0;
+    if (!gCache[slot].data || gCache[slot].capacity < capacity)
+    {
+        evicted = gCache[slot].data;
+        gCache[slot].data = data;
+        gCache[slot].capacity = capacity;
+    }
+    else
+    {
+        evicted = data;
+    }
+    lock.unlock();
+    free(evicted);
+}
+
+}
+
+Arena::~Arena()
+{
+    if (mData)
+    {
+        giveBack(mData, mCapacity);
+    }
+}
+
+void Arena::reserve(const size_t numBytes)
+{
+    mUsed = 0;
+    if (numBytes <= mCapacity)
+    {
+        return;
+    }
+
+    if (mData)
+    {
+        giveBack(mData, mCapacity);
+        mData = 0;
+        mCapacity = 0;
+    }
+
+    size_t capacity = 0;
+    char* data = takeCached(numBytes, &capacity);
+    if (!data)
+    {
+        void* p = 0;
+        if (posix_memalign(&p, kSwarmAlignment, numBytes) != 0)
+        {
+            throw std::bad_alloc();
+        }
+        data = static_cast<char*>(p);
+        capacity = numBytes;
+
+        std::lock_guard<std::mutex> lock(gCacheMutex);
+        gNumSystemAllocations++;
+    }
+    mData = data;
+    mCapacity = capacity;
+}
+
+unsigned long Arena::getNumSystemAllocations()
+{
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+    return gNumSystemAllocations;
+}
+
+void Arena::releaseCache()
+{
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+    for (size_t i = 0; i < kNumCachedBlocks; i++)
+    {
+        free(gCache[i].data);
+        gCache[i].data = 0;
+        gCache[i].capacity = 0;
+    }
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * arena.h
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+
+#include "aligned.h"
+
+// One aligned block of memory that arrays are carved out of, so that all
+// the state of a swarm costs a single allocation. Blocks are handed out in
+// order and released all at once by reset() or reserve().
+//
+// A destroyed arena gives its block back to a small process-wide cache
+// instead of freeing it, and reserve() takes blocks from that cache first,
+// so consecutive runs of the same size don't allocate at all.
+class Arena
+{
+public:
+    Arena() : mData(0), mCapacity(0), mUsed(0) {}
+
+    ~Arena();
+
+    // Make room for at least numBytes. Previous blocks are discarded, and
+    // memory is only obtained when the current block is too small.
+    void reserve(const size_t numBytes);
+
+    // Discard the blocks handed out so far, keeping the memory
+    void reset()
+    {
+        mUsed = 0;
+    }
+
+    // Zeroed, aligned array of n elements. The arena must have room for it.
+    template<class T>
+    T* allocate(const size_t n)
+    {
+        const size_t size = blockSize<T>(n);
+        assert(mUsed + size <= mCapacity);
+        T* p = reinterpret_cast<T*>(mData + mUsed);
+        mUsed += size;
+        memset(p, 0, size);
+        return p;
+    }
+
+    // Bytes taken by allocate<T>(n), padding included
+    template<class T>
+    static size_t blockSize(const size_t n)
+    {
+        return alignedStride<char>(n * sizeof(T));
+    }
+
+    size_t capacity() const
+    {
+        return mCapacity;
+    }
+
+    size_t used() const
+    {
+        return mUsed;
+    }
+
+    // Number of blocks obtained from the system so far by all arenas
+    static unsigned long getNumSystemAllocations();
+
+    // Free the blocks kept by the process-wide cache
+    static void releaseCache();
+
+private:
+    // Prevent copying and assignment
+    Arena(const Arena&);
+    void operator=(const Arena&);
+
+    char*   mData;
+    size_t  mCapacity;
+    size_t  mUsed;
+};
+
+#endif /* ARENA_H_ */
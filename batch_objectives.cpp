@@ -0,0 +1,476 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * batch_objectives.cpp
+ */
+#include "batch_objectives.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define PSO_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+// Adding then subtracting 1.5 * 2^52 rounds to the nearest integer, which
+// is also left in the low bits of the sum.
+const double kRoundMagic = 6755399441055744.0;
+
+// exp(x) = 2^k * exp(r), with r = x - k*ln(2) in [-ln(2)/2, ln(2)/2]
+const double kExpMin = -708.0;  // Below this the result is flushed to zero
+const double kExpMax = 709.0;   // Above this it is infinite
+const double kLog2e = 1.4426950408889634;
+const double kLn2Hi = 6.93147180369123816490e-01;
+const double kLn2Lo = 1.90821492927058770002e-10;
+
+// cos(x) = +-cos(r) or +-sin(r), with r = x - q*pi/2 in [-pi/4, pi/4]
+const double kTwoOverPi = 0.63661977236758134308;
+const double kPiOver2Hi = 1.57079632673412561417e+00;
+const double kPiOver2Lo = 6.07710050650619224932e-11;
+
+// Taylor coefficients, highest degree first
+const double kExpCoefficients[] =
+{
+    1.0 / 6227020800.0, 1.0 / 479001600.0, 1.0 / 39916800.0, 1.0 / 3628800.0, 1.0 / 362880.0,
+    1.0 / 40320.0, 1.0 / 5040.0, 1.0 / 720.0, 1.0 / 120.0, 1.0 / 24.0, 1.0 / 6.0, 0.5, 1.0, 1.0
+};
+const size_t kNumExpCoefficients = sizeof(kExpCoefficients) / sizeof(double);
+
+// Of r^2, for cos(r) and sin(r)/r
+const double kCosCoefficients[] =
+{
+    1.0 / 20922789888000.0, -1.0 / 87178291200.0, 1.0 / 479001600.0, -1.0 / 3628800.0,
+    1.0 / 40320.0, -1.0 / 720.0, 1.0 / 24.0, -0.5, 1.0
+};
+const double kSinCoefficients[] =
+{
+    -1.0 / 1307674368000.0, 1.0 / 6227020800.0, -1.0 / 39916800.0, 1.0 / 362880.0,
+    -1.0 / 5040.0, 1.0 / 120.0, -1.0 / 6.0, 1.0
+};
+const size_t kNumCosCoefficients = sizeof(kCosCoefficients) / sizeof(double);
+const size_t kNumSinCoefficients = sizeof(kSinCoefficients) / sizeof(double);
+
+int64_t roundedBits(const double t)
+{
+    int64_t bits;
+    int64_t magic;
+    memcpy(&bits, &t, sizeof(bits));
+    memcpy(&magic, &kRoundMagic, sizeof(magic));
+    return bits - magic;
+}
+
+// Scalar versions, with the same algorithm as the vector ones
+double expScalar(const double x)
+{
+    if (!(x >= kExpMin))
+    {
+        return (x < kExpMin) ? 0.0 : x;
+    }
+    if (x > kExpMax)
+    {
+        return HUGE_VAL;
+    }
+    const double t = x * kLog2e + kRoundMagic;
+    const double k = t - kRoundMagic;
+    const double r = (x - k * kLn2Hi) - k * kLn2Lo;
+    double p = kExpCoefficients[0];
+    for (size_t c = 1; c < kNumExpCoefficients; c++)
+    {
+        p = p * r + kExpCoefficients[c];
+    }
+    const int64_t scaleBits = (roundedBits(t) + 1023) << 52;
+    double scale;
+    memcpy(&scale, &scaleBits, sizeof(scale));
+    return p * scale;
+}
+
+double cosScalar(const double x)
+{
+    const double t = x * kTwoOverPi + kRoundMagic;
+    const double q = t - kRoundMagic;
+    const double r = (x - q * kPiOver2Hi) - q * kPiOver2Lo;
+    const double r2 = r * r;
+    double c = kCosCoefficients[0];
+    for (size_t k = 1; k < kNumCosCoefficients; k++)
+    {
+        c = c * r2 + kCosCoefficients[k];
+    }
+    double s = kSinCoefficients[0];
+    for (size_t k = 1; k < kNumSinCoefficients; k++)
+    {
+        s = s * r2 + kSinCoefficients[k];
+    }
+    s *= r;
+
+    const int64_t quadrant = roundedBits(t);
+    const double value = (quadrant & 1) ? s : c;
+    return ((quadrant + 1) & 2) ? -value : value;
+}
+
+}
+
+#ifdef PSO_HAVE_X86
+
+// Everything up to the matching pop_options is compiled for AVX2 and FMA,
+// and only called when the CPU has both.
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+
+namespace
+{
+
+inline __m256d exp4(const __m256d x)
+{
+    const __m256d magic = _mm256_set1_pd(kRoundMagic);
+    const __m256d lo = _mm256_set1_pd(kExpMin);
+    const __m256d hi = _mm256_set1_pd(kExpMax);
+    const __m256d xc = _mm256_min_pd(_mm256_max_pd(x, lo), hi);
+
+    const __m256d t = _mm256_fmadd_pd(xc, _mm256_set1_pd(kLog2e), magic);
+    const __m256d k = _mm256_sub_pd(t, magic);
+    __m256d r = _mm256_fnmadd_pd(k, _mm256_set1_pd(kLn2Hi), xc);
+    r = _mm256_fnmadd_pd(k, _mm256_set1_pd(kLn2Lo), r);
+
+    __m256d p = _mm256_set1_pd(kExpCoefficients[0]);
+    for (size_t c = 1; c < kNumExpCoefficients; c++)
+    {
+        p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(kExpCoefficients[c]));
+    }
+
+    const __m256i ki = _mm256_sub_epi64(_mm256_castpd_si256(t), _mm256_castpd_si256(magic));
+    const __m256i scale = _mm256_slli_epi64(_mm256_add_epi64(ki, _mm256_set1_epi64x(1023)), 52);
+    __m256d result = _mm256_mul_pd(p, _mm256_castsi256_pd(scale));
+
+    result = _mm256_blendv_pd(result, _mm256_setzero_pd(), _mm256_cmp_pd(x, lo, _CMP_LT_OQ));
+    result = _mm256_blendv_pd(result, _mm256_set1_pd(HUGE_VAL), _mm256_cmp_pd(x, hi, _CMP_GT_OQ));
+    return _mm256_blendv_pd(result, x, _mm256_cmp_pd(x, x, _CMP_UNORD_Q));
+}
+
+inline __m256d cos4(const __m256d x)
+{
+    const __m256d magic = _mm256_set1_pd(kRoundMagic);
+    const __m256d t = _mm256_fmadd_pd(x, _mm256_set1_pd(kTwoOverPi), magic);
+    const __m256d q = _mm256_sub_pd(t, magic);
+    __m256d r = _mm256_fnmadd_pd(q, _mm256_set1_pd(kPiOver2Hi), x);
+    r = _mm256_fnmadd_pd(q, _mm256_set1_pd(kPiOver2Lo), r);
+    const __m256d r2 = _mm256_mul_pd(r, r);
+
+    __m256d c = _mm256_set1_pd(kCosCoefficients[0]);
+    for (size_t k = 1; k < kNumCosCoefficients; k++)
+    {
+        c = _mm256_fmadd_pd(c, r2, _mm256_set1_pd(kCosCoefficients[k]));
+    }
+    __m256d s = _mm256_set1_pd(kSinCoefficients[0]);
+    for (size_t k = 1; k < kNumSinCoefficients; k++)
+    {
+        s = _mm256_fmadd_pd(s, r2, _mm256_set1_pd(kSinCoefficients[k]));
+    }
+    s = _mm256_mul_pd(s, r);
+
+    const __m256i quadrant = _mm256_sub_epi64(_mm256_castpd_si256(t), _mm256_castpd_si256(magic));
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i odd = _mm256_cmpeq_epi64(_mm256_and_si256(quadrant, one), one);
+    const __m256d value = _mm256_blendv_pd(c, s, _mm256_castsi256_pd(odd));
+    const __m256i sign = _mm256_slli_epi64(_mm256_and_si256(_mm256_add_epi64(quadrant, one), _mm256_set1_epi64x(2)), 62);
+    return _mm256_xor_pd(value, _mm256_castsi256_pd(sign));
+}
+
+void vectorExpAVX2(const double* x, double* out, const size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        _mm256_storeu_pd(out + i, exp4(_mm256_loadu_pd(x + i)));
+    }
+    for (; i < n; i++)
+    {
+        out[i] = expScalar(x[i]);
+    }
+}
+
+void vectorCosAVX2(const double* x, double* out, const size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        _mm256_storeu_pd(out + i, cos4(_mm256_loadu_pd(x + i)));
+    }
+    for (; i < n; i++)
+    {
+        out[i] = cosScalar(x[i]);
+    }
+}
+
+// Per-dimension accumulators of the batch kernels. Each lane is one
+// particle; add() is called with the coordinates of dimension d, in order.
+struct SphereColumns
+{
+    __m256d sum;
+
+    SphereColumns() : sum(_mm256_setzero_pd()) {}
+
+    void add(const __m256d x, const size_t)
+    {
+        sum = _mm256_fmadd_pd(x, x, sum);
+    }
+
+    __m256d result(const size_t) const
+    {
+        return sum;
+    }
+};
+
+struct RastriginColumns
+{
+    __m256d sum;
+
+    RastriginColumns() : sum(_mm256_setzero_pd()) {}
+
+    // x^2 + 10 * (1 - cos(2 pi x))
+    void add(const __m256d x, const size_t)
+    {
+        const __m256d ten = _mm256_set1_pd(10.0);
+        const __m256d c = cos4(_mm256_mul_pd(_mm256_set1_pd(2.0 * M_PI), x));
+        sum = _mm256_add_pd(sum, _mm256_fmadd_pd(x, x, _mm256_fnmadd_pd(ten, c, ten)));
+    }
+
+    __m256d result(const size_t) const
+    {
+        return sum;
+    }
+};
+
+struct RosenbrockColumns
+{
+    __m256d sum;
+    __m256d previous;
+
+    RosenbrockColumns() : sum(_mm256_setzero_pd()), previous(_mm256_setzero_pd()) {}
+
+    void add(const __m256d x, const size_t d)
+    {
+        if (d > 0)
+        {
+            const __m256d a = _mm256_fnmadd_pd(previous, previous, x);
+            const __m256d b = _mm256_sub_pd(_mm256_set1_pd(1.0), previous);
+            sum = _mm256_fmadd_pd(_mm256_mul_pd(_mm256_set1_pd(100.0), a), a, _mm256_fmadd_pd(b, b, sum));
+        }
+        previous = x;
+    }
+
+    __m256d result(const size_t) const
+    {
+        return sum;
+    }
+};
+
+struct AckleyColumns
+{
+    __m256d sumSquares;
+    __m256d sumCos;
+
+    AckleyColumns() : sumSquares(_mm256_setzero_pd()), sumCos(_mm256_setzero_pd()) {}
+
+    void add(const __m256d x, const size_t)
+    {
+        sumSquares = _mm256_fmadd_pd(x, x, sumSquares);
+        sumCos = _mm256_add_pd(sumCos, cos4(_mm256_mul_pd(_mm256_set1_pd(2.0 * M_PI), x)));
+    }
+
+    __m256d result(const size_t n) const
+    {
+        const __m256d invN = _mm256_set1_pd(1.0 / n);
+        const __m256d a = exp4(_mm256_mul_pd(_mm256_set1_pd(-0.2), _mm256_sqrt_pd(_mm256_mul_pd(sumSquares, invN))));
+        const __m256d b = exp4(_mm256_mul_pd(sumCos, invN));
+        return _mm256_sub_pd(_mm256_fnmadd_pd(_mm256_set1_pd(20.0), a, _mm256_set1_pd(20.0 + M_E)), b);
+    }
+};
+
+// Four particles at a time. Blocks of four coordinates of four rows are
+// transposed so that each vector holds one dimension of the four particles.
+// Rows are aligned and padded to a multiple of four, so the loads never
+// leave a row.
+template<class Columns>
+void batchValuesAVX2(const Swarm& swarm, double* values)
+{
+    const size_t n = swarm.numDims();
+    assert(swarm.stride() % 4 == 0);
+    for (size_t i = 0; i < swarm.size(); i += 4)
+    {
+        // Past the end, repeat the last particle
+        const dim_t* rows[4];
+        for (size_t j = 0; j < 4; j++)
+        {
+            rows[j] = swarm.position(std::min(i + j, swarm.size() - 1));
+        }
+
+        Columns columns;
+        for (size_t d = 0; d < n; d += 4)
+        {
+            const __m256d a = _mm256_load_pd(rows[0] + d);
+            const __m256d b = _mm256_load_pd(rows[1] + d);
+            const __m256d c = _mm256_load_pd(rows[2] + d);
+            const __m256d e = _mm256_load_pd(rows[3] + d);
+            const __m256d ab0 = _mm256_unpacklo_pd(a, b);
+            const __m256d ab1 = _mm256_unpackhi_pd(a, b);
+            const __m256d ce0 = _mm256_unpacklo_pd(c, e);
+            const __m256d ce1 = _mm256_unpackhi_pd(c, e);
+            const __m256d x[4] =
+            {
+                _mm256_permute2f128_pd(ab0, ce0, 0x20), _mm256_permute2f128_pd(ab1, ce1, 0x20),
+                _mm256_permute2f128_pd(ab0, ce0, 0x31), _mm256_permute2f128_pd(ab1, ce1, 0x31)
+            };
+            for (size_t k = 0; k < 4 && d + k < n; k++)
+            {
+                columns.add(x[k], d + k);
+            }
+        }
+
+        double result[4];
+        _mm256_storeu_pd(result, columns.result(n));
+        for (size_t j = 0; j < 4 && i + j < swarm.size(); j++)
+        {
+            values[i + j] = result[j];
+        }
+    }
+}
+
+}
+
+#pragma GCC pop_options
+
+namespace
+{
+
+bool haveAVX2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+const bool kHaveAVX2 = haveAVX2();
+
+}
+
+#endif // PSO_HAVE_X86
+
+void vectorExp(const double* x, double* out, const size_t n)
+{
+#ifdef PSO_HAVE_X86
+    if (kHaveAVX2)
+    {
+        vectorExpAVX2(x, out, n);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < n; i++)
+    {
+        out[i] = expScalar(x[i]);
+    }
+}
+
+void vectorCos(const double* x, double* out, const size_t n)
+{
+#ifdef PSO_HAVE_X86
+    if (kHaveAVX2)
+    {
+        vectorCosAVX2(x, out, n);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < n; i++)
+    {
+        out[i] = cosScalar(x[i]);
+    }
+}
+
+#ifdef PSO_HAVE_X86
+#define PSO_BATCH_VALUES(Function, Columns)                 \
+    template<>                                              \
+    void batchValues<Function>(const Swarm& swarm, double* values) \
+    {                                                       \
+        if (kHaveAVX2 && swarm.size() > 0)                  \
+        {                                                   \
+            batchValuesAVX2<Columns>(swarm, values);        \
+            return;                                         \
+        }                                                   \
+        for (size_t i = 0; i < swarm.size(); i++)           \
+        {                                                   \
+            values[i] = Function::value(swarm.position(i), swarm.numDims()); \
+        }                                                   \
+    }
+#else
+#define PSO_BATCH_VALUES(Function, Columns)                 \
+    template<>                                              \
+    void batchValues<Function>(const Swarm& swarm, double* values) \
+    {                                                       \
+        for (size_t i = 0; i < swarm.size(); i++)           \
+        {                                                   \
+            values[i] = Function::value(swarm.position(i), swarm.numDims()); \
+        }                                                   \
+    }
+#endif
+
+PSO_BATCH_VALUES(Sphere, SphereColumns)
+PSO_BATCH_VALUES(Rastrigin, RastriginColumns)
+PSO_BATCH_VALUES(Rosenbrock, RosenbrockColumns)
+PSO_BATCH_VALUES(Ackley, AckleyColumns)
+
+#undef PSO_BATCH_VALUES
+
+GaussianLogLikelihood::GaussianLogLikelihood(const std::vector<double>& data, const double std)
+    : mNumData(data.size()), mMean(0.0), mSumSquares(0.0), mStd(std)
+{
+    // Welford's algorithm, which stays accurate when the data are far
+    // from zero
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        const double delta = data[i] - mMean;
+        mMean += delta / (i + 1.0);
+        mSumSquares += delta * (data[i] - mMean);
+    }
+}
+
+double GaussianLogLikelihood::value(const double mean, const double std) const
+{
+    // sum (x - mean)^2 = sumSquares + n * (dataMean - mean)^2
+    const double offset = mMean - mean;
+    const double squares = mSumSquares + mNumData * offset * offset;
+    return -0.5 * squares / (std * std) - mNumData * (log(std) + 0.5 * log(2.0 * M_PI));
+}
+
+void GaussianLogLikelihood::operator()(const Swarm& particleSet, std::vector<double>* particleFitnesses) const
+{
+    const bool fixedStd = (particleSet.numDims() < 2);
+    for (size_t i = 0; i < particleSet.size(); i++)
+    {
+        const dim_t* x = particleSet.position(i);
+        (*particleFitnesses)[i] = value(x[0], fixedStd ? mStd : x[1]);
+    }
+}
+
+double GaussianLogLikelihood::operator()(const Particle& p) const
+{
+    return value(p.getPosition()[0], (p.size() < 2) ? mStd : p.getPosition()[1]);
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * batch_objectives.h
+ */
+
+#ifndef BATCH_OBJECTIVES_H_
+#define BATCH_OBJECTIVES_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "dim.h"
+#include "objectives.h"
+#include "particle.h"
+#include "swarm.h"
+
+// Vectorized exp and cos of n values, for batch objectives. Polynomial
+// approximations within a few units in the last place of the libm results
+// (cos for |x| < 1e5), using AVX2 when the CPU has it.
+void vectorExp(const double* x, double* out, const size_t n);
+void vectorCos(const double* x, double* out, const size_t n);
+
+// Values of a function of objectives.h at every particle of a swarm. The
+// generic version calls Function::value once per particle. The
+// specializations for Sphere, Rastrigin, Rosenbrock and Ackley evaluate
+// four particles at a time with SIMD math, transposing blocks of the
+// position matrix so that each vector lane holds one particle.
+template<class Function>
+void batchValues(const Swarm& swarm, double* values)
+{
+    for (size_t i = 0; i < swarm.size(); i++)
+    {
+        values[i] = Function::value(swarm.position(i), swarm.numDims());
+    }
+}
+
+template<> void batchValues<Sphere>(const Swarm& swarm, double* values);
+template<> void batchValues<Rastrigin>(const Swarm& swarm, double* values);
+template<> void batchValues<Rosenbrock>(const Swarm& swarm, double* values);
+template<> void batchValues<Ackley>(const Swarm& swarm, double* values);
+
+// Like Objective, but evaluating the whole swarm with batchValues(). The
+// per-particle operator is the scalar one, so the two can differ by a few
+// units in the last place.
+template<class Function>
+class BatchObjective
+{
+public:
+    void operator()(const Swarm& particleSet, std::vector<double>* particleFitnesses) const
+    {
+        double* fitnesses = particleFitnesses->data();
+        batchValues<Function>(particleSet, fitnesses);
+        for (size_t i = 0; i < particleSet.size(); i++)
+        {
+            fitnesses[i] = -fitnesses[i];
+        }
+    }
+
+    double operator()(const Particle& p) const
+    {
+        return -Function::value(p.getPosition().data(), p.size());
+    }
+};
+
+// Log-likelihood of a data set under a Gaussian, from the sufficient
+// statistics of the data (count, mean and sum of squared deviations), so
+// each evaluation costs O(1) instead of O(data). The first coordinate of a
+// particle is the mean. The standard deviation is the second coordinate
+// when there is one, and the fixed value given to the constructor otherwise.
+class GaussianLogLikelihood
+{
+public:
+    GaussianLogLikelihood(const std::vector<double>& data, const double std);
+
+    double value(const double mean, const double std) const;
+
+    void operator()(const Swarm& particleSet, std::vector<double>* particleFitnesses) const;
+
+    double operator()(const Particle& p) const;
+
+    size_t getNumData() const
+    {
+        return mNumData;
+    }
+
+    double getDataMean() const
+    {
+        return mMean;
+    }
+
+private:
+    size_t  mNumData;
+    double  mMean;
+    double  mSumSquares;    // Sum of the squared deviations from mMean
+    double  mStd;
+};
+
+#endif /* BATCH_OBJECTIVES_H_ */
@@ -0,0 +1,249 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * bench_layout.cpp
+ *
+ * Compares the time per iteration of the Swarm (structure-of-arrays) storage
+ * against the original layout, where every particle owned its own vectors.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "dim.h"
+#include "particle.h"
+#include "rng.h"
+#include "swarm.h"
+
+namespace
+{
+
+const double kC1 = 2.0;
+const double kC2 = 2.0;
+const double kInertiaWeight = 0.7;
+
+// The particle as it was stored before Swarm existed: four heap vectors per
+// particle and a velocity/position update that builds new vectors.
+class LegacyParticle
+{
+public:
+    typedef std::vector<dim_t> dvector;
+
+    LegacyParticle(const dvector& pos, const prob_t fitness = -1.0 * std::numeric_limits<dim_t>::max())
+        : mPos(pos), mVel(pos.size()), mFitness(fitness), mPBestPos(pos), mPBestFitness(fitness)
+    {
+    }
+
+    const dvector& getPosition() const
+    {
+        return mPos;
+    }
+
+    dvector getPBestPosition() const
+    {
+        return mPBestPos;
+    }
+
+    double getPBestFitness() const
+    {
+        return mPBestFitness;
+    }
+
+    void updateFitness(const prob_t newFitness)
+    {
+        mFitness = newFitness;
+        if (newFitness > mPBestFitness)
+        {
+            mPBestFitness = newFitness;
+            mPBestPos = mPos;
+        }
+    }
+
+    void updatePosition(const LegacyParticle& GBest, const std::vector<Dim>& dim,
+                        const RandomNumberGenerator& rng)
+    {
+        dvector newVel;
+        dvector newPos;
+        for (unsigned int i = 0; i < mPos.size(); i++)
+        {
+            dim_t vel = kInertiaWeight * mVel[i];
+            vel += kC1 * rng.uniform() * (mPBestPos[i] - mPos[i]);
+            vel += kC2 * rng.uniform() * (GBest.getPosition()[i] - mPos[i]);
+            if (vel == 0.0)
+            {
+                vel = mVel[i] + 2.0 * rng.uniform();
+            }
+            const dim_t maxVel = 0.01*(dim[i].max() - dim[i].min());
+            if (fabs(vel) > maxVel)
+            {
+                vel = (vel < 0.0) ? -maxVel : maxVel;
+            }
+            dim_t pos = mPos[i] + vel;
+            if (pos < dim[i].min())
+            {
+                pos = dim[i].min();
+            }
+            else if (pos > dim[i].max())
+            {
+                pos = dim[i].max();
+            }
+            newVel.push_back(vel);
+            newPos.push_back(pos);
+        }
+        mPos = newPos;
+        mVel = newVel;
+    }
+
+    friend bool operator<(const LegacyParticle& p1, const LegacyParticle& p2)
+    {
+        return (p1.mPBestFitness < p2.mPBestFitness);
+    }
+
+private:
+    dvector mPos;
+    dvector mVel;
+    prob_t  mFitness;
+    dvector mPBestPos;
+    prob_t  mPBestFitness;
+};
+
+// Cheap objective so that the storage layout dominates the timings.
+template<class P>
+double sphere(const P& p)
+{
+    double sum = 0.0;
+    for (unsigned int d = 0; d < p.size(); d++)
+    {
+        sum += p.getPosition()[d] * p.getPosition()[d];
+    }
+    return -sum;
+}
+
+double benchLegacy(const unsigned int numParticles, const std::vector<Dim>& dims,
+                   const unsigned int numIterations)
+{
+    RandomNumberGenerator rng(0);
+    std::vector<LegacyParticle> particles;
+    for (unsigned int i = 0; i < numParticles; i++)
+    {
+        std::vector<dim_t> pos;
+        for (unsigned int d = 0; d < dims.size(); d++)
+        {
+            pos.push_back(rng.uniform(dims[d].min(), dims[d].max()));
+        }
+        particles.push_back(LegacyParticle(pos));
+    }
+    LegacyParticle gbest(particles[0]);
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned int it = 0; it < numIterations; it++)
+    {
+        for (unsigned int i = 0; i < particles.size(); i++)
+        {
+            double sum = 0.0;
+            const std::vector<dim_t>& pos = particles[i].getPosition();
+            for (unsigned int d = 0; d < pos.size(); d++)
+            {
+                sum += pos[d] * pos[d];
+            }
+            particles[i].updateFitness(-sum);
+        }
+        std::vector<LegacyParticle>::const_iterator best = std::max_element(particles.begin(), particles.end());
+        gbest = LegacyParticle(best->getPBestPosition(), best->getPBestFitness());
+        for (unsigned int i = 0; i < particles.size(); i++)
+        {
+            particles[i].updatePosition(gbest, dims, rng);
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / numIterations;
+}
+
+double benchSwarm(const unsigned int numParticles, const std::vector<Dim>& dims,
+                  const unsigned int numIterations)
+{
+    RandomNumberGenerator rng(0);
+    Swarm swarm(numParticles, dims.size());
+    for (unsigned int i = 0; i < numParticles; i++)
+    {
+        dim_t* pos = swarm.position(i);
+        for (unsigned int d = 0; d < dims.size(); d++)
+        {
+            pos[d] = rng.uniform(dims[d].min(), dims[d].max());
+        }
+        swarm.resetParticle(i);
+    }
+    Particle gbest = swarm.gbest();
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned int it = 0; it < numIterations; it++)
+    {
+        for (unsigned int i = 0; i < swarm.size(); i++)
+        {
+            const dim_t* pos = swarm.position(i);
+            double sum = 0.0;
+            for (unsigned int d = 0; d < dims.size(); d++)
+            {
+                sum += pos[d] * pos[d];
+            }
+            swarm[i].updateFitness(-sum);
+        }
+        swarm.setGBest(swarm.bestIndex());
+        for (unsigned int i = 0; i < swarm.size(); i++)
+        {
+            swarm[i].updatePosition(gbest, dims, kC1, kC2, rng, kInertiaWeight);
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / numIterations;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc != 4)
+    {
+        std::cout << "Error: Invalid arguments.\n";
+        std::cout << "Usage: " << argv[0] << " <num particles> <num dimensions> <num iterations>\n";
+        return -1;
+    }
+
+    const unsigned int numParticles = atoi( argv[1] );
+    const unsigned int numDims = atoi( argv[2] );
+    const unsigned int numIterations = atoi( argv[3] );
+    assert(numParticles > 0 && numDims > 0 && numIterations > 0);
+
+    std::vector<Dim> dims(numDims, Dim(-10, 10));
+
+    const double legacy = benchLegacy(numParticles, dims, numIterations);
+    const double swarm = benchSwarm(numParticles, dims, numIterations);
+
+    std::cout << "particles = " << numParticles << ", dimensions = " << numDims
+              << ", iterations = " << numIterations << "\n";
+    std::cout << "vector<Particle> layout: " << legacy * 1e3 << " ms/iteration\n";
+    std::cout << "Swarm layout:            " << swarm * 1e3 << " ms/iteration\n";
+    std::cout << "speedup:                 " << legacy / swarm << "x\n";
+
+    return 0;
+}
@@ -0,0 +1,451 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * bench_pso.cpp
+ *
+ * Throughput and solution quality of PSO on the standard benchmark
+ * functions, over a grid of dimensions and swarm sizes. Results are written
+ * as CSV or JSON so that runs of different versions can be compared.
+ * Each configuration can also be run with double and float coordinates,
+ * to compare the convergence and throughput of the two precisions.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "batch_objectives.h"
+#include "objectives.h"
+#include "pso.h"
+#include "swarm.h"
+#include "update_kernel.h"
+
+namespace
+{
+
+// Names of the topologies on the command line and in the results, by TopologyKind
+const char* const kTopologyNames[] = { "global", "ring", "vonneumann", "random" };
+const unsigned int kNumTopologies = 4;
+
+struct Options
+{
+    std::vector<std::string>    functions;
+    std::vector<unsigned int>   dims;
+    std::vector<unsigned int>   particles;
+    std::vector<std::string>    precisions; // Coordinate types, double and/or float
+    unsigned int                iterations;
+    unsigned int                repeats;
+    double                      target;
+    std::string                 format;
+    TopologyKind                topology;
+    bool                        batch;      // Evaluate with the vectorized batchValues()
+    std::string                 statsFile;  // Phase timings of every run, with -DPSO_INSTRUMENT
+    std::string                 traceFile;  // Chrome trace of the last run, with -DPSO_INSTRUMENT
+};
+
+struct Result
+{
+    std::string     function;
+    unsigned int    dims;
+    unsigned int    particles;
+    std::string     precision;
+    std::string     topology;
+    std::string     objective;          // scalar or batch
+    unsigned int    iterations;
+    double          seconds;            // Whole run
+    double          nsPerUpdate;        // Everything but evaluation, per particle-dimension
+    double          evalsPerSecond;
+    double          timeToTarget;       // Seconds, < 0 if the target wasn't reached
+    double          finalError;         // Best function value found (the minimum is 0)
+    PSOStats        stats;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+// Times the calls to the wrapped fitness function
+template<class Function>
+class TimedObjective
+{
+public:
+    explicit TimedObjective(const bool batch) : mBatch(batch), mSeconds(0.0) {}
+
+    void operator()(const Swarm& particleSet, std::vector<double>* particleFitnesses)
+    {
+        const Clock::time_point start = Clock::now();
+        if (mBatch)
+        {
+            mBatchObjective(particleSet, particleFitnesses);
+        }
+        else
+        {
+            mObjective(particleSet, particleFitnesses);
+        }
+        const std::chrono::duration<double> elapsed = Clock::now() - start;
+        mSeconds += elapsed.count();
+    }
+
+    // The batch kernels only take double coordinates
+    void operator()(const FloatSwarm& particleSet, std::vector<double>* particleFitnesses)
+    {
+        const Clock::time_point start = Clock::now();
+        mObjective(particleSet, particleFitnesses);
+        const std::chrono::duration<double> elapsed = Clock::now() - start;
+        mSeconds += elapsed.count();
+    }
+
+    double seconds() const
+    {
+        return mSeconds;
+    }
+
+private:
+    Objective<Function>         mObjective;
+    BatchObjective<Function>    mBatchObjective;
+    bool                        mBatch;
+    double                      mSeconds;
+};
+
+template<class Function, class Scalar>
+Result run(const unsigned int numDims, const unsigned int numParticles, const Options& options,
+           const gslseed_t seed)
+{
+    const std::vector<Dim> dims(numDims, Function::bounds());
+    TimedObjective<Function> ff(options.batch);
+    PSO<TimedObjective<Function>, kDynamicDims, Scalar> pso(numParticles, dims, seed, ff, options.iterations);
+    pso.setTopology(Topology(options.topology, options.topology == kTopologyRandom ? 3 : 2));
+    if (!options.traceFile.empty())
+    {
+        pso.setTraceCapacity(kNumPhases * options.iterations);
+    }
+
+    Result result;
+    result.function = Function::name();
+    result.dims = numDims;
+    result.particles = numParticles;
+    result.precision = (sizeof(Scalar) == sizeof(float)) ? "float" : "double";
+    result.topology = kTopologyNames[options.topology];
+    // Float swarms always use the scalar objective
+    result.objective = (options.batch && sizeof(Scalar) == sizeof(double)) ? "batch" : "scalar";
+    result.timeToTarget = -1.0;
+
+    const Clock::time_point start = Clock::now();
+    pso.initialize();
+    do
+    {
+        pso.step();
+        if (result.timeToTarget < 0.0 && -pso.getGBest().getPBestFitness() <= options.target)
+        {
+            const std::chrono::duration<double> elapsed = Clock::now() - start;
+            result.timeToTarget = elapsed.count();
+        }
+    }
+    while (pso.getStopReason() == kStopNotStopped);
+    const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+    result.iterations = pso.getIteration();
+    result.seconds = elapsed.count();
+    result.stats = pso.getStats();
+    // Counting the updates (-DPSO_INSTRUMENT) is not part of their time
+    const double updateSeconds = result.seconds - ff.seconds() - result.stats.phases[kPhaseCount].wallSeconds;
+    result.nsPerUpdate = 1e9 * updateSeconds / (1.0 * result.iterations * numParticles * numDims);
+    result.evalsPerSecond = (ff.seconds() > 0.0) ? pso.getNumEvaluations() / ff.seconds() : 0.0;
+    result.finalError = -pso.getGBest().getPBestFitness();
+    if (!options.traceFile.empty())
+    {
+        std::ofstream trace(options.traceFile.c_str());
+        pso.writeTrace(trace);
+    }
+    return result;
+}
+
+template<class Scalar>
+bool runFunction(const std::string& name, const unsigned int numDims, const unsigned int numParticles,
+                 const Options& options, const gslseed_t seed, Result* result)
+{
+    if (name == Sphere::name())
+    {
+        *result = run<Sphere, Scalar>(numDims, numParticles, options, seed);
+    }
+    else if (name == Rastrigin::name())
+    {
+        *result = run<Rastrigin, Scalar>(numDims, numParticles, options, seed);
+    }
+    else if (name == Rosenbrock::name())
+    {
+        *result = run<Rosenbrock, Scalar>(numDims, numParticles, options, seed);
+    }
+    else if (name == Ackley::name())
+    {
+        *result = run<Ackley, Scalar>(numDims, numParticles, options, seed);
+    }
+    else if (name == Griewank::name())
+    {
+        *result = run<Griewank, Scalar>(numDims, numParticles, options, seed);
+    }
+    else if (name == Schwefel::name())
+    {
+        *result = run<Schwefel, Scalar>(numDims, numParticles, options, seed);
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+void writeCSVHeader(std::ostream& out)
+{
+    out << "function,dims,particles,precision,topology,objective,iterations,seconds,ns_per_update,"
+        << "evals_per_second,time_to_target,final_error\n";
+}
+
+void writeCSV(std::ostream& out, const Result& r)
+{
+    out << r.function << "," << r.dims << "," << r.particles << "," << r.precision << ","
+        << r.topology << "," << r.objective << "," << r.iterations << ","
+        << r.seconds << "," << r.nsPerUpdate << "," << r.evalsPerSecond << ","
+        << r.timeToTarget << "," << r.finalError << "\n";
+}
+
+void writeJSON(std::ostream& out, const Result& r, const bool first)
+{
+    out << (first ? "  " : ",\n  ")
+        << "{\"function\": \"" << r.function << "\", \"dims\": " << r.dims
+        << ", \"particles\": " << r.particles << ", \"precision\": \"" << r.precision
+        << "\", \"topology\": \"" << r.topology << "\", \"objective\": \"" << r.objective
+        << "\", \"iterations\": " << r.iterations
+        << ", \"seconds\": " << r.seconds << ", \"ns_per_update\": " << r.nsPerUpdate
+        << ", \"evals_per_second\": " << r.evalsPerSecond
+        << ", \"time_to_target\": " << r.timeToTarget << ", \"final_error\": " << r.finalError << "}";
+}
+
+template<class T>
+std::vector<T> parseList(const std::string& s)
+{
+    std::vector<T> values;
+    std::istringstream iss(s);
+    std::string item;
+    while (std::getline(iss, item, ','))
+    {
+        std::istringstream is(item);
+        T value;
+        is >> value;
+        values.push_back(value);
+    }
+    return values;
+}
+
+void usage(const char* program)
+{
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --functions <list>   sphere,rastrigin,rosenbrock,ackley,griewank,schwefel (default: all)\n"
+              << "  --dims <list>        Numbers of dimensions (default: 2,10,100,1000)\n"
+              << "  --particles <list>   Swarm sizes (default: 16,256,1024)\n"
+              << "  --precision <list>   Coordinate types, double,float (default: double)\n"
+              << "  --iterations <n>     Iterations per run (default: 200)\n"
+              << "  --repeats <n>        Runs per configuration, with different seeds (default: 1)\n"
+              << "  --target <value>     Function value counted as solved (default: 1e-2)\n"
+              << "  --format <csv|json>  Output format (default: csv)\n"
+              << "  --topology <name>    global, ring, vonneumann or random (default: global)\n"
+              << "  --objective <name>   scalar, or batch for the SIMD kernels of batch_objectives.h (default: scalar)\n"
+              << "  --stats <file>       Write the phase timings and update rates of every run\n"
+              << "  --trace <file>       Write a Chrome trace of the phases of the last run\n"
+              << "The last two need a build with -DPSO_INSTRUMENT. The batch objective only\n"
+              << "supports double precision.\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    options.functions = parseList<std::string>("sphere,rastrigin,rosenbrock,ackley,griewank,schwefel");
+    options.dims = parseList<unsigned int>("2,10,100,1000");
+    options.particles = parseList<unsigned int>("16,256,1024");
+    options.precisions = parseList<std::string>("double");
+    options.iterations = 200;
+    options.repeats = 1;
+    options.target = 1e-2;
+    options.format = "csv";
+    options.topology = kTopologyGlobal;
+    options.batch = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg(argv[i]);
+        if (i + 1 >= argc)
+        {
+            usage(argv[0]);
+            return -1;
+        }
+        const std::string value(argv[++i]);
+        if (arg == "--functions")
+        {
+            options.functions = parseList<std::string>(value);
+        }
+        else if (arg == "--dims")
+        {
+            options.dims = parseList<unsigned int>(value);
+        }
+        else if (arg == "--particles")
+        {
+            options.particles = parseList<unsigned int>(value);
+        }
+        else if (arg == "--precision")
+        {
+            options.precisions = parseList<std::string>(value);
+            for (unsigned int k = 0; k < options.precisions.size(); k++)
+            {
+                if (options.precisions[k] != "double" && options.precisions[k] != "float")
+                {
+                    usage(argv[0]);
+                    return -1;
+                }
+            }
+        }
+        else if (arg == "--iterations")
+        {
+            options.iterations = atoi(value.c_str());
+        }
+        else if (arg == "--repeats")
+        {
+            options.repeats = atoi(value.c_str());
+        }
+        else if (arg == "--target")
+        {
+            options.target = atof(value.c_str());
+        }
+        else if (arg == "--format")
+        {
+            options.format = value;
+        }
+        else if (arg == "--topology")
+        {
+            unsigned int k = 0;
+            while (k < kNumTopologies && value != kTopologyNames[k])
+            {
+                k++;
+            }
+            if (k == kNumTopologies)
+            {
+                usage(argv[0]);
+                return -1;
+            }
+            options.topology = static_cast<TopologyKind>(k);
+        }
+        else if (arg == "--objective")
+        {
+            if (value != "scalar" && value != "batch")
+            {
+                usage(argv[0]);
+                return -1;
+            }
+            options.batch = (value == "batch");
+        }
+        else if (arg == "--stats")
+        {
+            options.statsFile = value;
+        }
+        else if (arg == "--trace")
+        {
+            options.traceFile = value;
+        }
+        else
+        {
+            usage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (options.batch && std::find(options.precisions.begin(), options.precisions.end(), "float") != options.precisions.end())
+    {
+        usage(argv[0]);
+        return -1;
+    }
+
+    std::ofstream stats;
+    if (!options.statsFile.empty())
+    {
+        stats.open(options.statsFile.c_str());
+    }
+
+    const bool json = (options.format == "json");
+    if (json)
+    {
+        std::cout << "{\"kernel\": \"" << updateKernelName() << "\", \"float_kernel\": \""
+                  << floatUpdateKernelName() << "\", \"results\": [\n";
+    }
+    else
+    {
+        writeCSVHeader(std::cout);
+    }
+
+    bool first = true;
+    for (unsigned int f = 0; f < options.functions.size(); f++)
+    {
+        for (unsigned int d = 0; d < options.dims.size(); d++)
+        {
+            for (unsigned int p = 0; p < options.particles.size(); p++)
+            {
+                for (unsigned int q = 0; q < options.precisions.size(); q++)
+                {
+                    for (unsigned int r = 0; r < options.repeats; r++)
+                    {
+                        Result result;
+                        const bool known = (options.precisions[q] == "float")
+                            ? runFunction<float>(options.functions[f], options.dims[d], options.particles[p], options, r, &result)
+                            : runFunction<double>(options.functions[f], options.dims[d], options.particles[p], options, r, &result);
+                        if (!known)
+                        {
+                            std::cerr << "Error: Unknown function " << options.functions[f] << "\n";
+                            return -1;
+                        }
+                        if (json)
+                        {
+                            writeJSON(std::cout, result, first);
+                        }
+                        else
+                        {
+                            writeCSV(std::cout, result);
+                        }
+                        std::cout.flush();
+                        first = false;
+                        if (stats.is_open())
+                        {
+                            stats << result.function << ", " << result.dims << " dims, " << result.particles
+                                  << " particles, " << result.precision << ", " << result.topology << " topology, "
+                                  << result.objective << " objective, seed " << r << "\n"
+                                  << result.stats << "\n";
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if (json)
+    {
+        std::cout << "\n]}\n";
+    }
+    return 0;
+}
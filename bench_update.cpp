@@ -0,0 +1,150 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * bench_update.cpp
+ *
+ * Times the velocity/position update of a whole swarm: the scalar
+ * Particle::updatePosition against the update kernels. The kernels get
+ * pregenerated random numbers, so their timings exclude the RNG.
+ */
+
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "aligned.h"
+#include "dim.h"
+#include "particle.h"
+#include "rng.h"
+#include "swarm.h"
+#include "update_kernel.h"
+
+namespace
+{
+
+void randomize(Swarm& swarm, const std::vector<Dim>& dims, const RandomNumberGenerator& rng)
+{
+    for (unsigned int i = 0; i <= swarm.size(); i++)
+    {
+        dim_t* pos = swarm.position(i);
+        for (unsigned int d = 0; d < dims.size(); d++)
+        {
+            pos[d] = rng.uniform(dims[d].min(), dims[d].max());
+        }
+        swarm.resetParticle(i);
+    }
+}
+
+double benchParticle(Swarm& swarm, const std::vector<Dim>& dims, const RandomNumberGenerator& rng,
+                     const unsigned int numRepeats)
+{
+    const Particle gbest = swarm.gbest();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned int r = 0; r < numRepeats; r++)
+    {
+        for (unsigned int i = 0; i < swarm.size(); i++)
+        {
+            swarm[i].updatePosition(gbest, dims, 2.0, 2.0, rng, 0.7);
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / numRepeats;
+}
+
+double benchKernel(UpdateKernel kernel, Swarm& swarm, const std::vector<Dim>& dims,
+                   const RandomNumberGenerator& rng, const unsigned int numRepeats)
+{
+    const size_t stride = swarm.stride();
+    AlignedBuffer<dim_t> lower(stride), upper(stride), maxVel(stride);
+    for (unsigned int d = 0; d < dims.size(); d++)
+    {
+        lower[d] = dims[d].min();
+        upper[d] = dims[d].max();
+        maxVel[d] = 0.01*(dims[d].max() - dims[d].min());
+    }
+    AlignedBuffer<dim_t> uniforms(2 * swarm.size() * stride);
+    for (unsigned int i = 0; i < uniforms.size(); i++)
+    {
+        uniforms[i] = rng.uniform();
+    }
+
+    UpdateArgs args;
+    args.guide = swarm.gbestPosition();
+    args.lower = lower.data();
+    args.upper = upper.data();
+    args.maxVel = maxVel.data();
+    args.n = stride;
+    args.c1 = 2.0;
+    args.c2 = 2.0;
+    args.inertiaWeight = 0.7;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned int r = 0; r < numRepeats; r++)
+    {
+        for (unsigned int i = 0; i < swarm.size(); i++)
+        {
+            args.pos = swarm.position(i);
+            args.vel = swarm.velocity(i);
+            args.pbest = swarm.pbestPosition(i);
+            args.r1 = uniforms.data() + 2 * i * stride;
+            args.r2 = args.r1 + stride;
+            kernel(args);
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / numRepeats;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc != 4)
+    {
+        std::cout << "Error: Invalid arguments.\n";
+        std::cout << "Usage: " << argv[0] << " <num particles> <num dimensions> <num repeats>\n";
+        return -1;
+    }
+
+    const unsigned int numParticles = atoi( argv[1] );
+    const unsigned int numDims = atoi( argv[2] );
+    const unsigned int numRepeats = atoi( argv[3] );
+    assert(numParticles > 0 && numDims > 0 && numRepeats > 0);
+
+    std::vector<Dim> dims(numDims, Dim(-10, 10));
+    RandomNumberGenerator rng(0);
+    Swarm swarm(numParticles, numDims);
+
+    randomize(swarm, dims, rng);
+    const double particle = benchParticle(swarm, dims, rng, numRepeats);
+    randomize(swarm, dims, rng);
+    const double scalar = benchKernel(updateKernelScalar, swarm, dims, rng, numRepeats);
+    randomize(swarm, dims, rng);
+    const double simd = benchKernel(selectUpdateKernel(), swarm, dims, rng, numRepeats);
+
+    const double numUpdates = 1.0 * numParticles * numDims;
+    std::cout << "particles = " << numParticles << ", dimensions = " << numDims << "\n";
+    std::cout << "Particle::updatePosition: " << particle / numUpdates * 1e9 << " ns/dimension\n";
+    std::cout << "scalar kernel:            " << scalar / numUpdates * 1e9 << " ns/dimension\n";
+    std::cout << updateKernelName() << " kernel:" << std::string(20 - std::string(updateKernelName()).size(), ' ')
+              << simd / numUpdates * 1e9 << " ns/dimension\n";
+
+    return 0;
+}
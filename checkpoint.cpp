@@ -0,0 +1,270 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * checkpoint.cpp
+ */
+#include "checkpoint.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include <unistd.h>
+
+Checkpoint::Checkpoint()
+{
+    memset(&mHeader, 0, sizeof(mHeader));
+    memcpy(mHeader.magic, kCheckpointMagic, sizeof(mHeader.magic));
+    mHeader.version = kCheckpointVersion;
+}
+
+void Checkpoint::reserve(const size_t numParticles, const size_t numDims)
+{
+    mHeader.numParticles = numParticles;
+    mHeader.numDims = numDims;
+    const size_t numRows = numParticles + 1;
+    mData.resize(numRows * (3 * numDims + 2));
+}
+
+StoppingState Checkpoint::stoppingState() const
+{
+    StoppingState state;
+    state.elapsedSeconds = mHeader.elapsedSeconds;
+    state.lastBest = mHeader.lastBest;
+    state.numStagnant = mHeader.numStagnant;
+    return state;
+}
+
+void Checkpoint::setStoppingState(const StoppingState& state)
+{
+    mHeader.elapsedSeconds = state.elapsedSeconds;
+    mHeader.lastBest = state.lastBest;
+    mHeader.numStagnant = state.numStagnant;
+}
+
+template<class T>
+void Checkpoint::capture(const BasicSwarm<T>& swarm)
+{
+    const size_t numRows = mHeader.numParticles + 1;
+    const size_t numDims = mHeader.numDims;
+    assert(swarm.size() == mHeader.numParticles && swarm.capacity() == mHeader.numParticles);
+    assert(swarm.numDims() == numDims);
+
+    double* pos = mData.data();
+    double* vel = pos + numRows * numDims;
+    double* pbest = vel + numRows * numDims;
+    double* fitness = pbest + numRows * numDims;
+    double* pbestFitness = fitness + numRows;
+    for (size_t i = 0; i < numRows; i++)
+    {
+        std::copy(swarm.position(i), swarm.position(i) + numDims, pos + i * numDims);
+        std::copy(swarm.velocity(i), swarm.velocity(i) + numDims, vel + i * numDims);
+        std::copy(swarm.pbestPosition(i), swarm.pbestPosition(i) + numDims, pbest + i * numDims);
+    }
+    std::copy(swarm.fitnesses(), swarm.fitnesses() + numRows, fitness);
+    std::copy(swarm.pbestFitnesses(), swarm.pbestFitnesses() + numRows, pbestFitness);
+}
+
+template<class T>
+void Checkpoint::restore(BasicSwarm<T>* swarm) const
+{
+    const size_t numRows = mHeader.numParticles + 1;
+    const size_t numDims = mHeader.numDims;
+    assert(swarm->size() == mHeader.numParticles && swarm->capacity() == mHeader.numParticles);
+    assert(swarm->numDims() == numDims);
+
+    const double* pos = mData.data();
+    const double* vel = pos + numRows * numDims;
+    const double* pbest = vel + numRows * numDims;
+    const double* fitness = pbest + numRows * numDims;
+    const double* pbestFitness = fitness + numRows;
+    for (size_t i = 0; i < numRows; i++)
+    {
+        std::copy(pos + i * numDims, pos + (i + 1) * numDims, swarm->position(i));
+        std::copy(vel + i * numDims, vel + (i + 1) * numDims, swarm->velocity(i));
+        std::copy(pbest + i * numDims, pbest + (i + 1) * numDims, swarm->pbestPosition(i));
+    }
+    std::copy(fitness, fitness + numRows, swarm->fitnesses());
+    std::copy(pbestFitness, pbestFitness + numRows, swarm->pbestFitnesses());
+}
+
+template void Checkpoint::capture(const Swarm&);
+template void Checkpoint::capture(const FloatSwarm&);
+template void Checkpoint::restore(Swarm*) const;
+template void Checkpoint::restore(FloatSwarm*) const;
+
+void Checkpoint::save(const std::string& filename) const
+{
+    const std::string tmp = filename + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f)
+    {
+        throw std::runtime_error("Checkpoint: can't create " + tmp);
+    }
+    bool ok = fwrite(&mHeader, sizeof(mHeader), 1, f) == 1;
+    ok = ok && fwrite(mData.data(), sizeof(double), mData.size(), f) == mData.size();
+    // On disk before the rename, or a crash could leave an empty file in
+    // place of the previous checkpoint
+    ok = ok && fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp.c_str(), filename.c_str()) != 0)
+    {
+        remove(tmp.c_str());
+        throw std::runtime_error("Checkpoint: can't write " + filename);
+    }
+}
+
+void Checkpoint::load(const std::string& filename)
+{
+    FILE* f = fopen(filename.c_str(), "rb");
+    if (!f)
+    {
+        throw std::runtime_error("Checkpoint: can't open " + filename);
+    }
+    CheckpointHeader header;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+        memcmp(header.magic, kCheckpointMagic, sizeof(header.magic)) == 0 &&
+        header.version == kCheckpointVersion;
+    if (ok)
+    {
+        reserve(header.numParticles, header.numDims);
+        mHeader = header;
+        ok = fread(mData.data(), sizeof(double), mData.size(), f) == mData.size();
+    }
+    fclose(f);
+    if (!ok)
+    {
+        throw std::runtime_error("Checkpoint: not a valid checkpoint: " + filename);
+    }
+}
+
+CheckpointWriter::CheckpointWriter(const std::string& filename, const unsigned int interval)
+    : mFilename(filename), mInterval(interval), mFilling(-1), mPending(-1), mWriting(-1),
+    mNumWritten(0), mClosing(false)
+{
+    mThread = std::thread(&CheckpointWriter::run, this);
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mClosing = true;
+        mSubmitted.notify_one();
+    }
+    mThread.join();
+}
+
+void CheckpointWriter::reserve(const size_t numParticles, const size_t numDims)
+{
+    flush();
+    mSnapshots[0].reserve(numParticles, numDims);
+    mSnapshots[1].reserve(numParticles, numDims);
+}
+
+Checkpoint& CheckpointWriter::acquire()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    throwError();
+    mFilling = (mWriting == 0) ? 1 : 0;
+    if (mPending == mFilling)
+    {
+        mPending = -1; // Superseded by the new one
+    }
+    return mSnapshots[mFilling];
+}
+
+void CheckpointWriter::submit()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    assert(mFilling >= 0);
+    mPending = mFilling;
+    mFilling = -1;
+    mSubmitted.notify_one();
+}
+
+void CheckpointWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (mPending >= 0 || mWriting >= 0)
+    {
+        mWritten.wait(lock);
+    }
+    throwError();
+}
+
+// Report a failed save once. Called with the mutex held.
+void CheckpointWriter::throwError()
+{
+    if (!mError.empty())
+    {
+        const std::string error = mError;
+        mError.clear();
+        throw std::runtime_error(error);
+    }
+}
+
+unsigned long CheckpointWriter::getNumWritten() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mNumWritten;
+}
+
+// Writer thread: save submitted snapshots until closed
+void CheckpointWriter::run()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;)
+    {
+        while (mPending < 0 && !mClosing)
+        {
+            mSubmitted.wait(lock);
+        }
+        if (mPending < 0)
+        {
+            return;
+        }
+
+        const int i = mPending;
+        mWriting = i;
+        mPending = -1;
+        lock.unlock();
+        std::string error;
+        try
+        {
+            mSnapshots[i].save(mFilename);
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+        }
+        lock.lock();
+
+        if (error.empty())
+        {
+            mNumWritten++;
+        }
+        else
+        {
+            mError = error;
+        }
+        mWriting = -1;
+        mWritten.notify_all();
+    }
+}
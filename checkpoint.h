@@ -0,0 +1,167 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * checkpoint.h
+ */
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stopping.h"
+#include "swarm.h"
+
+static const char kCheckpointMagic[8] = { 'P', 'S', 'O', 'C', 'K', 'P', '0', '1' };
+static const uint32_t kCheckpointVersion = 1;
+
+// Counters of a run, stored at the start of a checkpoint file
+struct CheckpointHeader
+{
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    numParticles;
+    uint32_t    numDims;
+    uint32_t    iteration;      // Next iteration to run
+    uint32_t    maxIterations;
+    uint32_t    run;            // Part of the random stream ids
+    uint64_t    seed;
+    uint64_t    numEvaluations;
+    double      elapsedSeconds;
+    double      lastBest;       // Stagnation test state
+    uint32_t    numStagnant;
+    uint32_t    topologyEpoch;  // Draw of the random topology
+};
+
+// Snapshot of a PSO run between two iterations: the counters and every row
+// of the swarm, including the global best. The random numbers of PSO are a
+// function of the seed, the run and the iteration (see counter_rng.h), so
+// there is no generator state to save beyond those.
+//
+// The file is the header followed by the positions, velocities and
+// personal best positions of the numParticles + 1 rows (numDims values
+// each, the global best last), then their fitnesses and personal best
+// fitnesses, in the byte order of the machine that wrote it.
+class Checkpoint
+{
+public:
+    Checkpoint();
+
+    // Size the snapshot for a swarm. Nothing else allocates.
+    void reserve(const size_t numParticles, const size_t numDims);
+
+    CheckpointHeader& header()
+    {
+        return mHeader;
+    }
+    const CheckpointHeader& header() const
+    {
+        return mHeader;
+    }
+
+    StoppingState stoppingState() const;
+    void setStoppingState(const StoppingState& state);
+
+    // Copy the rows of swarm, which must have been reserved for. The file
+    // always holds doubles; float rows are widened. Both are instantiated
+    // for Swarm and FloatSwarm.
+    template<class T>
+    void capture(const BasicSwarm<T>& swarm);
+
+    // Copy the rows back into swarm, which must have the same shape
+    template<class T>
+    void restore(BasicSwarm<T>* swarm) const;
+
+    // Write to a temporary file renamed to filename once complete, so an
+    // existing checkpoint is only replaced by a whole one. Throws
+    // std::runtime_error on failure.
+    void save(const std::string& filename) const;
+
+    // Throws std::runtime_error if the file can't be read or isn't a
+    // checkpoint
+    void load(const std::string& filename);
+
+private:
+    Checkpoint(const Checkpoint&);
+    void operator=(const Checkpoint&);
+
+    CheckpointHeader    mHeader;
+    std::vector<double> mData;
+};
+
+// Saves checkpoints from a background thread. PSO fills a snapshot, which
+// is only a copy of the swarm, and the file is written while the run goes
+// on. If a snapshot is taken while the previous one is still waiting to be
+// written, the older one is dropped.
+class CheckpointWriter
+{
+public:
+    // Save every interval iterations
+    CheckpointWriter(const std::string& filename, const unsigned int interval);
+    ~CheckpointWriter();
+
+    bool due(const unsigned int iteration) const
+    {
+        return mInterval > 0 && iteration % mInterval == 0;
+    }
+
+    // Size the snapshots, so that taking one doesn't allocate
+    void reserve(const size_t numParticles, const size_t numDims);
+
+    // Snapshot to fill, then hand over with submit(). Throws
+    // std::runtime_error if an earlier save failed.
+    Checkpoint& acquire();
+    void submit();
+
+    // Wait until the last submitted snapshot is written. Throws
+    // std::runtime_error if a save failed.
+    void flush();
+
+    unsigned long getNumWritten() const;
+
+private:
+    CheckpointWriter(const CheckpointWriter&);
+    void operator=(const CheckpointWriter&);
+
+    void run();
+    void throwError();
+
+    std::string             mFilename;
+    unsigned int            mInterval;
+
+    // Two snapshots: one can be filled while the other is written
+    Checkpoint              mSnapshots[2];
+    int                     mFilling;
+    int                     mPending;   // Submitted and not yet picked up (-1 if none)
+    int                     mWriting;   // Being written (-1 if none)
+    unsigned long           mNumWritten;
+    std::string             mError;
+
+    mutable std::mutex      mMutex;
+    std::condition_variable mSubmitted;
+    std::condition_variable mWritten;
+    bool                    mClosing;
+    std::thread             mThread;
+};
+
+#endif /* CHECKPOINT_H_ */
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * columnar_data.cpp
+ */
+#include "columnar_data.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ColumnarDataWriter::ColumnarDataWriter(const std::string& filename, const size_t numColumns, const size_t numRows)
+    : mFilename(filename), mFd(-1), mNumColumns(numColumns), mNumRows(numRows)
+{
+    mFd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (mFd < 0)
+    {
+        throw std::runtime_error("ColumnarDataWriter: can't open " + filename);
+    }
+
+    ColumnarHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kColumnarMagic, sizeof(header.magic));
+    header.version = kColumnarVersion;
+    header.numColumns = numColumns;
+    header.numRows = numRows;
+    const off_t size = sizeof(header) + numColumns * columnarColumnBytes(numRows);
+    if (ftruncate(mFd, size) != 0 || pwrite(mFd, &header, sizeof(header), 0) != sizeof(header))
+    {
+        ::close(mFd);
+        mFd = -1;
+        throw std::runtime_error("ColumnarDataWriter: can't write " + filename);
+    }
+}
+
+ColumnarDataWriter::~ColumnarDataWriter()
+{
+    if (mFd >= 0)
+    {
+        ::close(mFd);
+    }
+}
+
+void ColumnarDataWriter::write(const size_t column, const size_t firstRow, const double* values, const size_t n)
+{
+    if (mFd < 0 || column >= mNumColumns || firstRow + n > mNumRows)
+    {
+        throw std::runtime_error("ColumnarDataWriter: write out of range in " + mFilename);
+    }
+    const char* p = reinterpret_cast<const char*>(values);
+    size_t remaining = n * sizeof(double);
+    off_t offset = sizeof(ColumnarHeader) + column * columnarColumnBytes(mNumRows) + firstRow * sizeof(double);
+    while (remaining > 0)
+    {
+        const ssize_t written = pwrite(mFd, p, remaining, offset);
+        if (written <= 0)
+        {
+            throw std::runtime_error("ColumnarDataWriter: can't write " + mFilename);
+        }
+        p += written;
+        offset += written;
+        remaining -= written;
+    }
+}
+
+void ColumnarDataWriter::close()
+{
+    if (mFd >= 0)
+    {
+        const int result = ::close(mFd);
+        mFd = -1;
+        if (result != 0)
+        {
+            throw std::runtime_error("ColumnarDataWriter: can't close " + mFilename);
+        }
+    }
+}
+
+ColumnarData::ColumnarData(const std::string& filename)
+    : mFd(-1), mMap(0), mSize(0)
+{
+    mFd = open(filename.c_str(), O_RDONLY);
+    if (mFd < 0)
+    {
+        throw std::runtime_error("ColumnarData: can't open " + filename);
+    }
+    struct stat st;
+    if (fstat(mFd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ColumnarHeader))
+    {
+        ::close(mFd);
+        throw std::runtime_error("ColumnarData: not a data set file: " + filename);
+    }
+    mSize = st.st_size;
+    void* map = mmap(0, mSize, PROT_READ, MAP_SHARED, mFd, 0);
+    if (map == MAP_FAILED)
+    {
+        ::close(mFd);
+        throw std::runtime_error("ColumnarData: can't map " + filename);
+    }
+    mMap = static_cast<const char*>(map);
+    madvise(map, mSize, MADV_SEQUENTIAL);
+
+    memcpy(&mHeader, mMap, sizeof(mHeader));
+    if (memcmp(mHeader.magic, kColumnarMagic, sizeof(mHeader.magic)) != 0 || mHeader.version != kColumnarVersion ||
+        sizeof(mHeader) + mHeader.numColumns * columnarColumnBytes(mHeader.numRows) > mSize)
+    {
+        unmap();
+        throw std::runtime_error("ColumnarData: not a data set file: " + filename);
+    }
+}
+
+ColumnarData::~ColumnarData()
+{
+    unmap();
+}
+
+void ColumnarData::unmap()
+{
+    if (mMap)
+    {
+        munmap(const_cast<char*>(mMap), mSize);
+        mMap = 0;
+    }
+    if (mFd >= 0)
+    {
+        ::close(mFd);
+        mFd = -1;
+    }
+}
+
+void ColumnarData::willNeed(const size_t firstRow, const size_t n) const
+{
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+    for (size_t c = 0; c < numColumns(); c++)
+    {
+        const size_t begin = reinterpret_cast<const char*>(column(c) + firstRow) - mMap;
+        const size_t end = reinterpret_cast<const char*>(column(c) + firstRow + n) - mMap;
+        const size_t pageBegin = (begin / pageSize) * pageSize;
+        madvise(const_cast<char*>(mMap) + pageBegin, end - pageBegin, MADV_WILLNEED);
+    }
+}
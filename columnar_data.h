@@ -0,0 +1,117 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * columnar_data.h
+ */
+
+#ifndef COLUMNAR_DATA_H_
+#define COLUMNAR_DATA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Data set file for the streaming objectives: a 64 byte header followed by
+// one contiguous array of doubles per column. Each column starts on a
+// 64 byte boundary.
+static const char kColumnarMagic[8] = { 'P', 'S', 'O', 'D', 'A', 'T', '0', '1' };
+static const uint32_t kColumnarVersion = 1;
+
+struct ColumnarHeader
+{
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    numColumns;
+    uint64_t    numRows;
+    uint64_t    reserved[5];
+};
+
+// Bytes from the start of one column to the next
+inline uint64_t columnarColumnBytes(const uint64_t numRows)
+{
+    return ((numRows * sizeof(double) + 63) / 64) * 64;
+}
+
+// Writes a data set whose size is known in advance, a piece of a column at
+// a time, so it never has to fit in memory. Throws std::runtime_error on
+// I/O errors.
+class ColumnarDataWriter
+{
+public:
+    ColumnarDataWriter(const std::string& filename, const size_t numColumns, const size_t numRows);
+    ~ColumnarDataWriter();
+
+    // Rows [firstRow, firstRow + n) of a column
+    void write(const size_t column, const size_t firstRow, const double* values, const size_t n);
+
+    void close();
+
+private:
+    // Prevent copying and assignment
+    ColumnarDataWriter(const ColumnarDataWriter&);
+    void operator=(const ColumnarDataWriter&);
+
+    std::string mFilename;
+    int         mFd;
+    size_t      mNumColumns;
+    size_t      mNumRows;
+};
+
+// Read-only memory map of a data set written by ColumnarDataWriter. Only
+// the parts that are read are paged in, and the kernel is told the access
+// is sequential, so data sets larger than memory can be streamed.
+class ColumnarData
+{
+public:
+    // Throws std::runtime_error if the file can't be mapped or isn't a
+    // data set file
+    explicit ColumnarData(const std::string& filename);
+    ~ColumnarData();
+
+    size_t numColumns() const
+    {
+        return mHeader.numColumns;
+    }
+
+    size_t numRows() const
+    {
+        return mHeader.numRows;
+    }
+
+    const double* column(const size_t c) const
+    {
+        return reinterpret_cast<const double*>(mMap + sizeof(ColumnarHeader) + c * columnarColumnBytes(mHeader.numRows));
+    }
+
+    // Ask the kernel to start reading rows [firstRow, firstRow + n) of
+    // every column
+    void willNeed(const size_t firstRow, const size_t n) const;
+
+private:
+    // Prevent copying and assignment
+    ColumnarData(const ColumnarData&);
+    void operator=(const ColumnarData&);
+
+    void unmap();
+
+    int             mFd;
+    const char*     mMap;
+    size_t          mSize;
+    ColumnarHeader  mHeader;
+};
+
+#endif /* COLUMNAR_DATA_H_ */
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * counter_rng.h
+ */
+
+#ifndef COUNTER_RNG_H_
+#define COUNTER_RNG_H_
+
+#include <cstddef>
+#include <stdint.h>
+
+// Counter-based random number generator (Philox4x32-10, Salmon et al.,
+// "Parallel random numbers: as easy as 1, 2, 3", SC11).
+//
+// There is no state to advance: every random number is a pure function of
+// the seed and of its coordinates (iteration, particle, dimension, stream).
+// Any thread can therefore generate the numbers of any particle in any
+// order and get exactly the same values, whatever the number of threads.
+class CounterRNG
+{
+public:
+    // Independent streams used by PSO
+    enum Stream
+    {
+        kCognitiveStream = 0,   // r1 of the velocity update
+        kSocialStream = 1,      // r2 of the velocity update
+        kInitStream = 2,        // Initial positions
+        kTopologyStream = 3,    // Neighbours of the random topology
+        kSurrogateStream = 4    // Exploration draws of the surrogate screening
+    };
+
+    explicit CounterRNG(const uint64_t seed)
+    {
+        mKey[0] = static_cast<uint32_t>(seed);
+        mKey[1] = static_cast<uint32_t>(seed >> 32);
+    }
+
+    uint64_t seed() const
+    {
+        return (static_cast<uint64_t>(mKey[1]) << 32) | mKey[0];
+    }
+
+    // Uniform number in [0,1) for one coordinate
+    double uniform(const uint32_t iteration, const uint32_t particle, const uint32_t dimension,
+                   const uint32_t stream) const
+    {
+        uint32_t ctr[4] = { dimension / 2, particle, iteration, stream };
+        philox(ctr);
+        return (dimension % 2 == 0) ? toUniform(ctr[0], ctr[1]) : toUniform(ctr[2], ctr[3]);
+    }
+
+    // out[d] = uniform(iteration, particle, d, stream) for d in [0, n).
+    // Each block of the generator yields two numbers.
+    void fillUniform(double* out, const size_t n, const uint32_t iteration, const uint32_t particle,
+                     const uint32_t stream) const
+    {
+        const size_t numBlocks = n / 2;
+        for (size_t b = 0; b < numBlocks; b++)
+        {
+            uint32_t ctr[4] = { static_cast<uint32_t>(b), particle, iteration, stream };
+            philox(ctr);
+            out[2*b] = toUniform(ctr[0], ctr[1]);
+            out[2*b + 1] = toUniform(ctr[2], ctr[3]);
+        }
+        if (n % 2 != 0)
+        {
+            out[n - 1] = uniform(iteration, particle, static_cast<uint32_t>(n - 1), stream);
+        }
+    }
+
+    // Single precision version for float swarms. Each block yields four
+    // numbers of 24 bits, so these are not the values of the double version.
+    void fillUniform(float* out, const size_t n, const uint32_t iteration, const uint32_t particle,
+                     const uint32_t stream) const
+    {
+        for (size_t b = 0; 4 * b < n; b++)
+        {
+            uint32_t ctr[4] = { static_cast<uint32_t>(b), particle, iteration, stream };
+            philox(ctr);
+            for (size_t k = 0; k < 4 && 4 * b + k < n; k++)
+            {
+                out[4*b + k] = toUniformFloat(ctr[k]);
+            }
+        }
+    }
+
+    // Uniform numbers in [min, max)
+    void fillUniform(double* out, const size_t n, const uint32_t iteration, const uint32_t particle,
+                     const uint32_t stream, const double min, const double max) const
+    {
+        fillUniform(out, n, iteration, particle, stream);
+        for (size_t i = 0; i < n; i++)
+        {
+            out[i] = min + out[i] * (max - min);
+        }
+    }
+
+    // The raw 4x32 bit block for a counter, keyed by the seed (low word
+    // first). Checked against the Random123 vectors by test_pso_rng.cpp.
+    void block(uint32_t ctr[4]) const
+    {
+        philox(ctr);
+    }
+
+private:
+    // 53 random bits -> [0,1)
+    static double toUniform(const uint32_t hi, const uint32_t lo)
+    {
+        const uint64_t bits = ((static_cast<uint64_t>(hi) << 32) | lo) >> 11;
+        return bits * (1.0 / 9007199254740992.0);
+    }
+
+    // 24 random bits -> [0,1)
+    static float toUniformFloat(const uint32_t x)
+    {
+        return (x >> 8) * (1.0f / 16777216.0f);
+    }
+
+    void philox(uint32_t ctr[4]) const
+    {
+        uint32_t key[2] = { mKey[0], mKey[1] };
+        for (int r = 0; r < 10; r++)
+        {
+            const uint64_t p0 = static_cast<uint64_t>(0xD2511F53u) * ctr[0];
+            const uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57u) * ctr[2];
+            const uint32_t c0 = static_cast<uint32_t>(p1 >> 32) ^ ctr[1] ^ key[0];
+            const uint32_t c1 = static_cast<uint32_t>(p1);
+            const uint32_t c2 = static_cast<uint32_t>(p0 >> 32) ^ ctr[3] ^ key[1];
+            const uint32_t c3 = static_cast<uint32_t>(p0);
+            ctr[0] = c0;
+            ctr[1] = c1;
+            ctr[2] = c2;
+            ctr[3] = c3;
+            key[0] += 0x9E3779B9u;
+            key[1] += 0xBB67AE85u;
+        }
+    }
+
+    uint32_t mKey[2];
+};
+
+#endif /* COUNTER_RNG_H_ */
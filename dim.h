@@ -33,19 +33,21 @@ class Dim
 {
 public:
     // Fixme
-    Dim() : mMin(1.0), mMax(2.0) {}
+    constexpr Dim() : mMin(1.0), mMax(2.0) {}
 
-    Dim(const dim_t mi, const dim_t ma)
-        : mMin(mi), mMax(ma)
+    // constexpr so that fixed-dimension problems can declare their bounds
+    // as compile-time constants. The assert is folded into the initializer
+    // to keep the constructor body empty.
+    constexpr Dim(const dim_t mi, const dim_t ma)
+        : mMin(mi), mMax((assert(ma >= mi), ma))
     {
-        assert(mMax >= mMin);
     }
 
-    dim_t min() const
+    constexpr dim_t min() const
     {
         return mMin;
     }
-    dim_t max() const
+    constexpr dim_t max() const
     {
         return mMax;
     }
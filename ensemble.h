@@ -0,0 +1,292 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * ensemble.h
+ */
+
+#ifndef ENSEMBLE_H_
+#define ENSEMBLE_H_
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <vector>
+
+#include "aligned.h"
+#include "counter_rng.h"
+#include "dim.h"
+#include "pso_parameters.h"
+#include "rng.h"
+#include "swarm.h"
+#include "thread_pool.h"
+#include "update_kernel.h"
+
+// Many independent PSO runs of the same shape (number of particles and
+// bounds), solved in lockstep. The particles of every run live in one
+// Swarm: run r owns rows [r * particlesPerRun, (r+1) * particlesPerRun).
+// Each run has its own global best, and a run never sees the particles of
+// another one.
+//
+// The fitness function receives the whole ensemble at once:
+//   void operator()(const Swarm& particles, const unsigned int particlesPerRun,
+//                   std::vector<double>* particleFitnesses)
+// where row k belongs to run k / particlesPerRun, so it can evaluate every
+// run against its own data in one pass.
+//
+// The update runs over tiles of consecutive rows, across run boundaries,
+// with one call of the SIMD update kernel per tile. Every random number is
+// a function of the seed and of (iteration, row, dimension).
+template<class FitnessFunction>
+class Ensemble
+{
+public:
+    Ensemble(const unsigned int numRuns, const unsigned int particlesPerRun, const std::vector<Dim>& dim,
+             const gslseed_t seed, FitnessFunction& fitnessFunction, const unsigned int maxIterations)
+        : mNumRuns(numRuns), mParticlesPerRun(particlesPerRun),
+        mSwarm(numRuns * particlesPerRun, dim.size()), mDim(dim), mRng(seed),
+        mFitnessFunction(fitnessFunction), mMaxIterations(maxIterations), mIteration(0),
+        mFitnesses(numRuns * particlesPerRun), mRun(0), mPool(0), mKernel(selectUpdateKernel())
+    {
+        assert(numRuns > 0 && particlesPerRun > 0);
+        const size_t stride = mSwarm.stride();
+        mGBestPos.resize(numRuns * stride);
+        mGBestFitness.resize(numRuns);
+
+        // Bounds repeated over a whole tile, so a tile is one kernel call.
+        // The padding stays zero, which pins the padding lanes at zero.
+        mLower.resize(kTileRows * stride);
+        mUpper.resize(kTileRows * stride);
+        mMaxVel.resize(kTileRows * stride);
+        for (size_t row = 0; row < kTileRows; row++)
+        {
+            for (size_t d = 0; d < mDim.size(); d++)
+            {
+                mLower[row * stride + d] = mDim[d].min();
+                mUpper[row * stride + d] = mDim[d].max();
+                mMaxVel[row * stride + d] = maxVelocity(mDim[d]);
+            }
+        }
+        resizeScratch(1);
+    }
+
+    unsigned int getNumRuns() const
+    {
+        return mNumRuns;
+    }
+
+    unsigned int getParticlesPerRun() const
+    {
+        return mParticlesPerRun;
+    }
+
+    // Move the tiles in parallel on this pool (0 to move them serially).
+    // The results don't depend on the number of threads.
+    void setThreadPool(ThreadPool* pool)
+    {
+        mPool = pool;
+        resizeScratch(mPool ? mPool->size() : 1);
+    }
+
+    void iterate()
+    {
+        initialize();
+        do
+        {
+            step();
+        }
+        while (mIteration < mMaxIterations);
+    }
+
+    // Place the particles of every run randomly
+    void initialize()
+    {
+        mRun++;
+        for (size_t k = 0; k < mSwarm.size(); k++)
+        {
+            dim_t* pos = mSwarm.position(k);
+            dim_t* vel = mSwarm.velocity(k);
+            mRng.fillUniform( pos, mDim.size(), 0, k, stream(CounterRNG::kInitStream) );
+            for (size_t d = 0; d < mDim.size(); d++)
+            {
+                pos[d] = mDim[d].min() + pos[d] * (mDim[d].max() - mDim[d].min());
+                vel[d] = 0.0;
+            }
+            mSwarm.resetParticle(k);
+        }
+        std::fill(mGBestFitness.data(), mGBestFitness.data() + mNumRuns, -1.0 * std::numeric_limits<prob_t>::max());
+        mIteration = 0;
+    }
+
+    // One iteration of every run
+    void step()
+    {
+        mFitnessFunction(mSwarm, mParticlesPerRun, &mFitnesses);
+
+        // Personal bests over the flat arrays, then the best of each run
+        prob_t* fitness = mSwarm.fitnesses();
+        prob_t* pbestFitness = mSwarm.pbestFitnesses();
+        const size_t stride = mSwarm.stride();
+        for (size_t k = 0; k < mSwarm.size(); k++)
+        {
+            fitness[k] = mFitnesses[k];
+            if (fitness[k] > pbestFitness[k])
+            {
+                pbestFitness[k] = fitness[k];
+                std::copy(mSwarm.position(k), mSwarm.position(k) + stride, mSwarm.pbestPosition(k));
+            }
+        }
+        for (unsigned int r = 0; r < mNumRuns; r++)
+        {
+            const prob_t* f = pbestFitness + r * mParticlesPerRun;
+            const size_t best = r * mParticlesPerRun + (std::max_element(f, f + mParticlesPerRun) - f);
+            mGBestFitness[r] = pbestFitness[best];
+            std::copy(mSwarm.pbestPosition(best), mSwarm.pbestPosition(best) + stride, mGBestPos.data() + r * stride);
+        }
+
+        MoveTiles move = { this, computeInertiaWeight(mIteration, mMaxIterations) };
+        const size_t numTiles = (mSwarm.size() + kTileRows - 1) / kTileRows;
+        if (mPool)
+        {
+            mPool->parallelFor(numTiles, 1, move);
+        }
+        else
+        {
+            move(0, numTiles);
+        }
+
+        mIteration++;
+    }
+
+    unsigned int getIteration() const
+    {
+        return mIteration;
+    }
+
+    // Global best of run r
+    const dim_t* getBestPosition(const unsigned int r) const
+    {
+        return mGBestPos.data() + r * mSwarm.stride();
+    }
+
+    prob_t getBestFitness(const unsigned int r) const
+    {
+        return mGBestFitness[r];
+    }
+
+    const Swarm& getSwarm() const
+    {
+        return mSwarm;
+    }
+
+private:
+    Ensemble(const Ensemble&);
+    void operator=(const Ensemble&);
+
+    // Rows per kernel call
+    static const size_t kTileRows = 64;
+
+    uint32_t stream(const CounterRNG::Stream s) const
+    {
+        return (mRun << 8) | s;
+    }
+
+    // Scratch tiles of each thread: r1, r2 and the guides
+    void resizeScratch(const unsigned int numThreads)
+    {
+        mScratch.resize(3 * kTileRows * mSwarm.stride() * numThreads);
+    }
+
+    struct MoveTiles
+    {
+        Ensemble*   ensemble;
+        double      inertiaWeight;
+
+        void operator()(const size_t begin, const size_t end)
+        {
+            const unsigned int thread = ThreadPool::currentThread(ensemble->mPool);
+            for (size_t t = begin; t < end; t++)
+            {
+                ensemble->moveTile(t, inertiaWeight, thread);
+            }
+        }
+    };
+
+    // Move the rows of tile t with a single kernel call, using the scratch
+    // tiles of thread (an index in mPool)
+    void moveTile(const size_t t, const double inertiaWeight, const unsigned int thread)
+    {
+        const size_t stride = mSwarm.stride();
+        const size_t first = t * kTileRows;
+        const size_t numRows = std::min(kTileRows, mSwarm.size() - first);
+        assert(3 * kTileRows * stride * (thread + 1) <= mScratch.size());
+        dim_t* r1 = mScratch.data() + 3 * kTileRows * stride * thread;
+        dim_t* r2 = r1 + kTileRows * stride;
+        dim_t* guide = r2 + kTileRows * stride;
+
+        for (size_t row = 0; row < numRows; row++)
+        {
+            const size_t k = first + row;
+            mRng.fillUniform( r1 + row * stride, mDim.size(), mIteration, k, stream(CounterRNG::kCognitiveStream) );
+            mRng.fillUniform( r2 + row * stride, mDim.size(), mIteration, k, stream(CounterRNG::kSocialStream) );
+            const dim_t* gbest = getBestPosition(k / mParticlesPerRun);
+            std::copy(gbest, gbest + stride, guide + row * stride);
+        }
+
+        UpdateArgs args;
+        args.pos = mSwarm.position(first);
+        args.vel = mSwarm.velocity(first);
+        args.pbest = mSwarm.pbestPosition(first);
+        args.guide = guide;
+        args.r1 = r1;
+        args.r2 = r2;
+        args.lower = mLower.data();
+        args.upper = mUpper.data();
+        args.maxVel = mMaxVel.data();
+        args.n = numRows * stride;
+        args.c1 = kCognitiveWeight;
+        args.c2 = kSocialWeight;
+        args.inertiaWeight = inertiaWeight;
+        mKernel(args);
+    }
+
+    unsigned int            mNumRuns;
+    unsigned int            mParticlesPerRun;
+    Swarm                   mSwarm;
+    std::vector<Dim>        mDim;
+    AlignedBuffer<dim_t>    mGBestPos;      // One row per run
+    AlignedBuffer<prob_t>   mGBestFitness;
+
+    CounterRNG              mRng;
+
+    FitnessFunction&        mFitnessFunction;
+    unsigned int            mMaxIterations;
+    unsigned int            mIteration;
+    std::vector<double>     mFitnesses;
+    uint32_t                mRun;
+    ThreadPool*             mPool;
+
+    UpdateKernel            mKernel;
+    AlignedBuffer<dim_t>    mLower;
+    AlignedBuffer<dim_t>    mUpper;
+    AlignedBuffer<dim_t>    mMaxVel;
+    AlignedBuffer<dim_t>    mScratch;
+};
+
+template<class FitnessFunction>
+const size_t Ensemble<FitnessFunction>::kTileRows;
+
+#endif /* ENSEMBLE_H_ */
@@ -0,0 +1,206 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * fitness_cache.cpp
+ */
+#include "fitness_cache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+const uint32_t FitnessCache::kEmpty;
+
+FitnessCache::FitnessCache(const std::vector<Dim>& dims, const std::vector<dim_t>& epsilon, const size_t capacity)
+    : mNumDims(dims.size())
+{
+    assert(epsilon.size() == dims.size());
+    for (size_t d = 0; d < mNumDims; d++)
+    {
+        assert(epsilon[d] > 0.0);
+        mMin.push_back(dims[d].min());
+        mInvEpsilon.push_back(1.0 / epsilon[d]);
+    }
+    initialize(capacity);
+}
+
+FitnessCache::FitnessCache(const std::vector<Dim>& dims, const double relativeEpsilon, const size_t capacity)
+    : mNumDims(dims.size())
+{
+    assert(relativeEpsilon > 0.0);
+    for (size_t d = 0; d < mNumDims; d++)
+    {
+        mMin.push_back(dims[d].min());
+        mInvEpsilon.push_back(1.0 / (relativeEpsilon * (dims[d].max() - dims[d].min())));
+    }
+    initialize(capacity);
+}
+
+void FitnessCache::initialize(const size_t capacity)
+{
+    assert(capacity > 0 && capacity < kEmpty);
+    mCapacity = capacity;
+    mSize = 0;
+    mHand = 0;
+    mKeys.resize(mCapacity * mNumDims);
+    mHashes.resize(mCapacity);
+    mFitness.resize(mCapacity);
+    mReferenced.resize(mCapacity);
+    mSlotOf.resize(mCapacity);
+    mKey.resize(mNumDims);
+
+    // Keep the load factor at or below 1/2
+    size_t numSlots = 1;
+    while (numSlots < 2 * mCapacity)
+    {
+        numSlots *= 2;
+    }
+    mTable.assign(numSlots, kEmpty);
+    mMask = numSlots - 1;
+
+    mNumHits = 0;
+    mNumMisses = 0;
+    mNumEvictions = 0;
+}
+
+void FitnessCache::clear()
+{
+    std::fill(mTable.begin(), mTable.end(), kEmpty);
+    mSize = 0;
+    mHand = 0;
+}
+
+uint64_t FitnessCache::quantize(const dim_t* pos)
+{
+    uint64_t hash = 0x9E3779B97F4A7C15ull;
+    for (size_t d = 0; d < mNumDims; d++)
+    {
+        const int64_t q = static_cast<int64_t>( floor((pos[d] - mMin[d]) * mInvEpsilon[d]) );
+        mKey[d] = q;
+
+        // splitmix64 style mixing of each coordinate
+        uint64_t z = hash ^ (static_cast<uint64_t>(q) + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2));
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        hash = z ^ (z >> 31);
+    }
+    return hash;
+}
+
+size_t FitnessCache::findSlot(const uint64_t hash) const
+{
+    size_t slot = hash & mMask;
+    while (true)
+    {
+        const uint32_t entry = mTable[slot];
+        if (entry == kEmpty)
+        {
+            return slot;
+        }
+        if (mHashes[entry] == hash && std::equal(mKey.begin(), mKey.end(), entryKey(entry)))
+        {
+            return slot;
+        }
+        slot = (slot + 1) & mMask;
+    }
+}
+
+bool FitnessCache::lookup(const dim_t* pos, prob_t* fitness)
+{
+    const uint64_t hash = quantize(pos);
+    const uint32_t entry = mTable[findSlot(hash)];
+    if (entry == kEmpty)
+    {
+        mNumMisses++;
+        return false;
+    }
+    mReferenced[entry] = 1;
+    *fitness = mFitness[entry];
+    mNumHits++;
+    return true;
+}
+
+void FitnessCache::insert(const dim_t* pos, const prob_t fitness)
+{
+    const uint64_t hash = quantize(pos);
+    size_t slot = findSlot(hash);
+    uint32_t entry = mTable[slot];
+    if (entry != kEmpty)
+    {
+        // Already cached
+        mFitness[entry] = fitness;
+        mReferenced[entry] = 1;
+        return;
+    }
+
+    if (mSize < mCapacity)
+    {
+        entry = static_cast<uint32_t>(mSize++);
+    }
+    else
+    {
+        entry = evict();
+
+        // Removing an entry can shift the probe sequence
+        slot = findSlot(hash);
+    }
+
+    std::copy(mKey.begin(), mKey.end(), mKeys.begin() + entry * mNumDims);
+    mHashes[entry] = hash;
+    mFitness[entry] = fitness;
+    mReferenced[entry] = 0;
+    mSlotOf[entry] = static_cast<uint32_t>(slot);
+    mTable[slot] = entry;
+}
+
+uint32_t FitnessCache::evict()
+{
+    // Give every recently used entry a second chance
+    while (mReferenced[mHand])
+    {
+        mReferenced[mHand] = 0;
+        mHand = (mHand + 1) % mCapacity;
+    }
+    const uint32_t victim = static_cast<uint32_t>(mHand);
+    mHand = (mHand + 1) % mCapacity;
+
+    eraseSlot(mSlotOf[victim]);
+    mNumEvictions++;
+    return victim;
+}
+
+void FitnessCache::eraseSlot(size_t slot)
+{
+    // Backward shift deletion, so that lookups never need tombstones
+    mTable[slot] = kEmpty;
+    size_t next = (slot + 1) & mMask;
+    while (mTable[next] != kEmpty)
+    {
+        const uint32_t entry = mTable[next];
+        const size_t home = mHashes[entry] & mMask;
+
+        // Move the entry back if slot lies cyclically in [home, next)
+        if (((next - home) & mMask) >= ((next - slot) & mMask))
+        {
+            mTable[slot] = entry;
+            mSlotOf[entry] = static_cast<uint32_t>(slot);
+            mTable[next] = kEmpty;
+            slot = next;
+        }
+        next = (next + 1) & mMask;
+    }
+}
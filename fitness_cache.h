@@ -0,0 +1,132 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * fitness_cache.h
+ */
+
+#ifndef FITNESS_CACHE_H_
+#define FITNESS_CACHE_H_
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+#include "dim.h"
+
+// Remembers the fitness of positions that were already evaluated.
+//
+// Positions are quantized on a grid with a spacing of epsilon[d] along
+// dimension d, and two positions in the same grid cell are considered
+// equal. The cache holds at most `capacity` entries; when it is full the
+// least recently used entries are evicted with the CLOCK algorithm. All
+// memory is allocated by the constructor.
+class FitnessCache
+{
+public:
+    // One grid spacing per dimension
+    FitnessCache(const std::vector<Dim>& dims, const std::vector<dim_t>& epsilon, const size_t capacity);
+
+    // Grid spacing of relativeEpsilon * (max - min) along each dimension
+    FitnessCache(const std::vector<Dim>& dims, const double relativeEpsilon, const size_t capacity);
+
+    // Returns true and sets *fitness if pos is in the cache
+    bool lookup(const dim_t* pos, prob_t* fitness);
+
+    void insert(const dim_t* pos, const prob_t fitness);
+
+    // Forget every entry (the counters are kept)
+    void clear();
+
+    size_t size() const
+    {
+        return mSize;
+    }
+
+    size_t capacity() const
+    {
+        return mCapacity;
+    }
+
+    unsigned long getNumHits() const
+    {
+        return mNumHits;
+    }
+
+    unsigned long getNumMisses() const
+    {
+        return mNumMisses;
+    }
+
+    unsigned long getNumEvictions() const
+    {
+        return mNumEvictions;
+    }
+
+    double hitRate() const
+    {
+        const unsigned long total = mNumHits + mNumMisses;
+        return (total > 0) ? (1.0 * mNumHits / total) : 0.0;
+    }
+
+private:
+    static const uint32_t kEmpty = 0xffffffffu;
+
+    void initialize(const size_t capacity);
+
+    // Quantize pos into mKey and return its hash
+    uint64_t quantize(const dim_t* pos);
+
+    // Slot of the hash table holding the current mKey, or of the empty slot
+    // where it would go
+    size_t findSlot(const uint64_t hash) const;
+
+    const int64_t* entryKey(const uint32_t entry) const
+    {
+        return &mKeys[entry * mNumDims];
+    }
+
+    // Remove an entry with the CLOCK algorithm and return its index
+    uint32_t evict();
+
+    void eraseSlot(size_t slot);
+
+    size_t                  mNumDims;
+    std::vector<dim_t>      mMin;
+    std::vector<dim_t>      mInvEpsilon;
+
+    // Entries
+    size_t                  mCapacity;
+    size_t                  mSize;
+    std::vector<int64_t>    mKeys;          // capacity x numDims grid coordinates
+    std::vector<uint64_t>   mHashes;
+    std::vector<prob_t>     mFitness;
+    std::vector<uint8_t>    mReferenced;    // CLOCK reference bits
+    std::vector<uint32_t>   mSlotOf;        // Hash table slot of each entry
+    size_t                  mHand;
+
+    // Open addressing hash table with linear probing, holding entry indices
+    std::vector<uint32_t>   mTable;
+    size_t                  mMask;
+
+    std::vector<int64_t>    mKey;           // Scratch for the key being looked up
+
+    unsigned long           mNumHits;
+    unsigned long           mNumMisses;
+    unsigned long           mNumEvictions;
+};
+
+#endif /* FITNESS_CACHE_H_ */
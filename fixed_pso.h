@@ -0,0 +1,296 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * fixed_pso.h
+ *
+ * PSO for problems whose number of dimensions is known at compile time.
+ * This header is included at the end of pso.h; include pso.h instead.
+ */
+
+#ifndef FIXED_PSO_H_
+#define FIXED_PSO_H_
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "counter_rng.h"
+#include "dim.h"
+#include "pso_parameters.h"
+
+// Calls f(0), f(1), ..., f(N-1) with the loop fully unrolled
+template<size_t N>
+struct Unroll
+{
+    template<class Function>
+    static void run(Function& f)
+    {
+        Unroll<N-1>::run(f);
+        f(N-1);
+    }
+};
+
+template<>
+struct Unroll<0>
+{
+    template<class Function>
+    static void run(Function&)
+    {
+    }
+};
+
+// A particle with N dimensions stored inline, so a std::vector of them is
+// one contiguous block and a particle never allocates.
+template<size_t N>
+class FixedParticle
+{
+public:
+    typedef std::array<dim_t, N> dvector;
+
+    FixedParticle()
+        : mFitness(-1.0 * std::numeric_limits<prob_t>::max()), mPBestFitness(mFitness)
+    {
+        mPos.fill(0.0);
+        mVel.fill(0.0);
+        mPBestPos.fill(0.0);
+    }
+
+    const dvector& getPosition() const
+    {
+        return mPos;
+    }
+
+    const dvector& getVelocity() const
+    {
+        return mVel;
+    }
+
+    double getFitness() const
+    {
+        return mFitness;
+    }
+
+    const dvector& getPBestPosition() const
+    {
+        return mPBestPos;
+    }
+
+    double getPBestFitness() const
+    {
+        return mPBestFitness;
+    }
+
+    // Place the particle at rest and forget its personal best
+    void reset(const dvector& pos)
+    {
+        mPos = pos;
+        mVel.fill(0.0);
+        mPBestPos = pos;
+        mFitness = -1.0 * std::numeric_limits<prob_t>::max();
+        mPBestFitness = mFitness;
+    }
+
+    void updateFitness(const prob_t newFitness)
+    {
+        mFitness = newFitness;
+
+        // Update the particles personal best if the new fitness is better
+        if (newFitness > mPBestFitness)
+        {
+            mPBestFitness = newFitness;
+            mPBestPos = mPos;
+        }
+    }
+
+    // Same update as the kernels in update_kernel.h, unrolled over the N
+    // dimensions. maxVel holds the velocity bound of each dimension.
+    void updatePosition(const dvector& guide, const std::array<Dim, N>& dim, const dvector& maxVel,
+                        const double C1, const double C2, const dvector& r1, const dvector& r2,
+                        const double inertiaWeight)
+    {
+        Updater updater = { this, &guide, &dim, &maxVel, &r1, &r2, C1, C2, inertiaWeight };
+        Unroll<N>::run(updater);
+    }
+
+    size_t size() const
+    {
+        return N;
+    }
+
+private:
+    struct Updater
+    {
+        FixedParticle*                  p;
+        const dvector*                  guide;
+        const std::array<Dim, N>*       dim;
+        const dvector*                  maxVel;
+        const dvector*                  r1;
+        const dvector*                  r2;
+        double                          c1;
+        double                          c2;
+        double                          inertiaWeight;
+
+        void operator()(const size_t i)
+        {
+            const dim_t x = p->mPos[i];
+            dim_t vel = inertiaWeight * p->mVel[i];
+            vel += c1 * (*r1)[i] * (p->mPBestPos[i] - x);
+            vel += c2 * (*r2)[i] * ((*guide)[i] - x);
+            vel = (vel == 0.0) ? p->mVel[i] + 2.0 * (*r1)[i] : vel;
+            vel = std::min(std::max(vel, -(*maxVel)[i]), (*maxVel)[i]);
+            p->mVel[i] = vel;
+            p->mPos[i] = std::min(std::max(x + vel, (*dim)[i].min()), (*dim)[i].max());
+        }
+    };
+
+    dvector     mPos;
+    dvector     mVel;
+    prob_t      mFitness;
+
+    // The particles best position
+    dvector     mPBestPos;
+    prob_t      mPBestFitness;
+};
+
+// Number of dimensions fixed at compile time. The fitness function is
+// called as
+//   void operator()(const std::vector< FixedParticle<N> >&, std::vector<double>*)
+// The particles are always double precision.
+template<class FitnessFunction, size_t N, class Scalar>
+class PSO
+{
+    static_assert(std::is_same<Scalar, dim_t>::value, "fixed-dimension PSO only supports dim_t coordinates");
+
+public:
+    typedef FixedParticle<N> particle_type;
+
+    PSO(const unsigned int numParticles, const std::array<Dim, N>& dim,
+        const gslseed_t seed, FitnessFunction& fitnessFunction, const unsigned int maxIterations)
+        : mNumParticles(numParticles), mParticles(numParticles), mDim(dim), mRng(seed),
+        mFitnessFunction(fitnessFunction), mMaxIterations(maxIterations), mIteration(0),
+        mFitnesses(numParticles), mRun(0)
+    {
+        for (size_t d = 0; d < N; d++)
+        {
+            mMaxVel[d] = maxVelocity(mDim[d]);
+        }
+    }
+
+    unsigned int getNumParticles() const
+    {
+        return mNumParticles;
+    }
+
+    const particle_type& iterate()
+    {
+        initialize();
+        do
+        {
+            step();
+        }
+        while(mIteration < mMaxIterations);
+
+        return mGBest;
+    }
+
+    void initialize()
+    {
+        mRun++;
+        typename particle_type::dvector pos;
+        for (unsigned int i = 0; i < mNumParticles; i++)
+        {
+            mRng.fillUniform( pos.data(), N, 0, i, stream(CounterRNG::kInitStream) );
+            for (size_t d = 0; d < N; d++)
+            {
+                pos[d] = mDim[d].min() + pos[d] * (mDim[d].max() - mDim[d].min());
+            }
+            mParticles[i].reset(pos);
+        }
+        mIteration = 0;
+    }
+
+    void step()
+    {
+        // Evaluate the fitness/objective function
+        mFitnessFunction(mParticles, &mFitnesses);
+
+        unsigned int best = 0;
+        for (unsigned int i = 0; i < mNumParticles; i++)
+        {
+            mParticles[i].updateFitness( mFitnesses[i] );
+            if (mParticles[i].getPBestFitness() > mParticles[best].getPBestFitness())
+            {
+                best = i;
+            }
+        }
+
+        // Choose the particle with the best fitness value of all the particles as the gBest
+        mGBest.reset( mParticles[best].getPBestPosition() );
+        mGBest.updateFitness( mParticles[best].getPBestFitness() );
+
+        const double inertiaWeight = computeInertiaWeight(mIteration, mMaxIterations);
+        typename particle_type::dvector r1, r2;
+        for (unsigned int i = 0; i < mNumParticles; i++)
+        {
+            mRng.fillUniform( r1.data(), N, mIteration, i, stream(CounterRNG::kCognitiveStream) );
+            mRng.fillUniform( r2.data(), N, mIteration, i, stream(CounterRNG::kSocialStream) );
+            mParticles[i].updatePosition( mGBest.getPosition(), mDim, mMaxVel, kCognitiveWeight, kSocialWeight,
+                                          r1, r2, inertiaWeight );
+        }
+
+        mIteration++;
+    }
+
+    unsigned int getIteration() const
+    {
+        return mIteration;
+    }
+
+    const particle_type& getGBest() const
+    {
+        return mGBest;
+    }
+
+protected:
+    PSO(const PSO&);
+    void operator=(const PSO&);
+
+    uint32_t stream(const CounterRNG::Stream s) const
+    {
+        return (mRun << 8) | s;
+    }
+
+private:
+    unsigned int                    mNumParticles;
+    std::vector<particle_type>      mParticles;
+    particle_type                   mGBest;
+    std::array<Dim, N>              mDim;
+    typename particle_type::dvector mMaxVel;
+
+    CounterRNG                      mRng;
+
+    FitnessFunction&                mFitnessFunction;
+    unsigned int                    mMaxIterations;
+    unsigned int                    mIteration;
+    std::vector<double>             mFitnesses;
+    uint32_t                        mRun;
+};
+
+#endif /* FIXED_PSO_H_ */
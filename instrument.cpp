@@ -0,0 +1,179 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * instrument.cpp
+ */
+#include "instrument.h"
+
+#include <cassert>
+#include <ctime>
+#include <iomanip>
+
+const char* phaseName(const Phase phase)
+{
+    static const char* const names[kNumPhases] =
+        { "evaluate", "pbest", "gbest", "topology", "move", "stopping", "output", "count" };
+    return names[phase];
+}
+
+std::ostream& operator<<(std::ostream& out, const PSOStats& stats)
+{
+    double total = 0.0;
+    for (int p = 0; p < kNumPhases; p++)
+    {
+        total += stats.phases[p].wallSeconds;
+    }
+
+    out << std::left << std::setw(10) << "phase" << std::right << std::setw(12) << "wall (s)"
+        << std::setw(12) << "cpu (s)" << std::setw(8) << "%" << "\n";
+    for (int p = 0; p < kNumPhases; p++)
+    {
+        const PhaseStats& phase = stats.phases[p];
+        out << std::left << std::setw(10) << phaseName(static_cast<Phase>(p)) << std::right << std::fixed
+            << std::setprecision(6) << std::setw(12) << phase.wallSeconds << std::setw(12) << phase.cpuSeconds
+            << std::setprecision(1) << std::setw(8) << (total > 0.0 ? 100.0 * phase.wallSeconds / total : 0.0)
+            << "\n";
+    }
+    out.unsetf(std::ios::fixed);
+    out << std::setprecision(6);
+    out << "iterations " << stats.numIterations << ", evaluations " << stats.numEvaluations
+        << ", coordinate updates " << stats.updates.numCoordinates << "\n";
+    out << "kick rate " << stats.kickRate() << ", velocity clamp rate " << stats.velocityClampRate()
+        << ", position clamp rate " << stats.positionClampRate() << "\n";
+    return out;
+}
+
+#ifdef PSO_INSTRUMENT
+
+Instrumentation::Instrumentation()
+    : mCounts(1), mTraceCapacity(0), mNumDropped(0), mOrigin(wallNow())
+{
+    reset();
+}
+
+void Instrumentation::reset()
+{
+    for (int p = 0; p < kNumPhases; p++)
+    {
+        mPhases[p] = PhaseStats();
+    }
+    for (size_t t = 0; t < mCounts.size(); t++)
+    {
+        mCounts[t].counts = UpdateCounts();
+    }
+    mEvents.clear();
+    mNumDropped = 0;
+}
+
+void Instrumentation::resize(const unsigned int numThreads)
+{
+    // Keep what was counted so far
+    UpdateCounts sum = UpdateCounts();
+    for (size_t t = 0; t < mCounts.size(); t++)
+    {
+        sum.numCoordinates += mCounts[t].counts.numCoordinates;
+        sum.numKicks += mCounts[t].counts.numKicks;
+        sum.numVelocityClamps += mCounts[t].counts.numVelocityClamps;
+        sum.numPositionClamps += mCounts[t].counts.numPositionClamps;
+    }
+    mCounts.resize(numThreads);
+    mCounts[0].counts = sum;
+}
+
+void Instrumentation::setTraceCapacity(const size_t numEvents)
+{
+    mTraceCapacity = numEvents;
+    mEvents.reserve(numEvents);
+}
+
+void Instrumentation::countUpdate(const UpdateArgs& args, const size_t numDims, const unsigned int thread)
+{
+    assert(thread < mCounts.size());
+    ::countUpdate(args, numDims, &mCounts[thread].counts);
+}
+
+void Instrumentation::countUpdate(const FloatUpdateArgs& args, const size_t numDims, const unsigned int thread)
+{
+    assert(thread < mCounts.size());
+    ::countUpdate(args, numDims, &mCounts[thread].counts);
+}
+
+void Instrumentation::addPhase(const Phase phase, const uint32_t iteration, const int64_t startNs,
+                               const int64_t wallNs, const int64_t cpuNs)
+{
+    mPhases[phase].wallSeconds += 1e-9 * wallNs;
+    mPhases[phase].cpuSeconds += 1e-9 * cpuNs;
+    mPhases[phase].count++;
+
+    if (mEvents.size() < mTraceCapacity)
+    {
+        const TraceEvent event = { startNs, wallNs, iteration, phase };
+        mEvents.push_back(event);
+    }
+    else if (mTraceCapacity > 0)
+    {
+        mNumDropped++;
+    }
+}
+
+void Instrumentation::getStats(PSOStats* stats) const
+{
+    *stats = PSOStats();
+    for (int p = 0; p < kNumPhases; p++)
+    {
+        stats->phases[p] = mPhases[p];
+    }
+    for (size_t t = 0; t < mCounts.size(); t++)
+    {
+        stats->updates.numCoordinates += mCounts[t].counts.numCoordinates;
+        stats->updates.numKicks += mCounts[t].counts.numKicks;
+        stats->updates.numVelocityClamps += mCounts[t].counts.numVelocityClamps;
+        stats->updates.numPositionClamps += mCounts[t].counts.numPositionClamps;
+    }
+}
+
+void Instrumentation::writeChromeTrace(std::ostream& out) const
+{
+    // Complete ("X") events, with times in microseconds
+    const std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+    for (size_t e = 0; e < mEvents.size(); e++)
+    {
+        const TraceEvent& event = mEvents[e];
+        out << (e ? ",\n" : "\n") << "{\"name\":\"" << phaseName(event.phase) << "\",\"cat\":\"pso\",\"ph\":\"X\""
+            << ",\"ts\":" << 1e-3 * (event.startNs - mOrigin) << ",\"dur\":" << 1e-3 * event.wallNs
+            << ",\"pid\":1,\"tid\":1,\"args\":{\"iteration\":" << event.iteration << "}}";
+    }
+    out << "\n],\"otherData\":{\"droppedEvents\":" << mNumDropped << "}}\n";
+    out.flags(flags);
+}
+
+int64_t Instrumentation::wallNow()
+{
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return 1000000000ll * t.tv_sec + t.tv_nsec;
+}
+
+int64_t Instrumentation::cpuNow()
+{
+    timespec t;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+    return 1000000000ll * t.tv_sec + t.tv_nsec;
+}
+
+#endif // PSO_INSTRUMENT
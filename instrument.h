@@ -0,0 +1,207 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * instrument.h
+ */
+
+#ifndef INSTRUMENT_H_
+#define INSTRUMENT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "aligned.h"
+#include "update_kernel.h"
+
+// Optional instrumentation of PSO::step(). Compile with -DPSO_INSTRUMENT
+// to time each phase of an iteration and count what the velocity update
+// does. Without it the hooks compile to nothing and the statistics stay
+// zero.
+
+enum Phase
+{
+    kPhaseEvaluate = 0, // Fitness function, cache lookups included
+    kPhasePBest,        // Personal best updates and the best of each chunk
+    kPhaseGBest,        // Reduction of the chunk bests to the global best
+    kPhaseTopology,     // Rewiring and neighbourhood bests
+    kPhaseMove,         // Velocity and position updates
+    kPhaseStopping,     // Stopping criteria
+    kPhaseOutput,       // History, trajectory and checkpoints
+    kPhaseCount,        // Replay of the updates for the counts, apart from the moves
+    kNumPhases
+};
+
+const char* phaseName(const Phase phase);
+
+struct PhaseStats
+{
+    double          wallSeconds;
+    double          cpuSeconds; // Of the whole process, so parallel phases count every thread
+    unsigned long   count;
+};
+
+struct PSOStats
+{
+    PhaseStats      phases[kNumPhases];
+    unsigned long   numIterations;
+    unsigned long   numEvaluations;
+    UpdateCounts    updates;
+
+    // Fractions of the updated coordinates
+    double kickRate() const
+    {
+        return updates.numCoordinates ? 1.0 * updates.numKicks / updates.numCoordinates : 0.0;
+    }
+    double velocityClampRate() const
+    {
+        return updates.numCoordinates ? 1.0 * updates.numVelocityClamps / updates.numCoordinates : 0.0;
+    }
+    double positionClampRate() const
+    {
+        return updates.numCoordinates ? 1.0 * updates.numPositionClamps / updates.numCoordinates : 0.0;
+    }
+};
+
+// Print one line per phase and the update rates
+std::ostream& operator<<(std::ostream& out, const PSOStats& stats);
+
+#ifdef PSO_INSTRUMENT
+
+class Instrumentation
+{
+public:
+    Instrumentation();
+
+    // Clear the statistics and the trace
+    void reset();
+
+    // Number of threads that may call countUpdate() at once
+    void resize(const unsigned int numThreads);
+
+    // Whether the updates are counted, so that PSO replays them
+    bool counting() const
+    {
+        return true;
+    }
+
+    // Keep up to this many phase events for writeChromeTrace() (0, the
+    // default, keeps none). Later events are dropped.
+    void setTraceCapacity(const size_t numEvents);
+
+    // From the thread with this index in the pool sized for by resize()
+    void countUpdate(const UpdateArgs& args, const size_t numDims, const unsigned int thread);
+    void countUpdate(const FloatUpdateArgs& args, const size_t numDims, const unsigned int thread);
+
+    void addPhase(const Phase phase, const uint32_t iteration, const int64_t startNs,
+                  const int64_t wallNs, const int64_t cpuNs);
+
+    // Phase statistics and the sum of the update counts of all threads
+    void getStats(PSOStats* stats) const;
+
+    // The events as a Chrome trace (chrome://tracing, Perfetto)
+    void writeChromeTrace(std::ostream& out) const;
+
+    static int64_t wallNow();
+    static int64_t cpuNow();
+
+private:
+    struct TraceEvent
+    {
+        int64_t     startNs;
+        int64_t     wallNs;
+        uint32_t    iteration;
+        Phase       phase;
+    };
+
+    // One cache line per thread so that counting doesn't share lines
+    struct alignas(kSwarmAlignment) ThreadCounts
+    {
+        UpdateCounts    counts;
+    };
+
+    PhaseStats                  mPhases[kNumPhases];
+    AlignedBuffer<ThreadCounts> mCounts;
+    std::vector<TraceEvent>     mEvents;
+    size_t                      mTraceCapacity;
+    unsigned long               mNumDropped;
+    int64_t                     mOrigin;
+};
+
+// Adds the time between its construction and destruction to a phase
+class PhaseTimer
+{
+public:
+    PhaseTimer(Instrumentation& instrumentation, const Phase phase, const uint32_t iteration)
+        : mInstrumentation(instrumentation), mPhase(phase), mIteration(iteration),
+        mStartNs(Instrumentation::wallNow()), mStartCpuNs(Instrumentation::cpuNow())
+    {
+    }
+
+    ~PhaseTimer()
+    {
+        mInstrumentation.addPhase(mPhase, mIteration, mStartNs, Instrumentation::wallNow() - mStartNs,
+                                  Instrumentation::cpuNow() - mStartCpuNs);
+    }
+
+private:
+    PhaseTimer(const PhaseTimer&);
+    void operator=(const PhaseTimer&);
+
+    Instrumentation&    mInstrumentation;
+    Phase               mPhase;
+    uint32_t            mIteration;
+    int64_t             mStartNs;
+    int64_t             mStartCpuNs;
+};
+
+#define PSO_PHASE(instrumentation, phase, iteration) PhaseTimer psoPhaseTimer((instrumentation), (phase), (iteration))
+#define PSO_COUNT_UPDATE(instrumentation, args, numDims, thread) (instrumentation).countUpdate((args), (numDims), (thread))
+
+#else
+
+// Compiled out: nothing is recorded
+class Instrumentation
+{
+public:
+    void reset() {}
+    void resize(const unsigned int) {}
+    void setTraceCapacity(const size_t) {}
+
+    bool counting() const
+    {
+        return false;
+    }
+
+    void getStats(PSOStats* stats) const
+    {
+        *stats = PSOStats();
+    }
+
+    void writeChromeTrace(std::ostream& out) const
+    {
+        out << "{\"traceEvents\":[]}\n";
+    }
+};
+
+#define PSO_PHASE(instrumentation, phase, iteration) ((void)0)
+#define PSO_COUNT_UPDATE(instrumentation, args, numDims, thread) ((void)0)
+
+#endif // PSO_INSTRUMENT
+
+#endif /* INSTRUMENT_H_ */
@@ -0,0 +1,371 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * islands.h
+ */
+
+#ifndef ISLANDS_H_
+#define ISLANDS_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "dim.h"
+#include "pso.h"
+#include "stopping.h"
+#include "swarm.h"
+
+// Which islands send their best particles to which
+enum IslandTopology
+{
+    kIslandRing = 0,        // Island i sends to island i+1
+    kIslandFullyConnected   // Every island sends to every other one
+};
+
+struct IslandOptions
+{
+    IslandOptions()
+        : migrationInterval(10), numMigrants(1), topology(kIslandRing)
+    {
+    }
+
+    unsigned int    migrationInterval;  // Iterations between migrations (0 = never)
+    unsigned int    numMigrants;        // Best particles sent by an island per migration
+    IslandTopology  topology;
+};
+
+// Lock-free single-producer single-consumer queue of migrations between two
+// islands. Each slot holds the positions and fitnesses of one batch of
+// migrants. A sender that finds the queue full drops its batch: the
+// receiver hasn't caught up with the previous ones yet, and nobody waits.
+class MigrantMailbox
+{
+public:
+    MigrantMailbox(const size_t numDims, const size_t numMigrants, const size_t numSlots = 4)
+        : mNumDims(numDims), mNumMigrants(numMigrants), mNumSlots(numSlots),
+        mSlots(numSlots * numMigrants * (numDims + 1)), mHead(0), mTail(0)
+    {
+    }
+
+    // Batch to fill before calling send(), or 0 if the queue is full.
+    // Positions first, numMigrants x numDims, then numMigrants fitnesses.
+    double* reserve()
+    {
+        const size_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail - mHead.load(std::memory_order_acquire) == mNumSlots)
+        {
+            return 0;
+        }
+        return slot(tail);
+    }
+
+    void send()
+    {
+        mTail.store(mTail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Oldest batch received, or 0 if there is none. Call pop() when done.
+    const double* peek()
+    {
+        const size_t head = mHead.load(std::memory_order_relaxed);
+        if (head == mTail.load(std::memory_order_acquire))
+        {
+            return 0;
+        }
+        return slot(head);
+    }
+
+    void pop()
+    {
+        mHead.store(mHead.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Drop every batch. Only while neither side is using the mailbox.
+    void clear()
+    {
+        mHead.store(0, std::memory_order_relaxed);
+        mTail.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    MigrantMailbox(const MigrantMailbox&);
+    void operator=(const MigrantMailbox&);
+
+    double* slot(const size_t n)
+    {
+        return mSlots.data() + (n % mNumSlots) * mNumMigrants * (mNumDims + 1);
+    }
+
+    size_t                  mNumDims;
+    size_t                  mNumMigrants;
+    size_t                  mNumSlots;
+    std::vector<double>     mSlots;
+
+    // Counters of batches received and sent, on separate cache lines
+    alignas(64) std::atomic<size_t> mHead;
+    alignas(64) std::atomic<size_t> mTail;
+};
+
+// Island model: several independent PSO swarms, each run on its own thread
+// with its own seed, that send copies of their best particles to their
+// neighbours every migrationInterval iterations. An arriving particle
+// replaces one of the worst particles of the receiving swarm. Islands don't
+// wait for each other, so a migration arrives whenever the receiver next
+// checks its mailboxes and the results depend on thread timing.
+//
+// The fitness function is shared by all the islands and is called from
+// their threads at the same time. A run ends when every island has run
+// maxIterations or stopped on its own stopping criteria; an island that
+// reaches the target fitness stops all the others.
+template<class FitnessFunction>
+class IslandModel
+{
+public:
+    typedef PSO<FitnessFunction> Island;
+
+    IslandModel(const unsigned int numIslands, const unsigned int particlesPerIsland,
+                const std::vector<Dim>& dim, const gslseed_t seed, FitnessFunction& fitnessFunction,
+                const unsigned int maxIterations, const IslandOptions& options = IslandOptions())
+        : mNumIslands(numIslands), mParticlesPerIsland(particlesPerIsland), mDim(dim), mSeed(seed),
+        mFitnessFunction(fitnessFunction), mMaxIterations(maxIterations), mOptions(options),
+        mIslands(numIslands), mStopAll(false), mBest(0)
+    {
+        assert(numIslands > 0);
+        assert(mOptions.numMigrants <= particlesPerIsland);
+
+        // One mailbox per directed edge of the topology
+        for (unsigned int from = 0; from < mNumIslands; from++)
+        {
+            for (unsigned int to = 0; to < mNumIslands; to++)
+            {
+                if (from != to && connected(from, to))
+                {
+                    Edge edge;
+                    edge.from = from;
+                    edge.to = to;
+                    edge.mailbox.reset(new MigrantMailbox(mDim.size(), mOptions.numMigrants));
+                    mEdges.push_back(std::move(edge));
+                }
+            }
+        }
+    }
+
+    unsigned int getNumIslands() const
+    {
+        return mNumIslands;
+    }
+
+    // Applied to every island
+    void setStoppingCriteria(const StoppingCriteria& criteria)
+    {
+        mStopping = criteria;
+    }
+
+    // Run every island to the end on its own thread and return the best
+    // global best found
+    const Particle& iterate()
+    {
+        mStopAll = false;
+
+        // The last migration of the previous run was never received, and
+        // its fitnesses may not be those of this run
+        for (size_t e = 0; e < mEdges.size(); e++)
+        {
+            mEdges[e].mailbox->clear();
+        }
+
+        std::vector<std::thread> threads;
+        for (unsigned int i = 0; i < mNumIslands; i++)
+        {
+            threads.push_back(std::thread(&IslandModel::runIsland, this, i));
+        }
+        for (unsigned int i = 0; i < mNumIslands; i++)
+        {
+            threads[i].join();
+        }
+
+        mBest = 0;
+        for (unsigned int i = 1; i < mNumIslands; i++)
+        {
+            if (mIslands[i]->getGBest().getPBestFitness() > mIslands[mBest]->getGBest().getPBestFitness())
+            {
+                mBest = i;
+            }
+        }
+        return mIslands[mBest]->getGBest();
+    }
+
+    // Valid once iterate() has been called
+    const Island& getIsland(const unsigned int i) const
+    {
+        return *mIslands[i];
+    }
+
+    const Particle& getGBest() const
+    {
+        return mIslands[mBest]->getGBest();
+    }
+
+    // Total fitness evaluations of the last run
+    unsigned long getNumEvaluations() const
+    {
+        unsigned long n = 0;
+        for (unsigned int i = 0; i < mNumIslands; i++)
+        {
+            n += mIslands[i]->getNumEvaluations();
+        }
+        return n;
+    }
+
+private:
+    IslandModel(const IslandModel&);
+    void operator=(const IslandModel&);
+
+    struct Edge
+    {
+        unsigned int                    from;
+        unsigned int                    to;
+        std::unique_ptr<MigrantMailbox> mailbox;
+    };
+
+    bool connected(const unsigned int from, const unsigned int to) const
+    {
+        switch (mOptions.topology)
+        {
+        case kIslandRing:
+            return to == (from + 1) % mNumIslands;
+        case kIslandFullyConnected:
+            return true;
+        }
+        return false;
+    }
+
+    // Seed of an island: consecutive seeds are scrambled so that the
+    // islands don't share streams with runs of other seeds
+    gslseed_t islandSeed(const unsigned int i) const
+    {
+        uint64_t z = mSeed + (i + 1) * 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    void runIsland(const unsigned int i)
+    {
+        // Created on the island's own thread, so on a NUMA machine its
+        // swarm lives in the memory of the node that runs it
+        if (!mIslands[i])
+        {
+            mIslands[i].reset(new Island(mParticlesPerIsland, mDim, islandSeed(i), mFitnessFunction, mMaxIterations));
+        }
+        Island& island = *mIslands[i];
+        island.setStoppingCriteria(mStopping);
+
+        std::vector<unsigned int> order(mParticlesPerIsland);
+        island.initialize();
+        do
+        {
+            island.step();
+            if (mOptions.migrationInterval > 0 && island.getIteration() % mOptions.migrationInterval == 0)
+            {
+                migrate(i, &order);
+            }
+            if (island.getStopReason() == kStopTargetFitness)
+            {
+                mStopAll = true;
+            }
+        }
+        while (island.getStopReason() == kStopNotStopped && !mStopAll);
+    }
+
+    // Send the best particles of island i to its neighbours, then let the
+    // particles that arrived replace its worst ones
+    void migrate(const unsigned int i, std::vector<unsigned int>* order)
+    {
+        Island& island = *mIslands[i];
+        const Swarm& swarm = island.getSwarm();
+        const prob_t* fitness = swarm.pbestFitnesses();
+        const size_t numDims = mDim.size();
+        const size_t k = mOptions.numMigrants;
+
+        // Indices sorted by personal best fitness, best first
+        for (unsigned int p = 0; p < order->size(); p++)
+        {
+            (*order)[p] = p;
+        }
+        std::sort(order->begin(), order->end(),
+                  [fitness](const unsigned int a, const unsigned int b) { return fitness[a] > fitness[b]; });
+
+        for (size_t e = 0; e < mEdges.size(); e++)
+        {
+            if (mEdges[e].from != i)
+            {
+                continue;
+            }
+            double* batch = mEdges[e].mailbox->reserve();
+            if (!batch)
+            {
+                continue;
+            }
+            for (size_t m = 0; m < k; m++)
+            {
+                const dim_t* pbest = swarm.pbestPosition((*order)[m]);
+                std::copy(pbest, pbest + numDims, batch + m * numDims);
+                batch[k * numDims + m] = fitness[(*order)[m]];
+            }
+            mEdges[e].mailbox->send();
+        }
+
+        // Newcomers replace the worst particles, worst first
+        size_t worst = order->size();
+        for (size_t e = 0; e < mEdges.size(); e++)
+        {
+            if (mEdges[e].to != i)
+            {
+                continue;
+            }
+            while (const double* batch = mEdges[e].mailbox->peek())
+            {
+                for (size_t m = 0; m < k && worst > k; m++)
+                {
+                    island.setParticle((*order)[--worst], batch + m * numDims, batch[k * numDims + m]);
+                }
+                mEdges[e].mailbox->pop();
+            }
+        }
+    }
+
+    unsigned int                    mNumIslands;
+    unsigned int                    mParticlesPerIsland;
+    std::vector<Dim>                mDim;
+    gslseed_t                       mSeed;
+    FitnessFunction&                mFitnessFunction;
+    unsigned int                    mMaxIterations;
+    IslandOptions                   mOptions;
+    StoppingCriteria                mStopping;
+
+    std::vector< std::unique_ptr<Island> >  mIslands;
+    std::vector<Edge>               mEdges;
+    std::atomic<bool>               mStopAll;
+    unsigned int                    mBest;
+};
+
+#endif /* ISLANDS_H_ */
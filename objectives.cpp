@@ -0,0 +1,223 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * objectives.cpp
+ */
+#include "objectives.h"
+
+#include <cmath>
+
+// Each function is written once for both coordinate types. Float
+// coordinates are widened to double before any arithmetic.
+
+const char* Sphere::name()
+{
+    return "sphere";
+}
+
+Dim Sphere::bounds()
+{
+    return Dim(-5.12, 5.12);
+}
+
+template<class T>
+static double sphereValue(const T* x, const size_t n)
+{
+    double sum = 0.0;
+    for (size_t d = 0; d < n; d++)
+    {
+        const double xd = x[d];
+        sum += xd * xd;
+    }
+    return sum;
+}
+
+double Sphere::value(const dim_t* x, const size_t n)
+{
+    return sphereValue(x, n);
+}
+
+double Sphere::value(const float* x, const size_t n)
+{
+    return sphereValue(x, n);
+}
+
+const char* Rastrigin::name()
+{
+    return "rastrigin";
+}
+
+Dim Rastrigin::bounds()
+{
+    return Dim(-5.12, 5.12);
+}
+
+template<class T>
+static double rastriginValue(const T* x, const size_t n)
+{
+    double sum = 10.0 * n;
+    for (size_t d = 0; d < n; d++)
+    {
+        const double xd = x[d];
+        sum += xd * xd - 10.0 * cos(2.0 * M_PI * xd);
+    }
+    return sum;
+}
+
+double Rastrigin::value(const dim_t* x, const size_t n)
+{
+    return rastriginValue(x, n);
+}
+
+double Rastrigin::value(const float* x, const size_t n)
+{
+    return rastriginValue(x, n);
+}
+
+const char* Rosenbrock::name()
+{
+    return "rosenbrock";
+}
+
+Dim Rosenbrock::bounds()
+{
+    return Dim(-5.0, 10.0);
+}
+
+template<class T>
+static double rosenbrockValue(const T* x, const size_t n)
+{
+    double sum = 0.0;
+    for (size_t d = 0; d + 1 < n; d++)
+    {
+        const double xd = x[d];
+        const double a = x[d+1] - xd * xd;
+        const double b = 1.0 - xd;
+        sum += 100.0 * a * a + b * b;
+    }
+    return sum;
+}
+
+double Rosenbrock::value(const dim_t* x, const size_t n)
+{
+    return rosenbrockValue(x, n);
+}
+
+double Rosenbrock::value(const float* x, const size_t n)
+{
+    return rosenbrockValue(x, n);
+}
+
+const char* Ackley::name()
+{
+    return "ackley";
+}
+
+Dim Ackley::bounds()
+{
+    return Dim(-32.768, 32.768);
+}
+
+template<class T>
+static double ackleyValue(const T* x, const size_t n)
+{
+    double sumSquares = 0.0;
+    double sumCos = 0.0;
+    for (size_t d = 0; d < n; d++)
+    {
+        const double xd = x[d];
+        sumSquares += xd * xd;
+        sumCos += cos(2.0 * M_PI * xd);
+    }
+    return 20.0 + M_E - 20.0 * exp(-0.2 * sqrt(sumSquares / n)) - exp(sumCos / n);
+}
+
+double Ackley::value(const dim_t* x, const size_t n)
+{
+    return ackleyValue(x, n);
+}
+
+double Ackley::value(const float* x, const size_t n)
+{
+    return ackleyValue(x, n);
+}
+
+const char* Griewank::name()
+{
+    return "griewank";
+}
+
+Dim Griewank::bounds()
+{
+    return Dim(-600.0, 600.0);
+}
+
+template<class T>
+static double griewankValue(const T* x, const size_t n)
+{
+    double sum = 0.0;
+    double product = 1.0;
+    for (size_t d = 0; d < n; d++)
+    {
+        const double xd = x[d];
+        sum += xd * xd;
+        product *= cos(xd / sqrt(d + 1.0));
+    }
+    return 1.0 + sum / 4000.0 - product;
+}
+
+double Griewank::value(const dim_t* x, const size_t n)
+{
+    return griewankValue(x, n);
+}
+
+double Griewank::value(const float* x, const size_t n)
+{
+    return griewankValue(x, n);
+}
+
+const char* Schwefel::name()
+{
+    return "schwefel";
+}
+
+Dim Schwefel::bounds()
+{
+    return Dim(-500.0, 500.0);
+}
+
+template<class T>
+static double schwefelValue(const T* x, const size_t n)
+{
+    double sum = 418.9828872724338 * n;
+    for (size_t d = 0; d < n; d++)
+    {
+        const double xd = x[d];
+        sum -= xd * sin(sqrt(fabs(xd)));
+    }
+    return sum;
+}
+
+double Schwefel::value(const dim_t* x, const size_t n)
+{
+    return schwefelValue(x, n);
+}
+
+double Schwefel::value(const float* x, const size_t n)
+{
+    return schwefelValue(x, n);
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * objectives.h
+ */
+
+#ifndef OBJECTIVES_H_
+#define OBJECTIVES_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "dim.h"
+#include "particle.h"
+#include "swarm.h"
+
+// Standard benchmark functions of any number of dimensions. Each one is
+// written for minimization and has a global minimum value of 0.
+//
+// name()      Short name, as used on the benchmark command line
+// bounds()    The usual search range, the same along every dimension
+// value(x, n) The function at x[0..n), for double or float coordinates
+
+struct Sphere
+{
+    static const char* name();
+    static Dim bounds();
+    static double value(const dim_t* x, const size_t n);
+    static double value(const float* x, const size_t n);
+};
+
+struct Rastrigin
+{
+    static const char* name();
+    static Dim bounds();
+    static double value(const dim_t* x, const size_t n);
+    static double value(const float* x, const size_t n);
+};
+
+struct Rosenbrock
+{
+    static const char* name();
+    static Dim bounds();
+    static double value(const dim_t* x, const size_t n);
+    static double value(const float* x, const size_t n);
+};
+
+struct Ackley
+{
+    static const char* name();
+    static Dim bounds();
+    static double value(const dim_t* x, const size_t n);
+    static double value(const float* x, const size_t n);
+};
+
+struct Griewank
+{
+    static const char* name();
+    static Dim bounds();
+    static double value(const dim_t* x, const size_t n);
+    static double value(const float* x, const size_t n);
+};
+
+struct Schwefel
+{
+    static const char* name();
+    static Dim bounds();
+    static double value(const dim_t* x, const size_t n);
+    static double value(const float* x, const size_t n);
+};
+
+// Fitness function for PSO built from one of the functions above. PSO
+// maximizes, so the fitness is minus the function value. Works with both
+// Swarm and FloatSwarm.
+template<class Function>
+class Objective
+{
+public:
+    template<class T>
+    void operator()(const BasicSwarm<T>& particleSet, std::vector<double>* particleFitnesses) const
+    {
+        for (size_t i = 0; i < particleSet.size(); i++)
+        {
+            (*particleFitnesses)[i] = -Function::value(particleSet.position(i), particleSet.numDims());
+        }
+    }
+
+    template<class T>
+    double operator()(const BasicParticle<T>& p) const
+    {
+        return -Function::value(p.getPosition().data(), p.size());
+    }
+};
+
+#endif /* OBJECTIVES_H_ */
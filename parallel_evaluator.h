@@ -0,0 +1,86 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * parallel_evaluator.h
+ */
+
+#ifndef PARALLEL_EVALUATOR_H_
+#define PARALLEL_EVALUATOR_H_
+
+#include <cassert>
+#include <vector>
+
+#include "particle.h"
+#include "swarm.h"
+#include "thread_pool.h"
+
+// Turns a per-particle objective, double operator()(const Particle&) const,
+// into the batch fitness function expected by PSO, and evaluates the
+// particles on a ThreadPool. The objective is called concurrently from
+// several threads, so it must not modify shared state.
+//
+//   AckleyFunction ackley;
+//   ThreadPool pool(8);
+//   ParallelEvaluator<AckleyFunction> ff(ackley, pool);
+//   PSO< ParallelEvaluator<AckleyFunction> > pso(numParticles, dims, seed, ff, maxIterations);
+//
+// Batch fitness functions keep working with PSO directly.
+template<class Objective>
+class ParallelEvaluator
+{
+public:
+    // chunkSize is the number of particles a thread takes at a time. Use 1
+    // for expensive objectives and larger values for cheap ones.
+    ParallelEvaluator(const Objective& objective, ThreadPool& pool, const size_t chunkSize = 1)
+        : mObjective(objective), mPool(pool), mChunkSize(chunkSize)
+    {
+    }
+
+    void operator()(const Swarm& particleSet, std::vector<double>* particleFitnesses)
+    {
+        assert(particleFitnesses->size() >= particleSet.size());
+        Range range = { &mObjective, &particleSet, particleFitnesses };
+        mPool.parallelFor(particleSet.size(), mChunkSize, range);
+    }
+
+    ThreadPool& getThreadPool() const
+    {
+        return mPool;
+    }
+
+private:
+    struct Range
+    {
+        const Objective*        objective;
+        const Swarm*            particleSet;
+        std::vector<double>*    fitnesses;
+
+        void operator()(const size_t begin, const size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                (*fitnesses)[i] = (*objective)( (*particleSet)[i] );
+            }
+        }
+    };
+
+    const Objective&    mObjective;
+    ThreadPool&         mPool;
+    size_t              mChunkSize;
+};
+
+#endif /* PARALLEL_EVALUATOR_H_ */
@@ -26,92 +26,85 @@
 
 #include "rng.h"
 #include "dim.h"
+#include "pso_parameters.h"
 
-Particle::Particle()
+template<class T>
+BasicParticle<T>::BasicParticle()
+    : mPos(0), mVel(0), mFitness(0), mPBestPos(0), mPBestFitness(0), mSize(0)
 {
-    mFitness = -1.0 * std::numeric_limits<double>::max();
-    mPBestFitness = -1.0 * std::numeric_limits<double>::max();
 }
 
-// Fixme   This doesn't really construct a fully valid particle.
-Particle::Particle(const std::vector<Dim>& dim)
+template<class T>
+BasicParticle<T>::BasicParticle(T* pos, T* vel, T* pbestPos, prob_t* fitness, prob_t* pbestFitness,
+                                const size_t numDims)
+    : mPos(pos), mVel(vel), mFitness(fitness), mPBestPos(pbestPos), mPBestFitness(pbestFitness),
+    mSize(numDims)
 {
-    mPos.resize(dim.size());
-    mVel.resize(dim.size());
-    mFitness = -1.0 * std::numeric_limits<dim_t>::max();
-    mPBestPos = mPos;
-    mPBestFitness = mFitness;
 }
 
-Particle::Particle(const dvector& pos, const prob_t fitness)
+template<class T>
+typename BasicParticle<T>::dvector BasicParticle<T>::getPosition() const
 {
-    mPos = pos;
-    mVel.resize(pos.size());
-    mPBestPos = pos;
-    mFitness  = fitness;
-    mPBestFitness = fitness;
+    return dvector(mPos, mSize);
 }
 
-const Particle::dvector& Particle::getPosition() const
+template<class T>
+typename BasicParticle<T>::dvector BasicParticle<T>::getVelocity() const
 {
-    return mPos;
+    return dvector(mVel, mSize);
 }
 
-Particle::dvector Particle::getVelocity() const
+template<class T>
+double BasicParticle<T>::getFitness() const
 {
-    return mVel;
+    return *mFitness;
 }
 
-double Particle::getFitness() const
+template<class T>
+typename BasicParticle<T>::dvector BasicParticle<T>::getPBestPosition() const
 {
-    return mFitness;
+    return dvector(mPBestPos, mSize);
 }
 
-Particle::dvector Particle::getBestFitness() const
+template<class T>
+double BasicParticle<T>::getPBestFitness() const
 {
-    return mPBestPos;
+    return *mPBestFitness;
 }
 
-double Particle::getBestFitness() const
+template<class T>
+void BasicParticle<T>::updateFitness(const prob_t newFitness)
 {
-    return mPBestFitness;
-}
-
-void Particle::updateFitness(const prob_t newFitness)
-{
-    mFitness = newFitness;
+    *mFitness = newFitness;
     
     // Update the particles personal best if the new fitness is better
-    if (newFitness > mPBestFitness)
+    if (newFitness > *mPBestFitness)
     {
-        mPBestFitness = newFitness;
-        mPBestPos = mPos;
+        *mPBestFitness = newFitness;
+        std::copy(mPos, mPos + mSize, mPBestPos);
     }
 }
 
-void Particle::updatePosition(const Particle& GBest, const std::vector<Dim>& dim, const double C1, const double C2,
-                    const RandomNumberGenerator& rng, const double inertiaWeight)
+template<class T>
+void BasicParticle<T>::updatePosition(const BasicParticle& localBest, const std::vector<Dim>& dim, const double C1, const double C2,
+                                      const RandomNumberGenerator& rng, const double inertiaWeight)
 {
-    dvector newVel;
-    dvector newPos;
-    
-    assert(mPos.size() == mVel.size());
-    assert(mPos.size() == dim.size());
-    assert(mPos.size() == mPBestPos.size());
-    assert(mPos.size() == GBest.mPos.size());
-    assert(mPos.size() == GBest.mVel.size());
+    assert(mSize == dim.size());
+    assert(mSize == localBest.mSize);
     
+    const T* lbestPos = localBest.mPBestPos;
     
-    // Loop over each dimension
-    for (unsigned int i = 0; i < mPos.size(); i++)
+    // Loop over each dimension. The new values are written in place since
+    // each dimension only depends on its own old value.
+    for (unsigned int i = 0; i < mSize; i++)
     {
         assert(dim[i].max() >= dim[i].min());
         
         // Calculate particle velocity according equation (a)
-        // v[new] = v[old] + c1 * rand() * (pbest[new] - present[old]) + c2 * rand() * (gbest[new] - present[old]) (a)
+        // v[new] = v[old] + c1 * rand() * (pbest[new] - present[old]) + c2 * rand() * (lbest[new] - present[old]) (a)
         dim_t vel = inertiaWeight * mVel[i];
         dim_t diff1 = mPBestPos[i] - mPos[i];
-        dim_t diff2 = GBest.getPosition()[i] - mPos[i];
+        dim_t diff2 = lbestPos[i] - mPos[i];
         vel += C1 * rng.uniform() * diff1;
         vel += C2 * rng.uniform() * diff2;
         
@@ -124,7 +117,7 @@ void Particle::updatePosition(const Particle& GBest, const std::vector<Dim>& dim
         }
         
         // Apply bounds to the velocity
-        const dim_t maxVel = 0.01*(dim[i].max() - dim[i].min());
+        const dim_t maxVel = maxVelocity(dim[i]);
         if ( fabs(vel) > maxVel )
         {
             if (vel < 0.0)
@@ -151,23 +144,16 @@ void Particle::updatePosition(const Particle& GBest, const std::vector<Dim>& dim
             pos = dim[i].max();
         }
         
-        newVel.push_back(vel);
-        newPos.push_back(pos);
+        mVel[i] = vel;
+        mPos[i] = pos;
     }
-    
-    mPos = newPos;
-    mVel = newVel;
-}
-
-size_t Particle::size() const
-{
-    return mPos.size();
 }
 
-bool operator<(const Particle& p1, const Particle& p2)
+template<class T>
+size_t BasicParticle<T>::size() const
 {
-    // hack
-    return (p1.mPBestFitness < p2.mPBestFitness);
-    //return (p1.mFitness < p2.mFitness);
+    return mSize;
 }
 
+template class BasicParticle<double>;
+template class BasicParticle<float>;
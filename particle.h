@@ -30,19 +30,76 @@
 #include "rng.h"
 #include "dim.h"
 
+// Read-only view of the coordinates of one particle. Indexes like the
+// std::vector it replaces, so fitness functions can keep using
+// p.getPosition()[i]. T is the scalar type of the swarm (see swarm.h).
+template<class T>
+class BasicDimSpan
+{
+public:
+    typedef T value_type;
+    typedef const T* const_iterator;
+
+    BasicDimSpan() : mData(0), mSize(0) {}
+
+    BasicDimSpan(const T* data, const size_t size)
+        : mData(data), mSize(size)
+    {
+    }
+
+    const T& operator[](const size_t i) const
+    {
+        assert(i < mSize);
+        return mData[i];
+    }
+
+    size_t size() const
+    {
+        return mSize;
+    }
+
+    const T* data() const
+    {
+        return mData;
+    }
+
+    const_iterator begin() const
+    {
+        return mData;
+    }
+    const_iterator end() const
+    {
+        return mData + mSize;
+    }
 
-class Particle
+    std::vector<dim_t> toVector() const
+    {
+        return std::vector<dim_t>(begin(), end());
+    }
+
+private:
+    const T*     mData;
+    size_t       mSize;
+};
+
+typedef BasicDimSpan<dim_t> DimSpan;
+
+// A Particle is a lightweight view of one row of a Swarm. It does not own
+// any memory, so it is only valid as long as the Swarm it came from. The
+// coordinates are of type T, the fitnesses are always prob_t.
+template<class T>
+class BasicParticle
 {
 public:
-    typedef std::vector<dim_t> dvector;
-    
-    Particle();
+    typedef T scalar_type;
+    typedef BasicDimSpan<T> dvector;
     
-    Particle(const std::vector<Dim>& dim);
+    BasicParticle();
     
-    Particle(const dvector& pos, const prob_t fitness = -1.0 * std::numeric_limits<dim_t>::max());
+    BasicParticle(T* pos, T* vel, T* pbestPos, prob_t* fitness, prob_t* pbestFitness,
+                  const size_t numDims);
     
-    const dvector& getPosition() const;
+    dvector getPosition() const;
     
     dvector getVelocity() const;
     
@@ -54,23 +111,37 @@ public:
     
     void updateFitness(const prob_t newFitness);
     
-    void updatePosition(const Particle& GBest, const std::vector<Dim>& dim, const double C1, const double C2,
+    // Move towards the personal best and the personal best of localBest,
+    // the best particle of the neighbourhood (the global best row with the
+    // global topology)
+    void updatePosition(const BasicParticle& localBest, const std::vector<Dim>& dim, const double C1, const double C2,
                         const RandomNumberGenerator& rng, const double inertiaWeight);
         
     size_t size() const;
     
-    friend bool operator<(const Particle& p1, const Particle& p2);
+    friend bool operator<(const BasicParticle& p1, const BasicParticle& p2)
+    {
+        // hack
+        return (*p1.mPBestFitness < *p2.mPBestFitness);
+        //return (*p1.mFitness < *p2.mFitness);
+    }
     
 private:
-    dvector     mPos;
-    dvector     mVel;
-    prob_t      mFitness;
+    T*          mPos;
+    T*          mVel;
+    prob_t*     mFitness;
     
     // The particles best position
-    dvector		mPBestPos;
-    prob_t 		mPBestFitness;
+    T*          mPBestPos;
+    prob_t*		mPBestFitness;
+
+    size_t      mSize;
 };
 
-bool operator<(const Particle& p1, const Particle& p2);
+typedef BasicParticle<dim_t> Particle;
+
+// Instantiated in particle.cpp
+extern template class BasicParticle<double>;
+extern template class BasicParticle<float>;
 
 #endif // #ifndef INC_PARTICLE_H
@@ -1,29 +0,0 @@
-/*
- * Copyright 2014 Marc Normandin
- *
- * Licensed under the Apache License, Version 2.0 (the "License");
- * you may not use this file except in compliance with the License.
- * You may obtain a copy of the License at
- *
- *     http://www.apache.org/licenses/LICENSE-2.0
- *
- *     Unless required by applicable law or agreed to in writing, software
- *     distributed under the License is distributed on an "AS IS" BASIS,
- *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
- *     See the License for the specific language governing permissions and
- *     limitations under the License.
- */
-
-/*
- * pso.cpp
- *
- *  Created on: Oct 23, 2013
- *      Author: marc
- */
-#include "pso.h"
-
-const double PSO::mC1 = 2.0;
-const double PSO::mC2 = 2.0;
-
-const double PSO::mOmega1 = 0.9;
-const double PSO::mOmega2 = 0.4;
@@ -34,22 +34,77 @@
 #include <limits>
 #include <fstream>
 #include <cassert>
+#include <mutex>
+#include <stdexcept>
+#include <string>
 
+#include "checkpoint.h"
+#include "counter_rng.h"
+#include "fitness_cache.h"
+#include "instrument.h"
 #include "rng.h"
 #include "dim.h"
 #include "particle.h"
+#include "pso_parameters.h"
+#include "solution_store.h"
+#include "stopping.h"
+#include "surrogate.h"
+#include "swarm.h"
+#include "thread_pool.h"
+#include "topology.h"
+#include "trajectory.h"
+#include "update_kernel.h"
 
-template<class FitnessFunction>
-class PSO
+// Value of N in PSO<FitnessFunction, N> for problems whose number of
+// dimensions is only known at run time
+static const size_t kDynamicDims = 0;
+
+// N > 0 selects the fixed-dimension specialization defined in fixed_pso.h.
+// Scalar is the type of the particle coordinates: float halves the memory
+// traffic of the swarm and doubles the lanes of the velocity update, while
+// the fitnesses and the best tracking stay in double (prob_t).
+template<class FitnessFunction, size_t N = kDynamicDims, class Scalar = dim_t>
+class PSO;
+
+// Number of dimensions chosen at run time. With Scalar = float the fitness
+// function is given a FloatSwarm, or a BasicParticle<float> for
+// iterateAsync(); the fitness cache and the surrogate are given the
+// positions widened to double.
+template<class FitnessFunction, class Scalar>
+class PSO<FitnessFunction, kDynamicDims, Scalar>
 {
 public:
+    typedef Scalar                  scalar_type;
+    typedef BasicSwarm<Scalar>      swarm_type;
+    typedef BasicParticle<Scalar>   particle_type;
+
     // This routine is used by the PSO unit test
     PSO(const unsigned int numParticles, const std::vector<Dim>& dim,
         const gslseed_t seed, FitnessFunction& fitnessFunction, const unsigned int maxIterations)
-        : mNumParticles(numParticles), mGBest(dim), mDim(dim), mRng(seed), mFitnessFunction(fitnessFunction),
-        mMaxIterations(maxIterations)
+        : mNumParticles(numParticles), mSwarm(numParticles, dim.size()), mDim(dim), mRng(seed),
+        mFitnessFunction(fitnessFunction), mMaxIterations(maxIterations), mIteration(0),
+        mFitnesses(numParticles), mChunkBest((numParticles + kBestChunkSize - 1) / kBestChunkSize),
+        mHistory(0), mTrajectory(0), mCheckpoint(0), mRun(0), mPool(0), mCache(0), mSurrogate(0),
+        mStore(0), mNumSeeded(0), mStopReason(kStopNotStopped), mNumEvaluations(0),
+        mKernel(UpdateKernelFor<Scalar>::select()), mNumScratchThreads(0),
+        mAsyncQueue(numParticles), mAsyncMoves(numParticles), mAsyncHead(0), mAsyncCount(0),
+        mAsyncIssued(0), mAsyncCompleted(0)
     {
-        mParticles.reserve(mNumParticles);
+        mGBest = mSwarm.gbest();
+
+        // Pack the bounds into aligned rows for the update kernel. The
+        // padding stays zero, which pins the padding lanes at zero.
+        const size_t stride = mSwarm.stride();
+        mLower.resize(stride);
+        mUpper.resize(stride);
+        mMaxVel.resize(stride);
+        for (unsigned int d = 0; d < mDim.size(); d++)
+        {
+            mLower[d] = mDim[d].min();
+            mUpper[d] = mDim[d].max();
+            mMaxVel[d] = maxVelocity(mDim[d]);
+        }
+        resizeScratch(1);
     }
 
     unsigned int getNumParticles() const
@@ -57,100 +112,862 @@ public:
         return mNumParticles;
     }
 
-    const Particle& iterate()
+    // Move the particles in parallel on this pool (0 to move them serially).
+    // The results don't depend on the number of threads.
+    void setThreadPool(ThreadPool* pool)
     {
-        createRandomParticles();
+        mPool = pool;
+        resizeScratch(mPool ? mPool->size() : 1);
+    }
 
-        unsigned int numIterations = 0;
-        std::vector<double> particleFitnesses(mParticles.size());
+    // Look positions up in this cache before calling the fitness function,
+    // and only evaluate the misses (0 to evaluate everything). The cache
+    // is not owned and can be shared by consecutive runs.
+    void setFitnessCache(FitnessCache* cache)
+    {
+        mCache = cache;
+        if (mCache)
+        {
+            reservePending();
+        }
+    }
+
+    // Only evaluate the positions this model predicts might improve their
+    // particle's personal best, plus a random fraction of the others (0 to
+    // evaluate everything). Particles that are screened out keep their
+    // personal best and get the lowest fitness for the iteration,
+    // -std::numeric_limits<prob_t>::max(), which is also what a trajectory
+    // records for them: skip that value when reading the fitnesses back.
+    // Every true evaluation is added to the model. The model is not owned
+    // and can be shared by consecutive runs. iterateAsync() ignores it.
+    void setSurrogate(Surrogate* surrogate)
+    {
+        mSurrogate = surrogate;
+        if (mSurrogate)
+        {
+            reservePending();
+        }
+    }
+
+    // Start part of the swarm from the nearest earlier solutions of this
+    // problem in store (see solution_store.h), and add the best particles
+    // of each finished run to it (0 to start from random positions only).
+    // The store is not owned and is saved at the end of every run, which
+    // throws std::runtime_error if it can't be written.
+    void setWarmStart(SolutionStore* store, const std::string& key, const std::vector<double>& features)
+    {
+        mStore = store;
+        mStoreKey = key;
+        mStoreFeatures = features;
+    }
+
+    // Number of particles of the current/last run seeded from the store
+    unsigned int getNumSeeded() const
+    {
+        return mNumSeeded;
+    }
+
+    // Neighbourhood each particle learns from (global by default).
+    // iterateAsync() always uses the global best.
+    void setTopology(const Topology& topology)
+    {
+        mTopology = topology;
+        mTopology.resize(mNumParticles);
+        mLocalBest.resize(mNumParticles);
+    }
+
+    const Topology& getTopology() const
+    {
+        return mTopology;
+    }
+
+    // Optional stream that receives the particle positions of every
+    // iteration. The first line is the particle dimension.
+    void setHistoryStream(std::ostream* history)
+    {
+        mHistory = history;
+    }
+
+    // Optional binary trajectory, recorded after the bests of each
+    // iteration are updated. Far cheaper than the history stream: the
+    // positions are copied to a buffer and written by another thread.
+    // With a surrogate, the particles it screened out are recorded with
+    // the fitness -std::numeric_limits<prob_t>::max() (see setSurrogate()).
+    void setTrajectoryWriter(TrajectoryWriter* trajectory)
+    {
+        mTrajectory = trajectory;
+    }
+
+    // Save a checkpoint every checkpoint interval iterations. Taking the
+    // snapshot only copies the swarm; the file is written by the writer's
+    // own thread. A failed save is thrown (std::runtime_error) from the
+    // step() taking the next snapshot, or from the last step() of the run.
+    void setCheckpointWriter(CheckpointWriter* checkpoint)
+    {
+        mCheckpoint = checkpoint;
+        if (mCheckpoint)
+        {
+            mCheckpoint->reserve(mNumParticles, mDim.size());
+        }
+    }
+
+    // Snapshot of the run between two iterations
+    void saveCheckpoint(Checkpoint* checkpoint) const
+    {
+        CheckpointHeader& header = checkpoint->header();
+        if (header.numParticles != mNumParticles || header.numDims != mDim.size())
+        {
+            checkpoint->reserve(mNumParticles, mDim.size());
+        }
+        header.iteration = mIteration;
+        header.maxIterations = mMaxIterations;
+        header.run = mRun;
+        header.seed = mRng.seed();
+        header.numEvaluations = mNumEvaluations;
+        header.topologyEpoch = mTopology.getEpoch();
+        checkpoint->setStoppingState(mStopping.getState());
+        checkpoint->capture(mSwarm);
+    }
+
+    // Continue from a snapshot, as if the run had never stopped. The
+    // fitness function must not depend on anything the checkpoint doesn't
+    // hold; nor is the fitness cache saved, so a run with one can take a
+    // different path after resuming.
+    void restoreCheckpoint(const Checkpoint& checkpoint)
+    {
+        const CheckpointHeader& header = checkpoint.header();
+        assert(header.numParticles == mNumParticles && header.numDims == mDim.size());
+        checkpoint.restore(&mSwarm);
+        mIteration = header.iteration;
+        mMaxIterations = header.maxIterations;
+        mRun = header.run;
+        mRng = CounterRNG(header.seed);
+        mTopology.rewire(mRng, stream(CounterRNG::kTopologyStream), header.topologyEpoch);
+        mNumEvaluations = header.numEvaluations;
+        mStopping.resume(mDim.size(), checkpoint.stoppingState());
+        mStopReason = (mIteration >= mMaxIterations) ? kStopMaxIterations : kStopNotStopped;
+    }
+
+    // Load a checkpoint file and run to the end, like iterate(). Throws
+    // std::runtime_error if the file can't be read.
+    const particle_type& resume(const std::string& filename)
+    {
+        Checkpoint checkpoint;
+        checkpoint.load(filename);
+        if (checkpoint.header().numParticles != mNumParticles || checkpoint.header().numDims != mDim.size())
+        {
+            throw std::runtime_error("PSO: checkpoint " + filename + " is for another swarm shape");
+        }
+        restoreCheckpoint(checkpoint);
+        while (mStopReason == kStopNotStopped)
+        {
+            step();
+        }
+
+        return mGBest;
+    }
+
+    // Optional early termination tests, checked after every iteration on
+    // top of the maximum number of iterations
+    void setStoppingCriteria(const StoppingCriteria& criteria)
+    {
+        mStopping.setCriteria(criteria);
+    }
+
+    // Why the last run stopped (kStopNotStopped while it is running)
+    StopReason getStopReason() const
+    {
+        return mStopReason;
+    }
+
+    // Number of fitness evaluations in the current/last run
+    unsigned long getNumEvaluations() const
+    {
+        return mNumEvaluations;
+    }
+
+    const particle_type& iterate()
+    {
+        initialize();
         do
         {
-            // Evaluate the fitness/objective function
-        	mFitnessFunction(mParticles, &particleFitnesses);
+            step();
+        }
+        while(mStopReason == kStopNotStopped);
 
-            //For each particle
-            for (unsigned int i = 0; i < mParticles.size(); i++)
+        return mGBest;
+    }
+
+    // Place the particles randomly and reset the iteration counter. This
+    // is the only part of a run that may allocate memory.
+    void initialize()
+    {
+        // Every run gets its own random streams
+        mRun++;
+        createRandomParticles();
+        mTopology.rewire(mRng, stream(CounterRNG::kTopologyStream), 0);
+        mIteration = 0;
+        mNumEvaluations = 0;
+        mStopReason = kStopNotStopped;
+        mStopping.start(mDim.size());
+        mInstrumentation.reset();
+
+        if (mHistory)
+        {
+            *mHistory << mDim.size() << "\n";
+        }
+    }
+
+    // Perform one iteration: evaluate, update the personal and global bests
+    // and move the particles. No heap allocations happen in here (apart
+    // from whatever the fitness function or history stream do, and the
+    // warm start store at the end of a run).
+    void step()
+    {
+        if (mHistory)
+        {
+            PSO_PHASE(mInstrumentation, kPhaseOutput, mIteration);
+            writeHistory();
+        }
+
+        // Evaluate the fitness/objective function
+        {
+            PSO_PHASE(mInstrumentation, kPhaseEvaluate, mIteration);
+            evaluate();
+        }
+
+        // Update the personal bests, finding the best of each chunk of
+        // particles in the same pass
+        {
+            PSO_PHASE(mInstrumentation, kPhasePBest, mIteration);
+            BestRange scan = { this };
+            if (mPool)
             {
-                // Calculate fitness value
-                const prob_t fitness = particleFitnesses[i]; //
+                mPool->parallelFor(mChunkBest.size(), 1, scan);
+            }
+            else
+            {
+                scan(0, mChunkBest.size());
+            }
+        }
 
-                // If the fitness value is better than the best fitness value (pBest) in history
-                // set current value as the new pBest
-                mParticles[i].updateFitness( fitness );
+        // Choose the particle with the best fitness value of all the particles as the gBest
+        const prob_t previousBest = mGBest.getPBestFitness();
+        size_t best;
+        {
+            PSO_PHASE(mInstrumentation, kPhaseGBest, mIteration);
+            best = reduceBest();
+            mSwarm.setGBest(best);
+        }
+
+        // And the best of each neighbourhood, for the local topologies.
+        // The random one is redrawn when the global best stalls.
+        if (!mTopology.isGlobal())
+        {
+            PSO_PHASE(mInstrumentation, kPhaseTopology, mIteration);
+            if (mTopology.getKind() == kTopologyRandom && mIteration > 0 && !(mGBest.getPBestFitness() > previousBest))
+            {
+                mTopology.rewire(mRng, stream(CounterRNG::kTopologyStream), mTopology.getEpoch() + 1);
             }
+            mTopology.localBests(mSwarm.pbestFitnesses(), mLocalBest.data());
+        }
 
-            // Choose the particle with the best fitness value of all the particles as the gBest
-            std::vector<Particle>::const_iterator best = std::max_element(mParticles.begin(), mParticles.end());
-            mGBest = Particle( best->getBestPosition(), best->getBestFitness() );
+        if (mTrajectory)
+        {
+            PSO_PHASE(mInstrumentation, kPhaseOutput, mIteration);
+            mTrajectory->record(mIteration, mSwarm);
+        }
 
-            // Update the inertia weight
-            const double inertiaWeight = computeInertiaWeight(numIterations, mMaxIterations);
-            
-            // For each particle
-            for (unsigned int i = 0; i < mParticles.size(); i++)
+        // Update the inertia weight
+        const double inertiaWeight = computeInertiaWeight(mIteration, mMaxIterations);
+        
+        // Count what the updates will do first, so the replay isn't timed
+        // as part of the moves
+        if (mInstrumentation.counting())
+        {
+            PSO_PHASE(mInstrumentation, kPhaseCount, mIteration);
+            MoveRange count = { this, inertiaWeight, mSwarm.pbestPosition(best), true };
+            if (mPool)
+            {
+                mPool->parallelFor(mSwarm.size(), 16, count);
+            }
+            else
+            {
+                count(0, mSwarm.size());
+            }
+        }
+
+        // For each particle
+        {
+            PSO_PHASE(mInstrumentation, kPhaseMove, mIteration);
+            MoveRange move = { this, inertiaWeight, mSwarm.pbestPosition(best), false };
+            if (mPool)
+            {
+                mPool->parallelFor(mSwarm.size(), 16, move);
+            }
+            else
+            {
+                move(0, mSwarm.size());
+            }
+        }
+
+        mIteration++;
+
+        {
+            PSO_PHASE(mInstrumentation, kPhaseStopping, mIteration - 1);
+            mStopReason = mStopping.check(mSwarm, mGBest.getPBestFitness(), mNumEvaluations);
+            if (mStopReason == kStopNotStopped && mIteration >= mMaxIterations)
             {
-                mParticles[i].updatePosition( mGBest, mDim, mCognitiveWeight, mSocialWeight, mRng, inertiaWeight );
+                mStopReason = kStopMaxIterations;
             }
+        }
+
+        if (mStore && mStopReason != kStopNotStopped)
+        {
+            PSO_PHASE(mInstrumentation, kPhaseOutput, mIteration - 1);
+            storeSolutions();
+        }
+
+        if (mCheckpoint && mStopReason == kStopNotStopped && mCheckpoint->due(mIteration))
+        {
+            PSO_PHASE(mInstrumentation, kPhaseOutput, mIteration - 1);
+            saveCheckpoint(&mCheckpoint->acquire());
+            mCheckpoint->submit();
+        }
+        else if (mCheckpoint && mStopReason != kStopNotStopped)
+        {
+            mCheckpoint->flush();
+        }
+    }
+
+    // Asynchronous (steady-state) alternative to iterate(). Rather than
+    // evaluating the whole swarm and then moving every particle, a particle
+    // is moved towards the current global best as soon as its own
+    // evaluation finishes and is then queued to be evaluated again. The
+    // threads of the pool evaluate particles continuously, so nobody waits
+    // for the slowest evaluation of an iteration.
+    //
+    // The fitness function must also provide a per-particle objective,
+    // double operator()(const Particle&) const, which is called from several
+    // threads at once. The budget is the same number of evaluations as
+    // iterate(), maxIterations * numParticles. Nothing is written to the
+    // history stream. Updating the bests after each evaluation is
+    // serialized, the move itself is not. Threads beyond the number of
+    // particles stay idle. Only the target fitness, time and evaluation
+    // budget stopping criteria apply.
+    const particle_type& iterateAsync(ThreadPool& pool)
+    {
+        resizeScratch(pool.size());
+        initialize();
 
-            numIterations++;
+        mAsyncHead = 0;
+        mAsyncCount = mNumParticles;
+        for (unsigned int i = 0; i < mNumParticles; i++)
+        {
+            mAsyncQueue[i] = i;
+            mAsyncMoves[i] = 0;
+        }
+        mAsyncIssued = 0;
+        mAsyncCompleted = 0;
+
+        AsyncWorker worker = { this, &pool };
+        pool.parallelFor(pool.size(), 1, worker);
+
+        mIteration = mAsyncCompleted / mNumParticles;
+        mNumEvaluations = mAsyncCompleted;
+        if (mStopReason == kStopNotStopped)
+        {
+            mStopReason = kStopMaxIterations;
         }
-        while(numIterations < mMaxIterations);
+        if (mStore)
+        {
+            storeSolutions();
+        }
+        resizeScratch(mPool ? mPool->size() : 1);
+        return mGBest;
+    }
 
+    unsigned int getIteration() const
+    {
+        return mIteration;
+    }
+
+    const particle_type& getGBest() const
+    {
         return mGBest;
     }
 
+    const swarm_type& getSwarm() const
+    {
+        return mSwarm;
+    }
+
+    // Time spent in each phase of step() and what the velocity updates
+    // did, since the start of the run. All zero unless compiled with
+    // -DPSO_INSTRUMENT (see instrument.h).
+    PSOStats getStats() const
+    {
+        PSOStats stats;
+        mInstrumentation.getStats(&stats);
+        stats.numIterations = mIteration;
+        stats.numEvaluations = mNumEvaluations;
+        return stats;
+    }
+
+    // Keep the timings of up to numEvents phases for writeTrace()
+    void setTraceCapacity(const size_t numEvents)
+    {
+        mInstrumentation.setTraceCapacity(numEvents);
+    }
+
+    // Write the recorded phases as a Chrome trace (chrome://tracing, Perfetto)
+    void writeTrace(std::ostream& out) const
+    {
+        mInstrumentation.writeChromeTrace(out);
+    }
+
+    // Replace particle i with one at rest at this position, whose personal
+    // best is the position itself with the given fitness. Updates the
+    // global best if the new particle is better.
+    void setParticle(const unsigned int i, const dim_t* position, const prob_t fitness)
+    {
+        std::copy(position, position + mDim.size(), mSwarm.position(i));
+        std::fill(mSwarm.velocity(i), mSwarm.velocity(i) + mDim.size(), 0.0);
+        mSwarm.resetParticle(i);
+        mSwarm[i].updateFitness(fitness);
+        if (fitness > mGBest.getPBestFitness())
+        {
+            mSwarm.setGBest(i);
+        }
+    }
+
 protected:
     PSO(const PSO&);
     void operator=(const PSO&);
     
     void createRandomParticles() {
-        mParticles.clear(); // Remove previous particles in the container
-        
         // For each particle
         for (unsigned int i = 0; i < mNumParticles; i++)
         {
-            std::vector<dim_t> pos;
+            Scalar* pos = mSwarm.position(i);
+            Scalar* vel = mSwarm.velocity(i);
+            mRng.fillUniform( pos, mDim.size(), 0, i, stream(CounterRNG::kInitStream) );
             
             // For each dimension
             for (unsigned int d = 0; d < mDim.size(); d++)
             {
-                dim_t posd = mRng.uniform( mDim[d].min(), mDim[d].max() );
-                pos.push_back(posd);
+                pos[d] = mDim[d].min() + pos[d] * (mDim[d].max() - mDim[d].min());
+                vel[d] = 0.0;
             }
             
-            // Add the particle to the collection
-            mParticles.push_back( Particle(pos) );
+            mSwarm.resetParticle(i);
+        }
+
+        mNumSeeded = 0;
+        if (mStore)
+        {
+            seedFromStore();
         }
     }
 
-    // Compute inertia. This is based on equation 4.1 from:
-    // http://www.hindawi.com/journals/ddns/2010/462145/
-    double computeInertiaWeight(const unsigned int iteration, const unsigned int maxInterations) const
+    // Replace up to seedFraction of the random particles with the nearest
+    // stored solutions, spread over the swarm so that every neighbourhood
+    // of the local topologies gets some. Positions and velocities are
+    // clamped to the current bounds.
+    void seedFromStore()
     {
-        // Note. We add +1 because our iterations go from 0 to max-1.
-        double inertiaWeight = (mOmega1 - mOmega2) * ( (maxInterations - (iteration+1.0)) / (1.0 * (iteration+1.0) ) ) + mOmega2;
-        return inertiaWeight;
+        const size_t numDims = mDim.size();
+        const size_t maxSeeds = static_cast<size_t>(mStore->getOptions().seedFraction * mNumParticles);
+        mNumSeeded = mStore->seeds(mStoreKey, mStoreFeatures, numDims, maxSeeds, &mSeedPositions, &mSeedVelocities);
+        for (unsigned int k = 0; k < mNumSeeded; k++)
+        {
+            const unsigned int i = (1ul * k * mNumParticles) / mNumSeeded;
+            Scalar* pos = mSwarm.position(i);
+            Scalar* vel = mSwarm.velocity(i);
+            const dim_t* seedPos = &mSeedPositions[k * numDims];
+            const dim_t* seedVel = &mSeedVelocities[k * numDims];
+            for (unsigned int d = 0; d < numDims; d++)
+            {
+                pos[d] = std::min<dim_t>(std::max<dim_t>(seedPos[d], mLower[d]), mUpper[d]);
+                vel[d] = std::min<dim_t>(std::max<dim_t>(seedVel[d], -mMaxVel[d]), mMaxVel[d]);
+            }
+            mSwarm.resetParticle(i);
+        }
+    }
+
+    // Add the best particles of the finished run to the store and save it
+    void storeSolutions()
+    {
+        mStore->add(mStoreKey, mStoreFeatures, mSwarm);
+        mStore->save();
+    }
+
+    // Fill mFitnesses for the current positions
+    void evaluate()
+    {
+        if (!mCache && !mSurrogate)
+        {
+            mFitnessFunction(mSwarm, &mFitnesses);
+            mNumEvaluations += mSwarm.size();
+            return;
+        }
+
+        // Gather the particles that miss the cache, and that the surrogate
+        // doesn't screen out, into mPending
+        const bool screen = mSurrogate && mSurrogate->ready();
+        const prob_t* pbestFitness = mSwarm.pbestFitnesses();
+        size_t numPending = 0;
+        for (unsigned int i = 0; i < mSwarm.size(); i++)
+        {
+            const dim_t* position = widen(mSwarm.position(i));
+            if (mCache && mCache->lookup( position, &mFitnesses[i] ))
+            {
+                continue;
+            }
+            if (screen && !mSurrogate->worthEvaluating( position, pbestFitness[i],
+                                                        mRng.uniform(mIteration, i, 0, stream(CounterRNG::kSurrogateStream)) ))
+            {
+                mFitnesses[i] = -1.0 * std::numeric_limits<prob_t>::max();
+                continue;
+            }
+            mPending.copyParticle(numPending, mSwarm, i);
+            mPendingIndex[numPending++] = i;
+        }
+        if (numPending == 0)
+        {
+            return;
+        }
+
+        mPending.setSize(numPending);
+        mFitnessFunction(mPending, &mPendingFitnesses);
+        mNumEvaluations += numPending;
+
+        for (size_t k = 0; k < numPending; k++)
+        {
+            const unsigned int i = mPendingIndex[k];
+            mFitnesses[i] = mPendingFitnesses[k];
+            const dim_t* position = widen(mSwarm.position(i));
+            if (mCache)
+            {
+                mCache->insert( position, mFitnesses[i] );
+            }
+            if (mSurrogate)
+            {
+                mSurrogate->insert( position, mFitnesses[i] );
+            }
+        }
+    }
+
+    // Scratch swarm for the particles that do need an evaluation
+    void reservePending()
+    {
+        if (mPending.capacity() != mNumParticles)
+        {
+            mPending.resize(mNumParticles, mDim.size());
+            mPendingIndex.resize(mNumParticles);
+            mPendingFitnesses.resize(mNumParticles);
+            mWide.resize(mDim.size());
+        }
+    }
+
+    // A position as the double coordinates the cache and surrogate take
+    const dim_t* widen(const dim_t* position)
+    {
+        return position;
+    }
+
+    // Valid until the next call
+    const dim_t* widen(const float* position)
+    {
+        std::copy(position, position + mDim.size(), mWide.data());
+        return mWide.data();
+    }
+
+    // Stream identifier of the current run
+    uint32_t stream(const CounterRNG::Stream s) const
+    {
+        return (mRun << 8) | s;
+    }
+
+    // Scratch rows of each thread: r1, r2 and a copy of the guide
+    void resizeScratch(const unsigned int numThreads)
+    {
+        mNumScratchThreads = numThreads;
+        mScratch.resize(3 * mSwarm.stride() * numThreads);
+        mInstrumentation.resize(numThreads);
+    }
+
+    // thread is the index in the pool the scratch was sized for, from
+    // ThreadPool::currentThread(pool)
+    Scalar* scratch(const unsigned int thread)
+    {
+        assert(thread < mNumScratchThreads);
+        return mScratch.data() + 3 * mSwarm.stride() * thread;
+    }
+
+    // Personal bests of chunks [begin, end) of kBestChunkSize particles
+    struct BestRange
+    {
+        PSO*    pso;
+
+        void operator()(const size_t begin, const size_t end)
+        {
+            swarm_type& swarm = pso->mSwarm;
+            for (size_t c = begin; c < end; c++)
+            {
+                const size_t first = c * kBestChunkSize;
+                const size_t last = std::min<size_t>(first + kBestChunkSize, swarm.size());
+                pso->mChunkBest[c] = swarm.updatePBests(pso->mFitnesses.data(), first, last);
+            }
+        }
+    };
+
+    // Index of the best personal best, from the best of each chunk. The
+    // chunks are merged pairwise, as a tree, and the chunking doesn't
+    // depend on the number of threads, so neither does the winner: the
+    // lowest index among equals, like Swarm::bestIndex().
+    size_t reduceBest()
+    {
+        const prob_t* pbestFitness = mSwarm.pbestFitnesses();
+        const size_t numChunks = mChunkBest.size();
+        for (size_t width = 1; width < numChunks; width *= 2)
+        {
+            for (size_t c = 0; c + width < numChunks; c += 2 * width)
+            {
+                if (pbestFitness[mChunkBest[c + width]] > pbestFitness[mChunkBest[c]])
+                {
+                    mChunkBest[c] = mChunkBest[c + width];
+                }
+            }
+        }
+        return mChunkBest[0];
+    }
+
+    struct MoveRange
+    {
+        PSO*            pso;
+        double          inertiaWeight;
+        const Scalar*   gbest;  // Personal best of the winner of reduceBest()
+        bool            count;  // Only count what the updates would do
+
+        void operator()(const size_t begin, const size_t end)
+        {
+            const swarm_type& swarm = pso->mSwarm;
+            const unsigned int thread = ThreadPool::currentThread(pso->mPool);
+            for (size_t i = begin; i < end; i++)
+            {
+                const Scalar* guide = pso->mTopology.isGlobal() ? gbest : swarm.pbestPosition(pso->mLocalBest[i]);
+                if (count)
+                {
+                    pso->countParticle(i, pso->mIteration, guide, inertiaWeight, thread);
+                }
+                else
+                {
+                    pso->moveParticle(i, pso->mIteration, guide, inertiaWeight, thread);
+                }
+            }
+        }
+    };
+
+    // Move particle i towards its personal best and the guide (the global
+    // best, or the best personal best of its neighbourhood). counter selects
+    // the random numbers: together with the particle index it must be unique
+    // within a run. thread selects the scratch rows.
+    void moveParticle(const unsigned int i, const uint32_t counter, const Scalar* guide,
+                      const double inertiaWeight, const unsigned int thread)
+    {
+        BasicUpdateArgs<Scalar> args;
+        updateArgs(i, counter, guide, inertiaWeight, thread, &args);
+        mKernel(args);
+    }
+
+    // Count what moveParticle() with the same arguments will do, without
+    // moving the particle
+    void countParticle(const unsigned int i, const uint32_t counter, const Scalar* guide,
+                       const double inertiaWeight, const unsigned int thread)
+    {
+        BasicUpdateArgs<Scalar> args;
+        updateArgs(i, counter, guide, inertiaWeight, thread, &args);
+        PSO_COUNT_UPDATE(mInstrumentation, args, mDim.size(), thread);
+    }
+
+    // Draw the random numbers of an update into the scratch rows of thread
+    // and point args at them and the rows of particle i
+    void updateArgs(const unsigned int i, const uint32_t counter, const Scalar* guide,
+                    const double inertiaWeight, const unsigned int thread, BasicUpdateArgs<Scalar>* args)
+    {
+        Scalar* r1 = scratch(thread);
+        Scalar* r2 = r1 + mSwarm.stride();
+        mRng.fillUniform( r1, mDim.size(), counter, i, stream(CounterRNG::kCognitiveStream) );
+        mRng.fillUniform( r2, mDim.size(), counter, i, stream(CounterRNG::kSocialStream) );
+
+        args->pos = mSwarm.position(i);
+        args->vel = mSwarm.velocity(i);
+        args->pbest = mSwarm.pbestPosition(i);
+        args->guide = guide;
+        args->r1 = r1;
+        args->r2 = r2;
+        args->lower = mLower.data();
+        args->upper = mUpper.data();
+        args->maxVel = mMaxVel.data();
+        args->n = mSwarm.stride();
+        args->c1 = kCognitiveWeight;
+        args->c2 = kSocialWeight;
+        args->inertiaWeight = inertiaWeight;
+    }
+
+    struct AsyncWorker
+    {
+        PSO*        pso;
+        ThreadPool* pool;
+
+        void operator()(size_t, size_t)
+        {
+            pso->runAsyncWorker(ThreadPool::currentThread(pool));
+        }
+    };
+
+    // Take the next particle from the queue, evaluate it without holding
+    // the lock, then update the bests, move it and put it back in the queue.
+    void runAsyncWorker(const unsigned int thread)
+    {
+        const unsigned long maxEvaluations = 1ul * mMaxIterations * mNumParticles;
+        const FitnessFunction& objective = mFitnessFunction;
+        Scalar* guide = scratch(thread) + 2 * mSwarm.stride();
+
+        std::unique_lock<std::mutex> lock(mAsyncMutex);
+        while (mAsyncIssued < maxEvaluations && mAsyncCount > 0 && mStopReason == kStopNotStopped)
+        {
+            const unsigned int i = mAsyncQueue[mAsyncHead];
+            mAsyncHead = (mAsyncHead + 1) % mNumParticles;
+            mAsyncCount--;
+            mAsyncIssued++;
+
+            lock.unlock();
+            const prob_t fitness = objective( mSwarm[i] );
+            lock.lock();
+
+            mSwarm[i].updateFitness( fitness );
+            if (mSwarm.pbestFitnesses()[i] > mGBest.getPBestFitness())
+            {
+                mSwarm.setGBest(i);
+            }
+            mAsyncCompleted++;
+            if (mStopReason == kStopNotStopped)
+            {
+                mStopReason = mStopping.checkBudgets(mGBest.getPBestFitness(), mAsyncCompleted);
+            }
+
+            // Evaluations so far, in units of whole swarm iterations
+            const unsigned int iteration = std::min<unsigned long>(mAsyncCompleted / mNumParticles, mMaxIterations - 1);
+            const uint32_t counter = mAsyncMoves[i]++;
+
+            // Move against a snapshot of the global best, so the lock can
+            // be released while moving
+            const Scalar* gbest = mSwarm.gbestPosition();
+            std::copy(gbest, gbest + mSwarm.stride(), guide);
+            lock.unlock();
+            const double inertiaWeight = computeInertiaWeight(iteration, mMaxIterations);
+            if (mInstrumentation.counting())
+            {
+                countParticle(i, counter, guide, inertiaWeight, thread);
+            }
+            moveParticle(i, counter, guide, inertiaWeight, thread);
+            lock.lock();
+
+            mAsyncQueue[(mAsyncHead + mAsyncCount) % mNumParticles] = i;
+            mAsyncCount++;
+        }
+    }
+
+    void writeHistory() const
+    {
+        for (unsigned int i = 0; i < mSwarm.size(); i++)
+        {
+            const Scalar* pos = mSwarm.position(i);
+            for (unsigned int d = 0; d < mDim.size(); d++)
+            {
+                *mHistory << pos[d] << " ";
+            }
+        }
+        *mHistory << "\n";
     }
 
 private:
     unsigned int            mNumParticles;
-    std::vector<Particle> 	mParticles; // Particle positions
-    Particle 				mGBest;
+    swarm_type              mSwarm; // Particle positions
+    particle_type           mGBest; // View of the global best row of mSwarm
     std::vector<Dim>		mDim;
 
-    // These values control how random the particle velocities are
-    static const double 	mCognitiveWeight;
-    static const double 	mSocialWeight;
-    
-    // These values control the rate of convergence
-    static const double     mOmega1;
-    static const double     mOmega2;
-
-    RandomNumberGenerator 	mRng;
+    CounterRNG              mRng;
 
     FitnessFunction&        mFitnessFunction;
     unsigned int            mMaxIterations;
+    unsigned int            mIteration;
+
+    // Filled by the fitness function. Sized once so iterating doesn't allocate.
+    std::vector<double>     mFitnesses;
+
+    // Best particle of each chunk of the swarm, merged by reduceBest()
+    static const size_t         kBestChunkSize = 256;
+    std::vector<size_t>         mChunkBest;
+
+    std::ostream*           mHistory;
+    TrajectoryWriter*       mTrajectory;
+    CheckpointWriter*       mCheckpoint;
+
+    // Number of times initialize() was called, part of the random stream id
+    uint32_t                mRun;
+
+    ThreadPool*             mPool;
+
+    Topology                    mTopology;
+    std::vector<unsigned int>   mLocalBest; // Best neighbour of each particle
+
+    // Optional fitness cache and surrogate, and the scratch swarm of the
+    // particles that still need an evaluation
+    FitnessCache*               mCache;
+    Surrogate*                  mSurrogate;
+    swarm_type                  mPending;
+    std::vector<unsigned int>   mPendingIndex;
+    std::vector<double>         mPendingFitnesses;
+    std::vector<dim_t>          mWide; // Widened position, for float swarms
+
+    // Optional warm start: solutions of earlier runs of similar problems
+    SolutionStore*              mStore;
+    std::string                 mStoreKey;
+    std::vector<double>         mStoreFeatures;
+    unsigned int                mNumSeeded;
+    std::vector<dim_t>          mSeedPositions;
+    std::vector<dim_t>          mSeedVelocities;
+
+    StoppingMonitor         mStopping;
+    StopReason              mStopReason;
+    unsigned long           mNumEvaluations;
+
+    Instrumentation         mInstrumentation;
+
+    // Velocity/position update, vectorized for this CPU
+    typename UpdateKernelFor<Scalar>::Kernel    mKernel;
+    AlignedBuffer<Scalar>   mLower;
+    AlignedBuffer<Scalar>   mUpper;
+    AlignedBuffer<Scalar>   mMaxVel;
+    AlignedBuffer<Scalar>   mScratch;
+    unsigned int            mNumScratchThreads;
+
+    // State of iterateAsync(). mAsyncQueue is a ring buffer of the particles
+    // waiting to be evaluated. Everything here, the swarm bests and the RNG
+    // are guarded by mAsyncMutex while the async workers run.
+    std::mutex                  mAsyncMutex;
+    std::vector<unsigned int>   mAsyncQueue;
+    std::vector<uint32_t>       mAsyncMoves; // Number of moves of each particle
+    unsigned int                mAsyncHead;
+    unsigned int                mAsyncCount;
+    unsigned long               mAsyncIssued;
+    unsigned long               mAsyncCompleted;
 };
 
+#include "fixed_pso.h"
+
 
 #endif /* PSO_H_ */
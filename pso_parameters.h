@@ -0,0 +1,54 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * pso_parameters.h
+ *
+ * Constants of the velocity update, shared by PSO (pso.h and fixed_pso.h)
+ * and Ensemble so that they all move particles the same way.
+ */
+
+#ifndef PSO_PARAMETERS_H_
+#define PSO_PARAMETERS_H_
+
+#include "dim.h"
+
+// These values control how random the particle velocities are
+static const double kCognitiveWeight = 2.0;
+static const double kSocialWeight = 2.0;
+
+// These values control the rate of convergence: the inertia weight goes
+// from about kOmega1 towards kOmega2 over a run
+static const double kOmega1 = 0.9;
+static const double kOmega2 = 0.4;
+
+// Velocities are clamped to this fraction of the range of their dimension
+static const double kMaxVelocityFraction = 0.01;
+
+// Compute inertia. This is based on equation 4.1 from:
+// http://www.hindawi.com/journals/ddns/2010/462145/
+inline double computeInertiaWeight(const unsigned int iteration, const unsigned int maxIterations)
+{
+    // Note. We add +1 because our iterations go from 0 to max-1.
+    return (kOmega1 - kOmega2) * ( (maxIterations - (iteration+1.0)) / (1.0 * (iteration+1.0) ) ) + kOmega2;
+}
+
+inline dim_t maxVelocity(const Dim& dim)
+{
+    return kMaxVelocityFraction*(dim.max() - dim.min());
+}
+
+#endif /* PSO_PARAMETERS_H_ */
@@ -0,0 +1,548 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * remote.cpp
+ */
+#include "remote.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+
+// Split "tcp:host:port" into host and port; the host may be empty
+void parseTcp(const std::string& address, std::string* host, std::string* port)
+{
+    const std::string rest = address.substr(4);
+    const size_t colon = rest.rfind(':');
+    if (colon == std::string::npos)
+    {
+        *port = rest;
+    }
+    else
+    {
+        *host = rest.substr(0, colon);
+        *port = rest.substr(colon + 1);
+    }
+}
+
+bool isUnix(const std::string& address)
+{
+    return address.compare(0, 5, "unix:") == 0;
+}
+
+bool isTcp(const std::string& address)
+{
+    return address.compare(0, 4, "tcp:") == 0;
+}
+
+sockaddr_un unixAddress(const std::string& address)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    const std::string path = address.substr(5);
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+        throw std::runtime_error("Remote: socket path too long: " + path);
+    }
+    memcpy(addr.sun_path, path.c_str(), path.size());
+    return addr;
+}
+
+int tcpSocket(const std::string& address, const bool listening)
+{
+    std::string host;
+    std::string port;
+    parseTcp(address, &host, &port);
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listening ? AI_PASSIVE : 0;
+    addrinfo* result = 0;
+    if (getaddrinfo(host.empty() ? 0 : host.c_str(), port.c_str(), &hints, &result) != 0)
+    {
+        throw std::runtime_error("Remote: can't resolve " + address);
+    }
+
+    int fd = -1;
+    for (addrinfo* ai = result; ai && fd < 0; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+        {
+            continue;
+        }
+        int one = 1;
+        if (listening)
+        {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        }
+        const bool ok = listening ? (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 64) == 0)
+                                  : (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0);
+        if (!ok)
+        {
+            close(fd);
+            fd = -1;
+        }
+        else if (!listening)
+        {
+            // Batches are small messages, don't hold them back
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+    }
+    freeaddrinfo(result);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Remote: can't " + std::string(listening ? "listen on " : "connect to ") + address);
+    }
+    return fd;
+}
+
+} // namespace
+
+int remoteListen(const std::string& address)
+{
+    if (isTcp(address))
+    {
+        return tcpSocket(address, true);
+    }
+    if (!isUnix(address))
+    {
+        throw std::runtime_error("Remote: bad address " + address);
+    }
+
+    const sockaddr_un addr = unixAddress(address);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(addr.sun_path);
+    if (fd < 0 || bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 64) != 0)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        throw std::runtime_error("Remote: can't listen on " + address);
+    }
+    return fd;
+}
+
+int remoteAccept(const int listenFd)
+{
+    int fd;
+    do
+    {
+        fd = accept(listenFd, 0, 0);
+    }
+    while (fd < 0 && errno == EINTR);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Remote: accept failed");
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Fails harmlessly on Unix sockets
+    return fd;
+}
+
+int remoteConnect(const std::string& address)
+{
+    if (isTcp(address))
+    {
+        return tcpSocket(address, false);
+    }
+    if (!isUnix(address))
+    {
+        throw std::runtime_error("Remote: bad address " + address);
+    }
+
+    const sockaddr_un addr = unixAddress(address);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        throw std::runtime_error("Remote: can't connect to " + address);
+    }
+    return fd;
+}
+
+bool remoteRead(const int fd, void* data, const size_t size)
+{
+    char* p = static_cast<char*>(data);
+    size_t done = 0;
+    while (done < size)
+    {
+        const ssize_t n = read(fd, p + done, size - done);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+bool remoteWrite(const int fd, const void* data, const size_t size)
+{
+    const char* p = static_cast<const char*>(data);
+    size_t done = 0;
+    while (done < size)
+    {
+        // MSG_NOSIGNAL: a dead peer is an error, not a SIGPIPE
+        const ssize_t n = send(fd, p + done, size - done, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+RemoteOptions::RemoteOptions()
+    : batchSize(16), pipelineDepth(2), stragglerSeconds(1.0)
+{
+}
+
+RemoteCoordinator::RemoteCoordinator(const std::vector<int>& workers, const size_t numRows,
+                                     const size_t numDims, const RemoteOptions& options)
+    : mNumRows(numRows), mNumDims(numDims), mOptions(options), mWorkers(workers.size()),
+    mGeneration(0), mNumBatches(0), mNumDone(0), mNumRowsSent(0), mNumRowsUnchanged(0), mNumBytesSent(0),
+    mNumDuplicates(0)
+{
+    assert(mOptions.batchSize > 0 && mOptions.pipelineDepth > 0);
+
+    RemoteHello hello;
+    hello.magic = kRemoteMagic;
+    hello.version = kRemoteVersion;
+    hello.numRows = numRows;
+    hello.numDims = numDims;
+    for (size_t w = 0; w < workers.size(); w++)
+    {
+        Worker& worker = mWorkers[w];
+        worker.fd = workers[w];
+        worker.alive = remoteWrite(worker.fd, &hello, sizeof(hello));
+        worker.mirror.resize(numRows * numDims);
+        worker.hasRow.assign(numRows, 0);
+        if (!worker.alive)
+        {
+            drop(worker);
+        }
+    }
+
+    const size_t numBatches = (numRows + mOptions.batchSize - 1) / mOptions.batchSize;
+    mBatches.resize(numBatches);
+    mQueue.reserve(numBatches);
+    mSendBuffer.resize(sizeof(RemoteMessage) + mOptions.batchSize * (2 * sizeof(uint32_t) + numDims * sizeof(double)));
+    mReceiveBuffer.resize(mOptions.batchSize);
+}
+
+RemoteCoordinator::~RemoteCoordinator()
+{
+    RemoteMessage message;
+    memset(&message, 0, sizeof(message));
+    message.type = kRemoteShutdown;
+    for (size_t w = 0; w < mWorkers.size(); w++)
+    {
+        if (mWorkers[w].alive)
+        {
+            remoteWrite(mWorkers[w].fd, &message, sizeof(message));
+            close(mWorkers[w].fd);
+        }
+    }
+}
+
+size_t RemoteCoordinator::getNumLiveWorkers() const
+{
+    size_t n = 0;
+    for (size_t w = 0; w < mWorkers.size(); w++)
+    {
+        n += mWorkers[w].alive;
+    }
+    return n;
+}
+
+void RemoteCoordinator::evaluate(const Swarm& swarm, std::vector<double>* fitnesses, std::vector<unsigned int>* local)
+{
+    assert(swarm.capacity() <= mNumRows && swarm.numDims() == mNumDims);
+    local->clear();
+
+    // Batches of this call; results of earlier calls still in flight are
+    // told apart by their generation and ignored
+    mGeneration++;
+    const unsigned int numBatches = (swarm.size() + mOptions.batchSize - 1) / mOptions.batchSize;
+    mNumBatches = numBatches;
+    mQueue.clear();
+    for (unsigned int b = 0; b < numBatches; b++)
+    {
+        Batch& batch = mBatches[b];
+        batch.begin = b * mOptions.batchSize;
+        batch.end = std::min<unsigned int>(batch.begin + mOptions.batchSize, swarm.size());
+        batch.state = kBatchQueued;
+        batch.numCopies = 0;
+        mQueue.push_back(numBatches - 1 - b); // Taken from the back
+    }
+    mNumDone = 0;
+
+    std::vector<pollfd> fds(mWorkers.size());
+    std::vector<Worker*> polled(mWorkers.size());
+    while (mNumDone < numBatches)
+    {
+        if (getNumLiveWorkers() == 0)
+        {
+            // Evaluate whatever is left locally
+            for (unsigned int b = 0; b < numBatches; b++)
+            {
+                if (mBatches[b].state != kBatchDone)
+                {
+                    for (unsigned int i = mBatches[b].begin; i < mBatches[b].end; i++)
+                    {
+                        local->push_back(i);
+                    }
+                    mBatches[b].state = kBatchDone;
+                }
+            }
+            return;
+        }
+
+        // Keep every worker's pipeline full, then give idle workers the
+        // batches that are taking too long
+        for (size_t w = 0; w < mWorkers.size(); w++)
+        {
+            Worker& worker = mWorkers[w];
+            while (worker.alive && worker.outstanding.size() < mOptions.pipelineDepth && !mQueue.empty())
+            {
+                const unsigned int b = mQueue.back();
+                mQueue.pop_back();
+                send(worker, swarm, b);
+            }
+            if (worker.alive && worker.outstanding.empty())
+            {
+                const int b = nextStraggler(worker);
+                if (b >= 0)
+                {
+                    send(worker, swarm, b);
+                    mNumDuplicates++;
+                }
+            }
+        }
+
+        size_t numFds = 0;
+        for (size_t w = 0; w < mWorkers.size(); w++)
+        {
+            if (mWorkers[w].alive && !mWorkers[w].outstanding.empty())
+            {
+                fds[numFds].fd = mWorkers[w].fd;
+                fds[numFds].events = POLLIN;
+                fds[numFds].revents = 0;
+                polled[numFds++] = &mWorkers[w];
+            }
+        }
+        if (numFds == 0)
+        {
+            continue;
+        }
+
+        // Wake up now and then to look for stragglers
+        const int timeout = std::max(1, static_cast<int>(1000 * mOptions.stragglerSeconds / 4));
+        if (poll(fds.data(), numFds, timeout) < 0 && errno != EINTR)
+        {
+            throw std::runtime_error("Remote: poll failed");
+        }
+        for (size_t k = 0; k < numFds; k++)
+        {
+            if (fds[k].revents & (POLLIN | POLLHUP | POLLERR))
+            {
+                if (!receive(*polled[k], fitnesses))
+                {
+                    drop(*polled[k]);
+                }
+            }
+        }
+    }
+}
+
+// Send batch b to a worker, with only the rows the worker doesn't have yet
+void RemoteCoordinator::send(Worker& worker, const Swarm& swarm, const unsigned int b)
+{
+    Batch& batch = mBatches[b];
+    const size_t rowBytes = mNumDims * sizeof(double);
+    RemoteMessage* message = reinterpret_cast<RemoteMessage*>(mSendBuffer.data());
+    message->type = kRemoteBatch;
+    message->id = b;
+    message->count = batch.end - batch.begin;
+    message->reserved = 0;
+
+    uint32_t* entries = reinterpret_cast<uint32_t*>(mSendBuffer.data() + sizeof(RemoteMessage));
+    char* rows = reinterpret_cast<char*>(entries + 2 * message->count);
+    for (unsigned int i = batch.begin; i < batch.end; i++)
+    {
+        const dim_t* pos = swarm.position(i);
+        double* mirror = worker.mirror.data() + i * mNumDims;
+        const bool changed = !worker.hasRow[i] || memcmp(mirror, pos, rowBytes) != 0;
+        *entries++ = i;
+        *entries++ = changed;
+        if (changed)
+        {
+            memcpy(rows, pos, rowBytes);
+            memcpy(mirror, pos, rowBytes);
+            worker.hasRow[i] = 1;
+            rows += rowBytes;
+            mNumRowsSent++;
+        }
+        else
+        {
+            mNumRowsUnchanged++;
+        }
+    }
+
+    const size_t size = rows - mSendBuffer.data();
+    if (!remoteWrite(worker.fd, mSendBuffer.data(), size))
+    {
+        drop(worker);
+        if (batch.numCopies == 0 && batch.state != kBatchDone)
+        {
+            batch.state = kBatchQueued;
+            mQueue.push_back(b);
+        }
+        return;
+    }
+    mNumBytesSent += size;
+
+    Outstanding outstanding;
+    outstanding.generation = mGeneration;
+    outstanding.batch = b;
+    worker.outstanding.push_back(outstanding);
+    if (batch.state == kBatchQueued)
+    {
+        batch.state = kBatchSent;
+        batch.sent = Clock::now();
+    }
+    batch.numCopies++;
+}
+
+// Read the next result of a worker
+bool RemoteCoordinator::receive(Worker& worker, std::vector<double>* fitnesses)
+{
+    RemoteMessage message;
+    if (!remoteRead(worker.fd, &message, sizeof(message)) || message.type != kRemoteResult ||
+        message.count > mReceiveBuffer.size() ||
+        !remoteRead(worker.fd, mReceiveBuffer.data(), message.count * sizeof(double)))
+    {
+        return false;
+    }
+
+    const Outstanding outstanding = worker.outstanding.front();
+    if (message.id != outstanding.batch)
+    {
+        return false;
+    }
+    worker.outstanding.erase(worker.outstanding.begin());
+    if (outstanding.generation != mGeneration)
+    {
+        return true; // A late duplicate from an earlier call
+    }
+
+    Batch& batch = mBatches[outstanding.batch];
+    batch.numCopies--;
+    if (batch.state != kBatchDone)
+    {
+        assert(message.count == batch.end - batch.begin);
+        std::copy(mReceiveBuffer.begin(), mReceiveBuffer.begin() + message.count, fitnesses->begin() + batch.begin);
+        batch.state = kBatchDone;
+        mNumDone++;
+    }
+    return true;
+}
+
+// Close a failed connection and queue its batches again
+void RemoteCoordinator::drop(Worker& worker)
+{
+    if (worker.alive)
+    {
+        close(worker.fd);
+        worker.alive = false;
+    }
+    for (size_t k = 0; k < worker.outstanding.size(); k++)
+    {
+        if (worker.outstanding[k].generation != mGeneration)
+        {
+            continue;
+        }
+        Batch& batch = mBatches[worker.outstanding[k].batch];
+        if (--batch.numCopies == 0 && batch.state != kBatchDone)
+        {
+            batch.state = kBatchQueued;
+            mQueue.push_back(worker.outstanding[k].batch);
+        }
+    }
+    worker.outstanding.clear();
+}
+
+// Oldest batch out for longer than the straggler time that this worker
+// isn't already running, or -1
+int RemoteCoordinator::nextStraggler(const Worker& worker) const
+{
+    if (!mQueue.empty())
+    {
+        return -1;
+    }
+    const Clock::time_point now = Clock::now();
+    int oldest = -1;
+    for (unsigned int b = 0; b < mNumBatches; b++)
+    {
+        const Batch& batch = mBatches[b];
+        if (batch.state != kBatchSent || batch.numCopies > 1 ||
+            std::chrono::duration<double>(now - batch.sent).count() < mOptions.stragglerSeconds)
+        {
+            continue;
+        }
+        bool mine = false;
+        for (size_t k = 0; k < worker.outstanding.size(); k++)
+        {
+            mine = mine || (worker.outstanding[k].batch == b && worker.outstanding[k].generation == mGeneration);
+        }
+        if (!mine && (oldest < 0 || batch.sent < mBatches[oldest].sent))
+        {
+            oldest = b;
+        }
+    }
+    return oldest;
+}
@@ -0,0 +1,294 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * remote.h
+ */
+
+#ifndef REMOTE_H_
+#define REMOTE_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "dim.h"
+#include "particle.h"
+#include "swarm.h"
+
+// Distributed fitness evaluation. A coordinator process runs PSO and sends
+// batches of particle positions to worker processes over stream sockets;
+// the workers evaluate them and send the fitnesses back.
+//
+// Protocol, in the byte order of the machines (which must agree):
+//   Coordinator -> worker  RemoteHello once, then RemoteMessage batches
+//                          (kRemoteBatch) and finally kRemoteShutdown
+//   Worker -> coordinator  one kRemoteResult per batch, in order
+// A batch lists count rows as uint32_t pairs (row index, has data) and then
+// numDims doubles for each row that has data. Every worker keeps a copy of
+// the positions it was last sent, so a row is only sent again once it has
+// changed. A result holds count double fitnesses, in the order of the batch.
+
+static const uint32_t kRemoteMagic = 0x50534f52; // "PSOR"
+static const uint32_t kRemoteVersion = 1;
+
+enum RemoteMessageType
+{
+    kRemoteBatch = 1,
+    kRemoteResult = 2,
+    kRemoteShutdown = 3
+};
+
+struct RemoteHello
+{
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    numRows;
+    uint32_t    numDims;
+};
+
+struct RemoteMessage
+{
+    uint32_t    type;
+    uint32_t    id;
+    uint32_t    count;
+    uint32_t    reserved;
+};
+
+// Socket addresses are "unix:<path>" or "tcp:<host>:<port>". These throw
+// std::runtime_error on failure.
+int remoteListen(const std::string& address);
+int remoteAccept(const int listenFd);
+int remoteConnect(const std::string& address);
+
+// Blocking, complete reads and writes. Return false on error or end of file.
+bool remoteRead(const int fd, void* data, const size_t size);
+bool remoteWrite(const int fd, const void* data, const size_t size);
+
+struct RemoteOptions
+{
+    RemoteOptions();
+
+    unsigned int    batchSize;          // Rows per batch
+    unsigned int    pipelineDepth;      // Batches in flight per worker
+    double          stragglerSeconds;   // Once nothing is left to send, an idle worker
+                                        // also runs any batch out for longer than this
+};
+
+// Coordinator side: spreads the rows of a swarm over the workers. Batches
+// are pipelined, so a worker always has the next batch queued while it
+// evaluates one. At the end of an iteration, batches held up by a slow
+// worker are sent to an idle one as well and the first result wins. A
+// worker whose connection fails is dropped and its batches are sent
+// elsewhere; once no worker is left, the rows are handed back to be
+// evaluated locally.
+class RemoteCoordinator
+{
+public:
+    // Takes ownership of the connected worker sockets and greets the
+    // workers. numRows is the capacity of the swarms to evaluate.
+    RemoteCoordinator(const std::vector<int>& workers, const size_t numRows, const size_t numDims,
+                      const RemoteOptions& options = RemoteOptions());
+
+    // Tells the workers to quit and closes the sockets
+    ~RemoteCoordinator();
+
+    // Fill (*fitnesses)[i] for the rows of swarm. The rows that no worker
+    // could evaluate are listed in *local.
+    void evaluate(const Swarm& swarm, std::vector<double>* fitnesses, std::vector<unsigned int>* local);
+
+    size_t getNumLiveWorkers() const;
+
+    // Traffic counters
+    unsigned long getNumRowsSent() const
+    {
+        return mNumRowsSent;
+    }
+    unsigned long getNumRowsUnchanged() const
+    {
+        return mNumRowsUnchanged;
+    }
+    unsigned long getNumBytesSent() const
+    {
+        return mNumBytesSent;
+    }
+    unsigned long getNumDuplicates() const
+    {
+        return mNumDuplicates;
+    }
+
+private:
+    RemoteCoordinator(const RemoteCoordinator&);
+    void operator=(const RemoteCoordinator&);
+
+    typedef std::chrono::steady_clock Clock;
+
+    enum BatchState
+    {
+        kBatchQueued,
+        kBatchSent,
+        kBatchDone
+    };
+
+    struct Batch
+    {
+        unsigned int        begin;
+        unsigned int        end;
+        BatchState          state;
+        unsigned int        numCopies;  // Workers running it
+        Clock::time_point   sent;
+    };
+
+    // A batch sent to a worker. Workers answer in order.
+    struct Outstanding
+    {
+        unsigned long   generation;     // evaluate() call it belongs to
+        unsigned int    batch;
+    };
+
+    struct Worker
+    {
+        int                         fd;
+        bool                        alive;
+        std::vector<double>         mirror;     // Positions the worker holds
+        std::vector<char>           hasRow;     // Whether mirror row i is valid
+        std::vector<Outstanding>    outstanding;
+    };
+
+    void send(Worker& worker, const Swarm& swarm, const unsigned int b);
+    bool receive(Worker& worker, std::vector<double>* fitnesses);
+    void drop(Worker& worker);
+    int nextStraggler(const Worker& worker) const;
+
+    size_t                  mNumRows;
+    size_t                  mNumDims;
+    RemoteOptions           mOptions;
+    std::vector<Worker>     mWorkers;
+
+    unsigned long           mGeneration;
+    std::vector<Batch>      mBatches;
+    unsigned int            mNumBatches;    // Used by the current call
+    std::vector<unsigned int> mQueue;
+    unsigned int            mNumDone;
+
+    std::vector<char>       mSendBuffer;
+    std::vector<double>     mReceiveBuffer;
+
+    unsigned long           mNumRowsSent;
+    unsigned long           mNumRowsUnchanged;
+    unsigned long           mNumBytesSent;
+    unsigned long           mNumDuplicates;
+};
+
+// Batch fitness function for PSO that evaluates on remote workers, and
+// locally with the same per-particle objective when there are none left
+template<class Objective>
+class RemoteEvaluator
+{
+public:
+    RemoteEvaluator(RemoteCoordinator& coordinator, const Objective& objective)
+        : mCoordinator(coordinator), mObjective(objective)
+    {
+    }
+
+    void operator()(const Swarm& particleSet, std::vector<double>* particleFitnesses)
+    {
+        mCoordinator.evaluate(particleSet, particleFitnesses, &mLocal);
+        for (size_t k = 0; k < mLocal.size(); k++)
+        {
+            (*particleFitnesses)[mLocal[k]] = mObjective(particleSet[mLocal[k]]);
+        }
+    }
+
+    double operator()(const Particle& p) const
+    {
+        return mObjective(p);
+    }
+
+    const RemoteCoordinator& getCoordinator() const
+    {
+        return mCoordinator;
+    }
+
+private:
+    RemoteCoordinator&          mCoordinator;
+    const Objective&            mObjective;
+    std::vector<unsigned int>   mLocal;
+};
+
+// Worker side: answer the batches of a coordinator on the connected socket
+// fd with a per-particle objective, double operator()(const Particle&)
+// const, until told to quit. Returns false if the connection failed.
+template<class Objective>
+bool serveRemoteWorker(const int fd, const Objective& objective)
+{
+    RemoteHello hello;
+    if (!remoteRead(fd, &hello, sizeof(hello)) || hello.magic != kRemoteMagic || hello.version != kRemoteVersion)
+    {
+        return false;
+    }
+
+    Swarm swarm(hello.numRows, hello.numDims);
+    std::vector<uint32_t> entries;
+    std::vector<double> fitnesses;
+    for (;;)
+    {
+        RemoteMessage message;
+        if (!remoteRead(fd, &message, sizeof(message)))
+        {
+            return false;
+        }
+        if (message.type == kRemoteShutdown)
+        {
+            return true;
+        }
+        if (message.type != kRemoteBatch)
+        {
+            return false;
+        }
+
+        entries.resize(2 * message.count);
+        if (!remoteRead(fd, entries.data(), entries.size() * sizeof(uint32_t)))
+        {
+            return false;
+        }
+        for (uint32_t k = 0; k < message.count; k++)
+        {
+            if (entries[2*k] >= hello.numRows ||
+                (entries[2*k+1] && !remoteRead(fd, swarm.position(entries[2*k]), hello.numDims * sizeof(double))))
+            {
+                return false;
+            }
+        }
+
+        fitnesses.resize(message.count);
+        for (uint32_t k = 0; k < message.count; k++)
+        {
+            fitnesses[k] = objective(swarm[entries[2*k]]);
+        }
+
+        message.type = kRemoteResult;
+        if (!remoteWrite(fd, &message, sizeof(message)) ||
+            !remoteWrite(fd, fitnesses.data(), fitnesses.size() * sizeof(double)))
+        {
+            return false;
+        }
+    }
+}
+
+#endif /* REMOTE_H_ */
@@ -47,12 +47,12 @@ public:
         initializeRNG();
     }
 
+    // The copy continues the exact same stream as rhs
     RandomNumberGenerator(const RandomNumberGenerator& rhs)
     {
         mRngType = rhs.mRngType;
         mRng = gsl_rng_clone( rhs.mRng );
-        mSeed = rhs.randomSeed();
-        gsl_rng_set (mRng, mSeed);
+        mSeed = rhs.mSeed;
     }
 
     ~RandomNumberGenerator()
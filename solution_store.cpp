@@ -0,0 +1,245 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * solution_store.cpp
+ */
+#include "solution_store.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include <unistd.h>
+
+SolutionStoreOptions::SolutionStoreOptions()
+    : numNeighbours(4), seedFraction(0.25), solutionsPerRecord(8), maxRecords(1024)
+{
+}
+
+SolutionStore::SolutionStore(const std::string& filename, const SolutionStoreOptions& options)
+    : mFilename(filename), mOptions(options)
+{
+    load();
+}
+
+static double squaredDistance(const std::vector<double>& a, const std::vector<double>& b)
+{
+    double sum = 0.0;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        sum += (a[i] - b[i]) * (a[i] - b[i]);
+    }
+    return sum;
+}
+
+void SolutionStore::nearest(const std::string& key, const std::vector<double>& features, const size_t numDims,
+                            std::vector<const SolutionRecord*>* neighbours) const
+{
+    // Ties go to the most recent record
+    std::vector< std::pair<double, size_t> > candidates;
+    for (size_t r = mRecords.size(); r-- > 0; )
+    {
+        const SolutionRecord& record = mRecords[r];
+        if (record.key == key && record.numDims == numDims && record.features.size() == features.size())
+        {
+            candidates.push_back(std::make_pair(squaredDistance(record.features, features), mRecords.size() - r));
+        }
+    }
+    const size_t k = std::min<size_t>(mOptions.numNeighbours, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + k, candidates.end());
+
+    neighbours->clear();
+    for (size_t i = 0; i < k; i++)
+    {
+        neighbours->push_back(&mRecords[mRecords.size() - candidates[i].second]);
+    }
+}
+
+size_t SolutionStore::seeds(const std::string& key, const std::vector<double>& features, const size_t numDims,
+                            const size_t maxSeeds, std::vector<dim_t>* positions, std::vector<dim_t>* velocities) const
+{
+    std::vector<const SolutionRecord*> neighbours;
+    nearest(key, features, numDims, &neighbours);
+
+    positions->clear();
+    velocities->clear();
+    size_t numSeeds = 0;
+    for (size_t rank = 0; numSeeds < maxSeeds; rank++)
+    {
+        bool any = false;
+        for (size_t n = 0; n < neighbours.size() && numSeeds < maxSeeds; n++)
+        {
+            const SolutionRecord& record = *neighbours[n];
+            if (rank < record.numSolutions())
+            {
+                const size_t offset = rank * numDims;
+                positions->insert(positions->end(), record.positions.begin() + offset,
+                                  record.positions.begin() + offset + numDims);
+                velocities->insert(velocities->end(), record.velocities.begin() + offset,
+                                   record.velocities.begin() + offset + numDims);
+                numSeeds++;
+                any = true;
+            }
+        }
+        if (!any)
+        {
+            break;
+        }
+    }
+    return numSeeds;
+}
+
+template<class T>
+void SolutionStore::add(const std::string& key, const std::vector<double>& features, const BasicSwarm<T>& swarm)
+{
+    const prob_t* pbestFitness = swarm.pbestFitnesses();
+    const size_t numDims = swarm.numDims();
+
+    // Particles that were evaluated at least once, best first
+    std::vector<size_t> order;
+    for (size_t i = 0; i < swarm.size(); i++)
+    {
+        if (pbestFitness[i] > -1.0 * std::numeric_limits<prob_t>::max())
+        {
+            order.push_back(i);
+        }
+    }
+    const size_t m = std::min<size_t>(mOptions.solutionsPerRecord, order.size());
+    if (m == 0)
+    {
+        return;
+    }
+    std::partial_sort(order.begin(), order.begin() + m, order.end(),
+                      [pbestFitness](const size_t a, const size_t b)
+                      {
+                          return pbestFitness[a] > pbestFitness[b] || (pbestFitness[a] == pbestFitness[b] && a < b);
+                      });
+
+    SolutionRecord record;
+    record.key = key;
+    record.features = features;
+    record.numDims = numDims;
+    for (size_t k = 0; k < m; k++)
+    {
+        const size_t i = order[k];
+        record.positions.insert(record.positions.end(), swarm.pbestPosition(i), swarm.pbestPosition(i) + numDims);
+        record.velocities.insert(record.velocities.end(), swarm.velocity(i), swarm.velocity(i) + numDims);
+        record.fitnesses.push_back(pbestFitness[i]);
+    }
+
+    // The same problem again replaces its record
+    for (size_t r = 0; r < mRecords.size(); r++)
+    {
+        if (mRecords[r].key == key && mRecords[r].numDims == numDims && mRecords[r].features == features)
+        {
+            mRecords.erase(mRecords.begin() + r);
+            break;
+        }
+    }
+    mRecords.push_back(record);
+    if (mRecords.size() > mOptions.maxRecords)
+    {
+        mRecords.erase(mRecords.begin(), mRecords.end() - mOptions.maxRecords);
+    }
+}
+
+template void SolutionStore::add(const std::string&, const std::vector<double>&, const Swarm&);
+template void SolutionStore::add(const std::string&, const std::vector<double>&, const FloatSwarm&);
+
+void SolutionStore::save() const
+{
+    const std::string tmp = mFilename + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f)
+    {
+        throw std::runtime_error("SolutionStore: can't create " + tmp);
+    }
+    SolutionStoreHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kSolutionStoreMagic, sizeof(header.magic));
+    header.version = kSolutionStoreVersion;
+    header.numRecords = mRecords.size();
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    for (size_t r = 0; r < mRecords.size() && ok; r++)
+    {
+        const SolutionRecord& record = mRecords[r];
+        const uint32_t sizes[4] = { static_cast<uint32_t>(record.key.size()), static_cast<uint32_t>(record.features.size()),
+                                    record.numDims, static_cast<uint32_t>(record.numSolutions()) };
+        ok = fwrite(sizes, sizeof(sizes), 1, f) == 1 &&
+            fwrite(record.key.data(), 1, record.key.size(), f) == record.key.size() &&
+            fwrite(record.features.data(), sizeof(double), record.features.size(), f) == record.features.size() &&
+            fwrite(record.positions.data(), sizeof(dim_t), record.positions.size(), f) == record.positions.size() &&
+            fwrite(record.velocities.data(), sizeof(dim_t), record.velocities.size(), f) == record.velocities.size() &&
+            fwrite(record.fitnesses.data(), sizeof(prob_t), record.fitnesses.size(), f) == record.fitnesses.size();
+    }
+    // On disk before the rename, like Checkpoint::save()
+    ok = ok && fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp.c_str(), mFilename.c_str()) != 0)
+    {
+        remove(tmp.c_str());
+        throw std::runtime_error("SolutionStore: can't write " + mFilename);
+    }
+}
+
+void SolutionStore::load()
+{
+    mRecords.clear();
+    FILE* f = fopen(mFilename.c_str(), "rb");
+    if (!f)
+    {
+        return; // A new store
+    }
+    SolutionStoreHeader header;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+        memcmp(header.magic, kSolutionStoreMagic, sizeof(header.magic)) == 0 &&
+        header.version == kSolutionStoreVersion;
+    for (uint32_t r = 0; ok && r < header.numRecords; r++)
+    {
+        uint32_t sizes[4];
+        ok = fread(sizes, sizeof(sizes), 1, f) == 1;
+        if (!ok)
+        {
+            break;
+        }
+        SolutionRecord record;
+        record.key.resize(sizes[0]);
+        record.features.resize(sizes[1]);
+        record.numDims = sizes[2];
+        record.positions.resize(1ul * sizes[3] * sizes[2]);
+        record.velocities.resize(record.positions.size());
+        record.fitnesses.resize(sizes[3]);
+        ok = fread(&record.key[0], 1, record.key.size(), f) == record.key.size() &&
+            fread(record.features.data(), sizeof(double), record.features.size(), f) == record.features.size() &&
+            fread(record.positions.data(), sizeof(dim_t), record.positions.size(), f) == record.positions.size() &&
+            fread(record.velocities.data(), sizeof(dim_t), record.velocities.size(), f) == record.velocities.size() &&
+            fread(record.fitnesses.data(), sizeof(prob_t), record.fitnesses.size(), f) == record.fitnesses.size();
+        if (ok)
+        {
+            mRecords.push_back(record);
+        }
+    }
+    fclose(f);
+    if (!ok)
+    {
+        mRecords.clear();
+        throw std::runtime_error("SolutionStore: not a valid solution store: " + mFilename);
+    }
+}
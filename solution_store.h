@@ -0,0 +1,145 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * solution_store.h
+ */
+
+#ifndef SOLUTION_STORE_H_
+#define SOLUTION_STORE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "dim.h"
+#include "swarm.h"
+
+static const char kSolutionStoreMagic[8] = { 'P', 'S', 'O', 'S', 'O', 'L', '0', '1' };
+static const uint32_t kSolutionStoreVersion = 1;
+
+struct SolutionStoreHeader
+{
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    numRecords;
+};
+
+struct SolutionStoreOptions
+{
+    SolutionStoreOptions();
+
+    // Most similar earlier problems the seeds are drawn from
+    unsigned int    numNeighbours;
+
+    // Largest fraction of a swarm that is seeded, the rest stays random
+    double          seedFraction;
+
+    // Best particles kept from each finished run
+    unsigned int    solutionsPerRecord;
+
+    // Records kept in the file; the oldest are dropped first
+    unsigned int    maxRecords;
+};
+
+// The best particles of one finished run: personal best positions, the
+// velocities the particles had and the personal best fitnesses, best first
+// (so the first one is the global best).
+struct SolutionRecord
+{
+    std::string         key;
+    std::vector<double> features;
+    uint32_t            numDims;
+    std::vector<dim_t>  positions;      // numSolutions() x numDims
+    std::vector<dim_t>  velocities;     // numSolutions() x numDims
+    std::vector<prob_t> fitnesses;
+
+    size_t numSolutions() const
+    {
+        return fitnesses.size();
+    }
+};
+
+// Solutions of earlier runs, kept on disk so that recurring problems can
+// start from where similar ones ended instead of from random positions.
+//
+// A problem is identified by a key (whatever names it: the objective, the
+// layout of the Dims...) and described by a feature vector (for instance
+// summary statistics of its data). Seeds come from the records with the
+// same key and number of dimensions whose features are the nearest in
+// Euclidean distance. A run whose key and features are identical to an
+// earlier one replaces its record.
+//
+// The file is the header followed by the records, each one its key length,
+// number of features, dimensions and solutions (uint32_t), the key, then
+// the features, positions, velocities and fitnesses, in the byte order of
+// the machine that wrote it.
+class SolutionStore
+{
+public:
+    // Read filename if it exists. Throws std::runtime_error if it exists
+    // but isn't a solution store.
+    explicit SolutionStore(const std::string& filename,
+                           const SolutionStoreOptions& options = SolutionStoreOptions());
+
+    const SolutionStoreOptions& getOptions() const
+    {
+        return mOptions;
+    }
+
+    size_t size() const
+    {
+        return mRecords.size();
+    }
+
+    const SolutionRecord& record(const size_t i) const
+    {
+        return mRecords[i];
+    }
+
+    // Up to numNeighbours records of key and numDims, nearest features first
+    void nearest(const std::string& key, const std::vector<double>& features, const size_t numDims,
+                 std::vector<const SolutionRecord*>* neighbours) const;
+
+    // Fill up to maxSeeds rows of positions and velocities (numDims values
+    // each) from the nearest records: the best solution of every neighbour,
+    // nearest first, then their second best, and so on. Returns the number
+    // of rows filled.
+    size_t seeds(const std::string& key, const std::vector<double>& features, const size_t numDims,
+                 const size_t maxSeeds, std::vector<dim_t>* positions, std::vector<dim_t>* velocities) const;
+
+    // Keep the solutionsPerRecord best personal bests of a finished run.
+    // Instantiated for Swarm and FloatSwarm.
+    template<class T>
+    void add(const std::string& key, const std::vector<double>& features, const BasicSwarm<T>& swarm);
+
+    // Write to a temporary file renamed to the store file once complete.
+    // Throws std::runtime_error on failure.
+    void save() const;
+
+private:
+    SolutionStore(const SolutionStore&);
+    void operator=(const SolutionStore&);
+
+    void load();
+
+    std::string                 mFilename;
+    SolutionStoreOptions        mOptions;
+    std::vector<SolutionRecord> mRecords;   // Oldest first
+};
+
+#endif /* SOLUTION_STORE_H_ */
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * stopping.cpp
+ */
+#include "stopping.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+const char* stopReasonName(const StopReason reason)
+{
+    switch (reason)
+    {
+    case kStopNotStopped:
+        return "not stopped";
+    case kStopMaxIterations:
+        return "maximum iterations";
+    case kStopStagnation:
+        return "stagnation";
+    case kStopSwarmDiameter:
+        return "swarm diameter";
+    case kStopVelocity:
+        return "velocity";
+    case kStopTargetFitness:
+        return "target fitness";
+    case kStopTimeBudget:
+        return "time budget";
+    case kStopEvaluationBudget:
+        return "evaluation budget";
+    }
+    return "unknown";
+}
+
+StoppingCriteria::StoppingCriteria()
+    : stagnationIterations(0), stagnationTolerance(0.0), minSwarmDiameter(0.0), minVelocityNorm(0.0),
+    useTargetFitness(false), targetFitness(0.0), maxSeconds(0.0), maxEvaluations(0)
+{
+}
+
+StoppingMonitor::StoppingMonitor()
+    : mLastBest(-1.0 * std::numeric_limits<prob_t>::max()), mNumStagnant(0)
+{
+}
+
+void StoppingMonitor::start(const size_t numDims)
+{
+    mStart = std::chrono::steady_clock::now();
+    mLastBest = -1.0 * std::numeric_limits<prob_t>::max();
+    mNumStagnant = 0;
+    if (mLow.size() != numDims)
+    {
+        mLow.resize(numDims);
+        mHigh.resize(numDims);
+    }
+}
+
+void StoppingMonitor::resume(const size_t numDims, const StoppingState& state)
+{
+    start(numDims);
+    mStart -= std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(state.elapsedSeconds));
+    mLastBest = state.lastBest;
+    mNumStagnant = state.numStagnant;
+}
+
+StoppingState StoppingMonitor::getState() const
+{
+    StoppingState state;
+    state.elapsedSeconds = elapsedSeconds();
+    state.lastBest = mLastBest;
+    state.numStagnant = mNumStagnant;
+    return state;
+}
+
+double StoppingMonitor::elapsedSeconds() const
+{
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - mStart;
+    return elapsed.count();
+}
+
+StopReason StoppingMonitor::checkBudgets(const prob_t gbestFitness, const unsigned long numEvaluations) const
+{
+    if (mCriteria.useTargetFitness && gbestFitness >= mCriteria.targetFitness)
+    {
+        return kStopTargetFitness;
+    }
+    if (mCriteria.maxEvaluations > 0 && numEvaluations >= mCriteria.maxEvaluations)
+    {
+        return kStopEvaluationBudget;
+    }
+    if (mCriteria.maxSeconds > 0.0 && elapsedSeconds() >= mCriteria.maxSeconds)
+    {
+        return kStopTimeBudget;
+    }
+    return kStopNotStopped;
+}
+
+template<class T>
+StopReason StoppingMonitor::check(const BasicSwarm<T>& swarm, const prob_t gbestFitness, const unsigned long numEvaluations)
+{
+    const StopReason reason = checkBudgets(gbestFitness, numEvaluations);
+    if (reason != kStopNotStopped)
+    {
+        return reason;
+    }
+
+    if (mCriteria.stagnationIterations > 0)
+    {
+        if (gbestFitness > mLastBest + mCriteria.stagnationTolerance)
+        {
+            mLastBest = gbestFitness;
+            mNumStagnant = 0;
+        }
+        else if (++mNumStagnant >= mCriteria.stagnationIterations)
+        {
+            return kStopStagnation;
+        }
+    }
+
+    if (mCriteria.minSwarmDiameter > 0.0 && swarmDiameter(swarm) < mCriteria.minSwarmDiameter)
+    {
+        return kStopSwarmDiameter;
+    }
+
+    if (mCriteria.minVelocityNorm > 0.0 && maxVelocityNorm(swarm) < mCriteria.minVelocityNorm)
+    {
+        return kStopVelocity;
+    }
+
+    return kStopNotStopped;
+}
+
+template<class T>
+double StoppingMonitor::swarmDiameter(const BasicSwarm<T>& swarm)
+{
+    const size_t numDims = swarm.numDims();
+    std::copy(swarm.position(0), swarm.position(0) + numDims, mLow.data());
+    std::copy(swarm.position(0), swarm.position(0) + numDims, mHigh.data());
+    for (size_t i = 1; i < swarm.size(); i++)
+    {
+        const T* pos = swarm.position(i);
+        for (size_t d = 0; d < numDims; d++)
+        {
+            mLow[d] = std::min<dim_t>(mLow[d], pos[d]);
+            mHigh[d] = std::max<dim_t>(mHigh[d], pos[d]);
+        }
+    }
+
+    double sum = 0.0;
+    for (size_t d = 0; d < numDims; d++)
+    {
+        sum += (mHigh[d] - mLow[d]) * (mHigh[d] - mLow[d]);
+    }
+    return sqrt(sum);
+}
+
+template<class T>
+double StoppingMonitor::maxVelocityNorm(const BasicSwarm<T>& swarm) const
+{
+    double maxSum = 0.0;
+    for (size_t i = 0; i < swarm.size(); i++)
+    {
+        const T* vel = swarm.velocity(i);
+        double sum = 0.0;
+        for (size_t d = 0; d < swarm.numDims(); d++)
+        {
+            sum += static_cast<double>(vel[d]) * vel[d];
+        }
+        maxSum = std::max(maxSum, sum);
+    }
+    return sqrt(maxSum);
+}
+
+template StopReason StoppingMonitor::check(const Swarm&, const prob_t, const unsigned long);
+template StopReason StoppingMonitor::check(const FloatSwarm&, const prob_t, const unsigned long);
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * stopping.h
+ */
+
+#ifndef STOPPING_H_
+#define STOPPING_H_
+
+#include <chrono>
+#include <cstddef>
+
+#include "aligned.h"
+#include "dim.h"
+#include "swarm.h"
+
+// Why a run stopped
+enum StopReason
+{
+    kStopNotStopped = 0,    // Still running
+    kStopMaxIterations,     // Ran all the iterations
+    kStopStagnation,        // The global best didn't improve for a while
+    kStopSwarmDiameter,     // The swarm collapsed
+    kStopVelocity,          // The particles stopped moving
+    kStopTargetFitness,     // The global best is good enough
+    kStopTimeBudget,        // Out of wall-clock time
+    kStopEvaluationBudget   // Out of fitness evaluations
+};
+
+const char* stopReasonName(const StopReason reason);
+
+// Optional early termination tests. Every test is disabled by default.
+struct StoppingCriteria
+{
+    StoppingCriteria();
+
+    // Stop when the global best fitness improved by no more than
+    // stagnationTolerance over stagnationIterations iterations (0 = off)
+    unsigned int    stagnationIterations;
+    double          stagnationTolerance;
+
+    // Stop when the diagonal of the bounding box of all particle positions
+    // is below this (0 = off). The diagonal is an upper bound on the swarm
+    // diameter and costs a single pass over the swarm.
+    double          minSwarmDiameter;
+
+    // Stop when the largest velocity (Euclidean norm) is below this (0 = off)
+    double          minVelocityNorm;
+
+    // Stop as soon as the global best fitness reaches targetFitness
+    bool            useTargetFitness;
+    double          targetFitness;
+
+    // Wall-clock time budget in seconds (0 = off)
+    double          maxSeconds;
+
+    // Budget of fitness evaluations (0 = off)
+    unsigned long   maxEvaluations;
+};
+
+// What StoppingMonitor remembers of a run, for checkpoints
+struct StoppingState
+{
+    double          elapsedSeconds;
+    prob_t          lastBest;
+    unsigned int    numStagnant;
+};
+
+// Applies StoppingCriteria to a running swarm.
+class StoppingMonitor
+{
+public:
+    StoppingMonitor();
+
+    void setCriteria(const StoppingCriteria& criteria)
+    {
+        mCriteria = criteria;
+    }
+
+    const StoppingCriteria& getCriteria() const
+    {
+        return mCriteria;
+    }
+
+    // Start a new run. Sizes the scratch space, so check() doesn't allocate.
+    void start(const size_t numDims);
+
+    // Continue a run from a checkpoint
+    void resume(const size_t numDims, const StoppingState& state);
+
+    StoppingState getState() const;
+
+    // Tests that only need the global best and the counters, cheap enough
+    // to run after every single evaluation
+    StopReason checkBudgets(const prob_t gbestFitness, const unsigned long numEvaluations) const;
+
+    // All tests, once per iteration after the particles have moved.
+    // Instantiated for Swarm and FloatSwarm.
+    template<class T>
+    StopReason check(const BasicSwarm<T>& swarm, const prob_t gbestFitness, const unsigned long numEvaluations);
+
+    double elapsedSeconds() const;
+
+private:
+    template<class T>
+    double swarmDiameter(const BasicSwarm<T>& swarm);
+    template<class T>
+    double maxVelocityNorm(const BasicSwarm<T>& swarm) const;
+
+    StoppingCriteria                        mCriteria;
+    std::chrono::steady_clock::time_point   mStart;
+    prob_t                                  mLastBest;
+    unsigned int                            mNumStagnant;
+    AlignedBuffer<dim_t>                    mLow;
+    AlignedBuffer<dim_t>                    mHigh;
+};
+
+#endif /* STOPPING_H_ */
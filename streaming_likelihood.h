@@ -0,0 +1,221 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * streaming_likelihood.h
+ */
+
+#ifndef STREAMING_LIKELIHOOD_H_
+#define STREAMING_LIKELIHOOD_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include "columnar_data.h"
+#include "dim.h"
+#include "swarm.h"
+#include "thread_pool.h"
+
+struct StreamingOptions
+{
+    StreamingOptions() : blockRows(8192), initialFraction(1.0), fractionGrowth(2.0) {}
+
+    size_t  blockRows;          // Rows per block; a few columns of 8192 rows stay in L2
+    double  initialFraction;    // Fraction of the blocks read by the first call (1: always all)
+    double  fractionGrowth;     // Factor the fraction grows by at each call, up to 1
+};
+
+// Log-likelihood fitness of a data set too large for memory. The data are
+// read through a ColumnarData map one block of rows at a time, and every
+// particle of the swarm is evaluated against a block before moving to the
+// next one, so each call reads the data once however many particles there
+// are. The per-row log densities are added with Neumaier's compensated
+// summation.
+//
+// With initialFraction < 1 the first calls only read every k-th block
+// (starting from a different block at each call) and scale the sum up to
+// the whole data set. The fraction grows by fractionGrowth per call until
+// the whole data set is read, so early iterations are cheap but noisy.
+//
+// The model gives the log densities of the rows of a block:
+//   void logDensities(const dim_t* params, const double* const* columns,
+//                     const size_t numRows, double* out) const
+// where columns[c] points to the block's rows of the c-th column passed to
+// the constructor. It is called concurrently when a ThreadPool is set.
+template<class Model>
+class StreamingLikelihood
+{
+public:
+    StreamingLikelihood(const ColumnarData& data, const Model& model, const std::vector<size_t>& columns,
+                        const StreamingOptions& options = StreamingOptions())
+        : mData(data), mModel(model), mColumns(columns), mOptions(options), mPool(0), mNumCalls(0),
+        mLastFraction(1.0), mColumnPointers(columns.size()), mBuffer(options.blockRows)
+    {
+        assert(options.blockRows > 0);
+        for (size_t c = 0; c < columns.size(); c++)
+        {
+            assert(columns[c] < data.numColumns());
+        }
+    }
+
+    // Evaluate the particles of each block in parallel (0 to evaluate them
+    // serially)
+    void setThreadPool(ThreadPool* pool)
+    {
+        mPool = pool;
+        mBuffer.resize(mOptions.blockRows * (mPool ? mPool->size() : 1));
+    }
+
+    // Start the subsampling schedule again, for a new run
+    void reset()
+    {
+        mNumCalls = 0;
+    }
+
+    void operator()(const Swarm& particleSet, std::vector<double>* particleFitnesses)
+    {
+        const size_t numParticles = particleSet.size();
+        mSums.assign(numParticles, 0.0);
+        mCompensations.assign(numParticles, 0.0);
+
+        // Blocks b with b % stride == offset
+        const size_t numBlocks = (mData.numRows() + mOptions.blockRows - 1) / mOptions.blockRows;
+        const double fraction = std::min(1.0, mOptions.initialFraction * pow(mOptions.fractionGrowth, 1.0 * mNumCalls));
+        const size_t stride = std::max<size_t>(1, std::min<size_t>(numBlocks, floor(1.0 / fraction + 0.5)));
+        const size_t offset = mNumCalls % stride;
+        mNumCalls++;
+
+        size_t rowsUsed = 0;
+        for (size_t b = offset; b < numBlocks; b += stride)
+        {
+            const size_t first = b * mOptions.blockRows;
+            const size_t numRows = std::min(mOptions.blockRows, mData.numRows() - first);
+            if (b + stride < numBlocks)
+            {
+                mData.willNeed((b + stride) * mOptions.blockRows, mOptions.blockRows);
+            }
+            for (size_t c = 0; c < mColumns.size(); c++)
+            {
+                mColumnPointers[c] = mData.column(mColumns[c]) + first;
+            }
+
+            Block block = { this, &particleSet, numRows };
+            if (mPool)
+            {
+                mPool->parallelFor(numParticles, 1, block);
+            }
+            else
+            {
+                block(0, numParticles);
+            }
+            rowsUsed += numRows;
+        }
+
+        mLastFraction = (mData.numRows() > 0) ? 1.0 * rowsUsed / mData.numRows() : 1.0;
+        const double scale = (rowsUsed > 0) ? 1.0 * mData.numRows() / rowsUsed : 0.0;
+        for (size_t i = 0; i < numParticles; i++)
+        {
+            (*particleFitnesses)[i] = scale * (mSums[i] + mCompensations[i]);
+        }
+    }
+
+    unsigned long getNumCalls() const
+    {
+        return mNumCalls;
+    }
+
+    // Fraction of the rows read by the last call
+    double getLastFraction() const
+    {
+        return mLastFraction;
+    }
+
+private:
+    // Every particle in [begin, end) against the current block
+    struct Block
+    {
+        StreamingLikelihood*    likelihood;
+        const Swarm*            particleSet;
+        size_t                  numRows;
+
+        void operator()(const size_t begin, const size_t end)
+        {
+            StreamingLikelihood& l = *likelihood;
+            const unsigned int thread = ThreadPool::currentThread(l.mPool);
+            assert(l.mOptions.blockRows * (thread + 1) <= l.mBuffer.size());
+            double* out = l.mBuffer.data() + l.mOptions.blockRows * thread;
+            for (size_t i = begin; i < end; i++)
+            {
+                l.mModel.logDensities(particleSet->position(i), l.mColumnPointers.data(), numRows, out);
+
+                // Neumaier summation
+                double sum = l.mSums[i];
+                double compensation = l.mCompensations[i];
+                for (size_t r = 0; r < numRows; r++)
+                {
+                    const double t = sum + out[r];
+                    compensation += (fabs(sum) >= fabs(out[r])) ? (sum - t) + out[r] : (out[r] - t) + sum;
+                    sum = t;
+                }
+                l.mSums[i] = sum;
+                l.mCompensations[i] = compensation;
+            }
+        }
+    };
+
+    const ColumnarData&         mData;
+    Model                       mModel;
+    std::vector<size_t>         mColumns;
+    StreamingOptions            mOptions;
+    ThreadPool*                 mPool;
+    unsigned long               mNumCalls;
+    double                      mLastFraction;
+
+    std::vector<const double*>  mColumnPointers;
+    std::vector<double>         mBuffer;        // blockRows per thread
+    std::vector<double>         mSums;
+    std::vector<double>         mCompensations;
+};
+
+// Gaussian model of one column for StreamingLikelihood. A particle is the
+// mean, and also the standard deviation (keep its Dim above zero) unless a
+// fixed one is given.
+class GaussianModel
+{
+public:
+    explicit GaussianModel(const double fixedStd = 0.0) : mFixedStd(fixedStd) {}
+
+    void logDensities(const dim_t* params, const double* const* columns, const size_t numRows, double* out) const
+    {
+        const double mean = params[0];
+        const double std = (mFixedStd > 0.0) ? mFixedStd : params[1];
+        const double invStd = 1.0 / std;
+        const double norm = -log(std) - 0.5 * log(2.0 * M_PI);
+        const double* x = columns[0];
+        for (size_t r = 0; r < numRows; r++)
+        {
+            const double z = (x[r] - mean) * invStd;
+            out[r] = norm - 0.5 * z * z;
+        }
+    }
+
+private:
+    double  mFixedStd;
+};
+
+#endif /* STREAMING_LIKELIHOOD_H_ */
@@ -0,0 +1,319 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * surrogate.cpp
+ */
+#include "surrogate.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+Surrogate::Surrogate(const std::vector<Dim>& dims, const SurrogateOptions& options)
+    : mOptions(options), mNumDims(dims.size()), mMin(dims.size()), mInvRange(dims.size()),
+    mSize(0), mNext(0), mNumInserts(0), mWeightsValid(false),
+    mPoints(options.capacity * dims.size()), mValues(options.capacity),
+    mInverse(options.capacity * options.capacity), mWeights(options.capacity), mMean(0.0), mScale(1.0),
+    mQuery(dims.size()), mK(options.capacity), mPK(options.capacity),
+    mFactor(options.capacity * options.capacity), mNumScreenedOut(0), mNumExplored(0)
+{
+    assert(options.capacity > 0 && options.lengthScale > 0.0);
+    for (size_t d = 0; d < mNumDims; d++)
+    {
+        mMin[d] = dims[d].min();
+        mInvRange[d] = 1.0 / (dims[d].max() - dims[d].min());
+    }
+    const double length = mOptions.lengthScale * sqrt(1.0 * mNumDims);
+    mInvTwoLengthSquared = 0.5 / (length * length);
+}
+
+void Surrogate::insert(const dim_t* pos, const prob_t fitness)
+{
+    size_t j = 0;
+    if (mSize < mOptions.capacity)
+    {
+        j = mSize++;
+    }
+    else
+    {
+        // Replace the oldest evaluation
+        j = mNext;
+        mNext = (mNext + 1) % mOptions.capacity;
+        downdate(j);
+    }
+    normalize(pos, &mPoints[j * mNumDims]);
+    mValues[j] = fitness;
+
+    mNumInserts++;
+    if (mNumInserts % mOptions.rebuildInterval == 0)
+    {
+        rebuild();
+    }
+    else
+    {
+        update(j);
+    }
+    mWeightsValid = false;
+}
+
+void Surrogate::predict(const dim_t* pos, double* mean, double* stddev)
+{
+    if (mSize == 0)
+    {
+        *mean = 0.0;
+        *stddev = std::numeric_limits<double>::infinity();
+        return;
+    }
+    if (!mWeightsValid)
+    {
+        refreshWeights();
+    }
+
+    normalize(pos, mQuery.data());
+    double m = 0.0;
+    for (size_t a = 0; a < mSize; a++)
+    {
+        mK[a] = kernel(mQuery.data(), &mPoints[a * mNumDims]);
+        m += mK[a] * mWeights[a];
+    }
+
+    // Variance 1 + nugget - k' K^-1 k, in units of mScale^2
+    double explained = 0.0;
+    for (size_t a = 0; a < mSize; a++)
+    {
+        const double* row = &mInverse[a * mOptions.capacity];
+        double pk = 0.0;
+        for (size_t b = 0; b < mSize; b++)
+        {
+            pk += row[b] * mK[b];
+        }
+        explained += mK[a] * pk;
+    }
+    *mean = mMean + mScale * m;
+    *stddev = mScale * sqrt(std::max(1.0 + mOptions.nugget - explained, 0.0));
+}
+
+bool Surrogate::worthEvaluating(const dim_t* pos, const prob_t pbestFitness, const double u)
+{
+    double mean = 0.0;
+    double stddev = 0.0;
+    predict(pos, &mean, &stddev);
+    if (mean + mOptions.kappa * stddev > pbestFitness)
+    {
+        return true;
+    }
+    if (u < mOptions.explorationRate)
+    {
+        mNumExplored++;
+        return true;
+    }
+    mNumScreenedOut++;
+    return false;
+}
+
+void Surrogate::clear()
+{
+    mSize = 0;
+    mNext = 0;
+    mWeightsValid = false;
+    std::fill(mInverse.begin(), mInverse.end(), 0.0);
+}
+
+double Surrogate::kernel(const double* a, const double* b) const
+{
+    double r2 = 0.0;
+    for (size_t d = 0; d < mNumDims; d++)
+    {
+        const double delta = a[d] - b[d];
+        r2 += delta * delta;
+    }
+    return exp(-r2 * mInvTwoLengthSquared);
+}
+
+void Surrogate::normalize(const dim_t* pos, double* out) const
+{
+    for (size_t d = 0; d < mNumDims; d++)
+    {
+        out[d] = (pos[d] - mMin[d]) * mInvRange[d];
+    }
+}
+
+void Surrogate::downdate(const size_t j)
+{
+    // Inverse of the matrix without row and column j:
+    // P' = P - P[:,j] P[j,:] / P[j,j]
+    const double pjj = inverse(j, j);
+    for (size_t a = 0; a < mSize; a++)
+    {
+        if (a == j)
+        {
+            continue;
+        }
+        const double f = inverse(a, j) / pjj;
+        for (size_t b = 0; b < mSize; b++)
+        {
+            if (b != j)
+            {
+                inverse(a, b) -= f * inverse(j, b);
+            }
+        }
+    }
+    for (size_t a = 0; a < mSize; a++)
+    {
+        inverse(a, j) = 0.0;
+        inverse(j, a) = 0.0;
+    }
+}
+
+void Surrogate::update(const size_t j)
+{
+    // Bordering: with b the kernel column of the new point (zero at j) and
+    // P the inverse of the others, s = 1 + nugget - b'Pb and
+    //   P' = [ P + Pb b'P / s   -Pb / s ]
+    //        [ -b'P / s          1 / s  ]
+    const double* x = &mPoints[j * mNumDims];
+    for (size_t a = 0; a < mSize; a++)
+    {
+        mK[a] = (a == j) ? 0.0 : kernel(x, &mPoints[a * mNumDims]);
+    }
+    double bpb = 0.0;
+    for (size_t a = 0; a < mSize; a++)
+    {
+        const double* row = &mInverse[a * mOptions.capacity];
+        double pb = 0.0;
+        for (size_t b = 0; b < mSize; b++)
+        {
+            pb += row[b] * mK[b];
+        }
+        mPK[a] = pb;
+        bpb += mK[a] * pb;
+    }
+
+    // The Schur complement is at least the nugget, up to rounding
+    const double s = std::max(1.0 + mOptions.nugget - bpb, mOptions.nugget);
+    for (size_t a = 0; a < mSize; a++)
+    {
+        if (a == j)
+        {
+            continue;
+        }
+        const double f = mPK[a] / s;
+        for (size_t b = 0; b < mSize; b++)
+        {
+            if (b != j)
+            {
+                inverse(a, b) += f * mPK[b];
+            }
+        }
+        inverse(a, j) = -f;
+        inverse(j, a) = -f;
+    }
+    inverse(j, j) = 1.0 / s;
+}
+
+void Surrogate::rebuild()
+{
+    // Cholesky factor L of the kernel matrix, in the lower half of mFactor
+    const size_t n = mSize;
+    const size_t stride = mOptions.capacity;
+    for (size_t a = 0; a < n; a++)
+    {
+        for (size_t b = 0; b <= a; b++)
+        {
+            double sum = kernel(&mPoints[a * mNumDims], &mPoints[b * mNumDims]);
+            if (a == b)
+            {
+                sum += mOptions.nugget;
+            }
+            for (size_t k = 0; k < b; k++)
+            {
+                sum -= mFactor[a * stride + k] * mFactor[b * stride + k];
+            }
+            if (a == b)
+            {
+                mFactor[a * stride + a] = sqrt(std::max(sum, mOptions.nugget));
+            }
+            else
+            {
+                mFactor[a * stride + b] = sum / mFactor[b * stride + b];
+            }
+        }
+    }
+
+    // Column c of the inverse solves L L' x = e_c
+    for (size_t c = 0; c < n; c++)
+    {
+        for (size_t a = 0; a < n; a++)
+        {
+            double sum = (a == c) ? 1.0 : 0.0;
+            for (size_t k = 0; k < a; k++)
+            {
+                sum -= mFactor[a * stride + k] * mK[k];
+            }
+            mK[a] = sum / mFactor[a * stride + a];
+        }
+        for (size_t a = n; a-- > 0; )
+        {
+            double sum = mK[a];
+            for (size_t k = a + 1; k < n; k++)
+            {
+                sum -= mFactor[k * stride + a] * mPK[k];
+            }
+            mPK[a] = sum / mFactor[a * stride + a];
+        }
+        for (size_t a = 0; a < n; a++)
+        {
+            inverse(a, c) = mPK[a];
+        }
+    }
+}
+
+void Surrogate::refreshWeights()
+{
+    // Standardize the values, then weights = K^-1 y
+    double mean = 0.0;
+    for (size_t a = 0; a < mSize; a++)
+    {
+        mean += mValues[a];
+    }
+    mean /= mSize;
+    double variance = 0.0;
+    for (size_t a = 0; a < mSize; a++)
+    {
+        variance += (mValues[a] - mean) * (mValues[a] - mean);
+    }
+    variance /= mSize;
+    mMean = mean;
+    mScale = (variance > 0.0) ? sqrt(variance) : 1.0;
+
+    for (size_t a = 0; a < mSize; a++)
+    {
+        mK[a] = (mValues[a] - mMean) / mScale;
+    }
+    for (size_t a = 0; a < mSize; a++)
+    {
+        const double* row = &mInverse[a * mOptions.capacity];
+        double w = 0.0;
+        for (size_t b = 0; b < mSize; b++)
+        {
+            w += row[b] * mK[b];
+        }
+        mWeights[a] = w;
+    }
+    mWeightsValid = true;
+}
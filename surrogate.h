@@ -0,0 +1,160 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * surrogate.h
+ */
+
+#ifndef SURROGATE_H_
+#define SURROGATE_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "dim.h"
+
+struct SurrogateOptions
+{
+    SurrogateOptions()
+        : capacity(128), minPoints(16), lengthScale(0.1), nugget(1e-6), kappa(1.0),
+        explorationRate(0.1), rebuildInterval(1024)
+    {
+    }
+
+    size_t  capacity;           // Evaluations kept; the oldest one is replaced when full
+    size_t  minPoints;          // Everything is evaluated until the archive has this many
+    double  lengthScale;        // Kernel width, as a fraction of the diagonal of the bounds
+    double  nugget;             // Added to the kernel diagonal, for noise and conditioning
+    double  kappa;              // Standard deviations of optimism when screening
+    double  explorationRate;    // Fraction of the screened out positions evaluated anyway
+    size_t  rebuildInterval;    // Inserts between exact refactorizations of the model
+};
+
+// Gaussian process model (a Gaussian RBF interpolant with an uncertainty)
+// of the fitness, fitted to the last `capacity` true evaluations. It
+// pre-screens the positions of a swarm so that only the promising ones
+// cost a call to the fitness function.
+//
+// The inverse of the kernel matrix is kept up to date with rank-one
+// updates, so an insert costs O(capacity^2) and never a full solve, except
+// for an exact refactorization every rebuildInterval inserts that bounds
+// the rounding drift. All memory is allocated by the constructor.
+class Surrogate
+{
+public:
+    Surrogate(const std::vector<Dim>& dims, const SurrogateOptions& options = SurrogateOptions());
+
+    // Add a true evaluation
+    void insert(const dim_t* pos, const prob_t fitness);
+
+    // Whether the archive is large enough to screen with
+    bool ready() const
+    {
+        return mSize >= mOptions.minPoints;
+    }
+
+    // Predicted fitness at pos, and its standard deviation
+    void predict(const dim_t* pos, double* mean, double* stddev);
+
+    // Whether a position should get a true evaluation: when it might beat
+    // the given personal best fitness (mean + kappa * stddev above it), or
+    // otherwise when u, uniform in [0,1), is below the exploration rate.
+    bool worthEvaluating(const dim_t* pos, const prob_t pbestFitness, const double u);
+
+    // Forget every evaluation (the counters are kept)
+    void clear();
+
+    size_t size() const
+    {
+        return mSize;
+    }
+
+    size_t capacity() const
+    {
+        return mOptions.capacity;
+    }
+
+    const SurrogateOptions& getOptions() const
+    {
+        return mOptions;
+    }
+
+    // Positions screened out, and positions evaluated only to explore
+    unsigned long getNumScreenedOut() const
+    {
+        return mNumScreenedOut;
+    }
+
+    unsigned long getNumExplored() const
+    {
+        return mNumExplored;
+    }
+
+private:
+    // Prevent copying and assignment
+    Surrogate(const Surrogate&);
+    void operator=(const Surrogate&);
+
+    double kernel(const double* a, const double* b) const;
+
+    // Scale pos to the unit box, into out
+    void normalize(const dim_t* pos, double* out) const;
+
+    // Remove point j from the inverse
+    void downdate(const size_t j);
+
+    // Add point j to the inverse of the other mSize - 1 points
+    void update(const size_t j);
+
+    // Invert the kernel matrix from scratch (Cholesky)
+    void rebuild();
+
+    // Weights of the predictor, after inserts
+    void refreshWeights();
+
+    double& inverse(const size_t a, const size_t b)
+    {
+        return mInverse[a * mOptions.capacity + b];
+    }
+
+    SurrogateOptions        mOptions;
+    size_t                  mNumDims;
+    std::vector<double>     mMin;
+    std::vector<double>     mInvRange;
+    double                  mInvTwoLengthSquared;
+
+    size_t                  mSize;
+    size_t                  mNext;          // Slot of the next insert once full
+    size_t                  mNumInserts;
+    bool                    mWeightsValid;
+    std::vector<double>     mPoints;        // capacity x numDims, scaled to the unit box
+    std::vector<double>     mValues;
+    std::vector<double>     mInverse;       // capacity x capacity, of the first mSize points
+    std::vector<double>     mWeights;
+    double                  mMean;
+    double                  mScale;
+
+    // Scratch
+    std::vector<double>     mQuery;
+    std::vector<double>     mK;
+    std::vector<double>     mPK;
+    std::vector<double>     mFactor;
+
+    unsigned long           mNumScreenedOut;
+    unsigned long           mNumExplored;
+};
+
+#endif /* SURROGATE_H_ */
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * swarm.cpp
+ */
+#include "swarm.h"
+
+#include <algorithm>
+#include <limits>
+
+template<class T>
+BasicSwarm<T>::BasicSwarm()
+    : mNumParticles(0), mCapacity(0), mNumDims(0), mStride(0),
+    mPos(0), mVel(0), mPBestPos(0), mFitness(0), mPBestFitness(0)
+{
+}
+
+template<class T>
+BasicSwarm<T>::BasicSwarm(const size_t numParticles, const size_t numDims)
+    : mNumParticles(0), mCapacity(0), mNumDims(0), mStride(0),
+    mPos(0), mVel(0), mPBestPos(0), mFitness(0), mPBestFitness(0)
+{
+    resize(numParticles, numDims);
+}
+
+template<class T>
+void BasicSwarm<T>::resize(const size_t numParticles, const size_t numDims)
+{
+    mNumParticles = numParticles;
+    mCapacity = numParticles;
+    mNumDims = numDims;
+    mStride = alignedStride<T>(numDims);
+
+    // +1 for the global best row
+    const size_t numRows = mCapacity + 1;
+    mArena.reserve(3 * Arena::blockSize<T>(numRows * mStride) + 2 * Arena::blockSize<prob_t>(numRows));
+    mPos = mArena.allocate<T>(numRows * mStride);
+    mVel = mArena.allocate<T>(numRows * mStride);
+    mPBestPos = mArena.allocate<T>(numRows * mStride);
+    mFitness = mArena.allocate<prob_t>(numRows);
+    mPBestFitness = mArena.allocate<prob_t>(numRows);
+
+    for (size_t i = 0; i < numRows; i++)
+    {
+        resetParticle(i);
+    }
+}
+
+template<class T>
+BasicParticle<T> BasicSwarm<T>::row(const size_t i) const
+{
+    assert(i <= mCapacity);
+
+    // The view needs mutable pointers even when handed out as const.
+    BasicSwarm& self = const_cast<BasicSwarm&>(*this);
+    return BasicParticle<T>(self.position(i), self.velocity(i), self.pbestPosition(i),
+                            self.mFitness + i, self.mPBestFitness + i, mNumDims);
+}
+
+template<class T>
+BasicParticle<T> BasicSwarm<T>::operator[](const size_t i)
+{
+    assert(i < mNumParticles);
+    return row(i);
+}
+
+template<class T>
+const BasicParticle<T> BasicSwarm<T>::operator[](const size_t i) const
+{
+    assert(i < mNumParticles);
+    return row(i);
+}
+
+template<class T>
+void BasicSwarm<T>::resetParticle(const size_t i)
+{
+    assert(i <= mCapacity);
+    mFitness[i] = -1.0 * std::numeric_limits<prob_t>::max();
+    mPBestFitness[i] = mFitness[i];
+    std::copy(position(i), position(i) + mStride, pbestPosition(i));
+}
+
+template<class T>
+void BasicSwarm<T>::copyParticle(const size_t i, const BasicSwarm& src, const size_t j)
+{
+    assert(i <= mCapacity && j <= src.mCapacity);
+    assert(mStride == src.mStride);
+    std::copy(src.position(j), src.position(j) + mStride, position(i));
+    std::copy(src.velocity(j), src.velocity(j) + mStride, velocity(i));
+    std::copy(src.pbestPosition(j), src.pbestPosition(j) + mStride, pbestPosition(i));
+    mFitness[i] = src.mFitness[j];
+    mPBestFitness[i] = src.mPBestFitness[j];
+}
+
+template<class T>
+size_t BasicSwarm<T>::bestIndex() const
+{
+    assert(mNumParticles > 0);
+    const prob_t* f = mPBestFitness;
+    return std::max_element(f, f + mNumParticles) - f;
+}
+
+template<class T>
+size_t BasicSwarm<T>::updatePBests(const prob_t* fitness, const size_t begin, const size_t end)
+{
+    assert(begin < end && end <= mNumParticles);
+    size_t best = begin;
+    for (size_t i = begin; i < end; i++)
+    {
+        mFitness[i] = fitness[i];
+        if (fitness[i] > mPBestFitness[i])
+        {
+            mPBestFitness[i] = fitness[i];
+            std::copy(position(i), position(i) + mNumDims, pbestPosition(i));
+        }
+        if (mPBestFitness[i] > mPBestFitness[best])
+        {
+            best = i;
+        }
+    }
+    return best;
+}
+
+template<class T>
+void BasicSwarm<T>::setGBest(const size_t i)
+{
+    assert(i < mNumParticles);
+    const T* src = pbestPosition(i);
+    std::copy(src, src + mStride, position(mCapacity));
+    std::copy(src, src + mStride, pbestPosition(mCapacity));
+    mFitness[mCapacity] = mPBestFitness[i];
+    mPBestFitness[mCapacity] = mPBestFitness[i];
+}
+
+template<class T>
+BasicParticle<T> BasicSwarm<T>::gbest()
+{
+    return row(mCapacity);
+}
+
+template<class T>
+const BasicParticle<T> BasicSwarm<T>::gbest() const
+{
+    return row(mCapacity);
+}
+
+template class BasicSwarm<double>;
+template class BasicSwarm<float>;
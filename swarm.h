@@ -0,0 +1,198 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * swarm.h
+ */
+
+#ifndef SWARM_H_
+#define SWARM_H_
+
+#include <cassert>
+#include <cstddef>
+
+#include "aligned.h"
+#include "arena.h"
+#include "dim.h"
+#include "particle.h"
+
+// Structure-of-arrays storage for a whole swarm. Positions, velocities and
+// personal best positions are each stored as one contiguous N x D matrix
+// whose rows are padded to a cache line, and the fitnesses are stored as
+// contiguous arrays of length N. One extra row at the end of every matrix
+// holds the global best particle. All five arrays are carved out of a
+// single arena block, which resizing to the same or a smaller shape reuses.
+//
+// The number of particles in use can be lowered below the number that
+// was allocated (the capacity) without reallocating, which is how scratch
+// swarms holding a subset of another swarm are reused.
+//
+// T is the type of the coordinates (positions, velocities and personal
+// best positions). The fitnesses are prob_t whatever T is, so a float
+// swarm still compares and tracks its bests in double.
+template<class T>
+class BasicSwarm
+{
+public:
+    BasicSwarm();
+
+    BasicSwarm(const size_t numParticles, const size_t numDims);
+
+    // Previous contents are discarded and everything is zeroed. Memory is
+    // only allocated when the swarm grows.
+    void resize(const size_t numParticles, const size_t numDims);
+
+    // Number of particles (not counting the global best row)
+    size_t size() const
+    {
+        return mNumParticles;
+    }
+
+    // Number of particles allocated
+    size_t capacity() const
+    {
+        return mCapacity;
+    }
+
+    // Use the first n particles, n <= capacity(). Nothing is reallocated or reset.
+    void setSize(const size_t n)
+    {
+        assert(n <= mCapacity);
+        mNumParticles = n;
+    }
+
+    size_t numDims() const
+    {
+        return mNumDims;
+    }
+
+    // Distance, in elements, between the start of two consecutive rows
+    size_t stride() const
+    {
+        return mStride;
+    }
+
+    BasicParticle<T> operator[](const size_t i);
+    const BasicParticle<T> operator[](const size_t i) const;
+
+    T* position(const size_t i)
+    {
+        assert(i <= mCapacity);
+        return mPos + i * mStride;
+    }
+    const T* position(const size_t i) const
+    {
+        assert(i <= mCapacity);
+        return mPos + i * mStride;
+    }
+
+    T* velocity(const size_t i)
+    {
+        assert(i <= mCapacity);
+        return mVel + i * mStride;
+    }
+    const T* velocity(const size_t i) const
+    {
+        assert(i <= mCapacity);
+        return mVel + i * mStride;
+    }
+
+    T* pbestPosition(const size_t i)
+    {
+        assert(i <= mCapacity);
+        return mPBestPos + i * mStride;
+    }
+    const T* pbestPosition(const size_t i) const
+    {
+        assert(i <= mCapacity);
+        return mPBestPos + i * mStride;
+    }
+
+    prob_t* fitnesses()
+    {
+        return mFitness;
+    }
+    const prob_t* fitnesses() const
+    {
+        return mFitness;
+    }
+
+    prob_t* pbestFitnesses()
+    {
+        return mPBestFitness;
+    }
+    const prob_t* pbestFitnesses() const
+    {
+        return mPBestFitness;
+    }
+
+    // Reset the fitness and personal best of particle i, using its current
+    // position as the personal best position.
+    void resetParticle(const size_t i);
+
+    // Copy particle j of src (position, velocity, personal best and
+    // fitnesses) into particle i
+    void copyParticle(const size_t i, const BasicSwarm& src, const size_t j);
+
+    // Index of the particle with the highest personal best fitness
+    size_t bestIndex() const;
+
+    // Store the fitnesses of particles [begin, end), update their personal
+    // bests and return the index of the highest personal best among them,
+    // all in one pass. Ties go to the lowest index, like bestIndex().
+    size_t updatePBests(const prob_t* fitness, const size_t begin, const size_t end);
+
+    // Copy the personal best of particle i into the global best row
+    void setGBest(const size_t i);
+
+    BasicParticle<T> gbest();
+    const BasicParticle<T> gbest() const;
+
+    const T* gbestPosition() const
+    {
+        return position(mCapacity);
+    }
+
+private:
+    // Prevent copying and assignment
+    BasicSwarm(const BasicSwarm&);
+    void operator=(const BasicSwarm&);
+
+    BasicParticle<T> row(const size_t i) const;
+
+    size_t                  mNumParticles;
+    size_t                  mCapacity;
+    size_t                  mNumDims;
+    size_t                  mStride;
+
+    Arena                   mArena;
+    T*                      mPos;
+    T*                      mVel;
+    T*                      mPBestPos;
+    prob_t*                 mFitness;
+    prob_t*                 mPBestFitness;
+};
+
+typedef BasicSwarm<dim_t> Swarm;
+
+// Single precision coordinates, for twice as many SIMD lanes per update
+typedef BasicSwarm<float> FloatSwarm;
+
+// Instantiated in swarm.cpp
+extern template class BasicSwarm<double>;
+extern template class BasicSwarm<float>;
+
+#endif /* SWARM_H_ */
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * test_pso_alloc.cpp
+ *
+ * Checks that PSO::step() does not allocate any heap memory once the swarm
+ * has been set up. Every allocation is counted through a replaced global
+ * operator new. Also checks that the state of a large swarm is a single
+ * arena block, which the next run of the same size reuses, even while a
+ * much smaller swarm exists.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+#include "arena.h"
+#include "pso.h"
+#include "swarm.h"
+
+namespace
+{
+unsigned long gNumAllocations = 0;
+}
+
+// GCC 12 takes the free() of memory from operator new below for a
+// mismatched deallocation
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(std::size_t size)
+{
+    gNumAllocations++;
+    void* p = malloc(size ? size : 1);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    free(p);
+}
+
+#pragma GCC diagnostic pop
+
+class SphereFunction
+{
+public:
+    void operator()(const Swarm& particleSet, std::vector<double>* particleFitnesses)
+    {
+        for (unsigned int particleNum = 0; particleNum < particleSet.size(); ++particleNum)
+        {
+            const Particle p = particleSet[ particleNum ];
+            double sum = 0.0;
+            for (unsigned int d = 0; d < p.size(); d++)
+            {
+                sum += p.getPosition()[d] * p.getPosition()[d];
+            }
+            (*particleFitnesses)[ particleNum ] = -sum;
+        }
+    }
+};
+
+int main()
+{
+    const unsigned int numParticles = 64;
+    const unsigned int numDims = 37;
+    const unsigned int numIterations = 100;
+
+    std::vector<Dim> dims(numDims, Dim(-10, 10));
+    SphereFunction ff;
+    PSO<SphereFunction> pso( numParticles, dims, 0, ff, numIterations );
+    pso.initialize();
+
+    const unsigned long before = gNumAllocations;
+    for (unsigned int i = 0; i < numIterations; i++)
+    {
+        pso.step();
+    }
+    const unsigned long allocations = gNumAllocations - before;
+
+    std::cout << "Allocations during " << numIterations << " iterations: " << allocations << std::endl;
+    if (allocations != 0)
+    {
+        std::cout << "FAILED" << std::endl;
+        return 1;
+    }
+
+    // A 100k particle swarm takes one block, and a second PSO of the same
+    // size takes the block the first one gave back
+    const unsigned int numLarge = 100000;
+    std::vector<Dim> largeDims(4, Dim(-10, 10));
+    unsigned long blocks = Arena::getNumSystemAllocations();
+    {
+        PSO<SphereFunction> large( numLarge, largeDims, 0, ff, 1 );
+        large.iterate();
+    }
+    const unsigned long firstRun = Arena::getNumSystemAllocations() - blocks;
+    blocks = Arena::getNumSystemAllocations();
+    {
+        PSO<SphereFunction> large( numLarge, largeDims, 1, ff, 1 );
+        large.iterate();
+    }
+    const unsigned long secondRun = Arena::getNumSystemAllocations() - blocks;
+
+    // A much smaller swarm leaves the large block to a large run started
+    // while it still exists
+    PSO<SphereFunction> small( 1000, largeDims, 2, ff, 1 );
+    small.iterate();
+    blocks = Arena::getNumSystemAllocations();
+    {
+        PSO<SphereFunction> large( numLarge, largeDims, 3, ff, 1 );
+        large.iterate();
+    }
+    const unsigned long afterSmall = Arena::getNumSystemAllocations() - blocks;
+
+    std::cout << "Arena blocks for " << numLarge << " particles: " << firstRun
+              << ", then " << secondRun << " for the next run and " << afterSmall
+              << " alongside a smaller one" << std::endl;
+    if (firstRun != 1 || secondRun != 0 || afterSmall != 0)
+    {
+        std::cout << "FAILED" << std::endl;
+        return 1;
+    }
+    std::cout << "PASSED" << std::endl;
+    return 0;
+}
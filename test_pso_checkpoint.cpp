@@ -0,0 +1,143 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * test_pso_checkpoint.cpp
+ *
+ * Interrupts a run after a checkpoint, resumes it from the file and checks
+ * that the swarm and the global best are bit-identical to those of a run
+ * that was never interrupted, with the global and the random topology.
+ * Also checks that a checkpoint that can't be written is reported by
+ * step().
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "checkpoint.h"
+#include "objectives.h"
+#include "pso.h"
+
+namespace
+{
+
+const unsigned int kNumParticles = 50;
+const unsigned int kNumDims = 10;
+const unsigned int kNumIterations = 200;
+const unsigned int kSeed = 11;
+
+bool sameBits(const double* a, const double* b, const size_t n)
+{
+    return memcmp(a, b, n * sizeof(double)) == 0;
+}
+
+// Every row of both swarms, the global best included
+bool sameSwarm(const Swarm& a, const Swarm& b)
+{
+    for (size_t i = 0; i <= a.size(); i++)
+    {
+        if (!sameBits(a.position(i), b.position(i), a.numDims()) ||
+            !sameBits(a.velocity(i), b.velocity(i), a.numDims()) ||
+            !sameBits(a.pbestPosition(i), b.pbestPosition(i), a.numDims()) ||
+            !sameBits(a.fitnesses() + i, b.fitnesses() + i, 1) ||
+            !sameBits(a.pbestFitnesses() + i, b.pbestFitnesses() + i, 1))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Run kNumIterations in one go, and again stopped after 90 iterations and
+// resumed from the checkpoint of iteration 75
+bool resumesIdentically(const Topology& topology, const std::string& filename)
+{
+    std::vector<Dim> dims(kNumDims, Rastrigin::bounds());
+    Objective<Rastrigin> ff;
+
+    PSO< Objective<Rastrigin> > full( kNumParticles, dims, kSeed, ff, kNumIterations );
+    full.setTopology(topology);
+    full.iterate();
+
+    {
+        CheckpointWriter checkpoint(filename, 25);
+        PSO< Objective<Rastrigin> > interrupted( kNumParticles, dims, kSeed, ff, kNumIterations );
+        interrupted.setTopology(topology);
+        interrupted.setCheckpointWriter(&checkpoint);
+        interrupted.initialize();
+        for (unsigned int i = 0; i < 90; i++)
+        {
+            interrupted.step();
+        }
+        checkpoint.flush();
+    }
+
+    PSO< Objective<Rastrigin> > resumed( kNumParticles, dims, kSeed, ff, kNumIterations );
+    resumed.setTopology(topology);
+    resumed.resume(filename);
+    remove(filename.c_str());
+
+    std::cout << "Topology redrawn " << full.getTopology().getEpoch() << " times" << std::endl;
+    return resumed.getIteration() == full.getIteration() &&
+        resumed.getTopology().getEpoch() == full.getTopology().getEpoch() &&
+        sameSwarm(resumed.getSwarm(), full.getSwarm());
+}
+
+}
+
+int main()
+{
+    const std::string filename = "test_pso_checkpoint.ckpt";
+    std::vector<Dim> dims(kNumDims, Rastrigin::bounds());
+    Objective<Rastrigin> ff;
+
+    const bool same = resumesIdentically(Topology(), filename);
+    std::cout << "Resumed run bit-identical: " << (same ? "yes" : "no") << std::endl;
+
+    // The random neighbourhoods of the resumed run are redrawn from the
+    // epoch in the checkpoint
+    const bool sameRandom = resumesIdentically(Topology(kTopologyRandom, 3), filename);
+    std::cout << "Resumed run with a random topology bit-identical: " << (sameRandom ? "yes" : "no") << std::endl;
+
+    // A directory that doesn't exist: the failed save is thrown by a later step()
+    bool reported = false;
+    {
+        CheckpointWriter checkpoint("no-such-directory/run.ckpt", 10);
+        PSO< Objective<Rastrigin> > pso( kNumParticles, dims, kSeed, ff, kNumIterations );
+        pso.setCheckpointWriter(&checkpoint);
+        try
+        {
+            pso.iterate();
+        }
+        catch (const std::runtime_error& e)
+        {
+            reported = true;
+            std::cout << "Failed save reported at iteration " << pso.getIteration() << ": " << e.what() << std::endl;
+        }
+    }
+
+    if (!same || !sameRandom || !reported)
+    {
+        std::cout << "FAILED" << std::endl;
+        return 1;
+    }
+    std::cout << "PASSED" << std::endl;
+    return 0;
+}
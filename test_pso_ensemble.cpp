@@ -0,0 +1,128 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * test_pso_ensemble.cpp
+ *
+ * Solves 40 shifted sphere problems at once with an Ensemble, serially and
+ * on pools of 1 to 4 threads, and checks that every run finds its own
+ * minimum and that the swarms are bit-identical whatever the number of
+ * threads.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "ensemble.h"
+#include "thread_pool.h"
+
+namespace
+{
+
+const unsigned int kNumRuns = 40;
+const unsigned int kParticlesPerRun = 20;
+const unsigned int kNumDims = 4;
+const unsigned int kNumIterations = 500;
+
+// Run r has its minimum at (c, ..., c), c = 0.1 * r - 2
+double center(const unsigned int r)
+{
+    return 0.1 * r - 2.0;
+}
+
+class ShiftedSpheres
+{
+public:
+    void operator()(const Swarm& particles, const unsigned int particlesPerRun, std::vector<double>* fitnesses) const
+    {
+        for (size_t k = 0; k < particles.size(); k++)
+        {
+            const double c = center(k / particlesPerRun);
+            const dim_t* x = particles.position(k);
+            double sum = 0.0;
+            for (size_t d = 0; d < particles.numDims(); d++)
+            {
+                sum += (x[d] - c) * (x[d] - c);
+            }
+            (*fitnesses)[k] = -sum;
+        }
+    }
+};
+
+bool sameSwarm(const Swarm& a, const Swarm& b)
+{
+    const size_t bytes = a.numDims() * sizeof(dim_t);
+    for (size_t k = 0; k < a.size(); k++)
+    {
+        if (memcmp(a.position(k), b.position(k), bytes) != 0 ||
+            memcmp(a.velocity(k), b.velocity(k), bytes) != 0 ||
+            memcmp(a.pbestPosition(k), b.pbestPosition(k), bytes) != 0 ||
+            a.pbestFitnesses()[k] != b.pbestFitnesses()[k])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+int main()
+{
+    std::vector<Dim> dims(kNumDims, Dim(-5, 5));
+    ShiftedSpheres ff;
+
+    Ensemble<ShiftedSpheres> serial(kNumRuns, kParticlesPerRun, dims, 7, ff, kNumIterations);
+    serial.iterate();
+
+    double worstError = 0.0;
+    for (unsigned int r = 0; r < kNumRuns; r++)
+    {
+        for (unsigned int d = 0; d < kNumDims; d++)
+        {
+            worstError = std::max(worstError, fabs(serial.getBestPosition(r)[d] - center(r)));
+        }
+    }
+    std::cout << "Largest distance of a run's best from its minimum: " << worstError << std::endl;
+    bool ok = worstError < 1e-6;
+
+    for (unsigned int numThreads = 1; numThreads <= 4; numThreads++)
+    {
+        ThreadPool pool(numThreads);
+        Ensemble<ShiftedSpheres> parallel(kNumRuns, kParticlesPerRun, dims, 7, ff, kNumIterations);
+        parallel.setThreadPool(&pool);
+        parallel.iterate();
+
+        bool same = sameSwarm(parallel.getSwarm(), serial.getSwarm());
+        for (unsigned int r = 0; r < kNumRuns; r++)
+        {
+            same = same && parallel.getBestFitness(r) == serial.getBestFitness(r);
+        }
+        std::cout << numThreads << " threads: " << (same ? "same" : "different") << " as serial" << std::endl;
+        ok = ok && same;
+    }
+
+    if (!ok)
+    {
+        std::cout << "FAILED" << std::endl;
+        return 1;
+    }
+    std::cout << "PASSED" << std::endl;
+    return 0;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * test_pso_fixed.cpp
+ *
+ * Instantiates the fixed-dimension PSO (fixed_pso.h) on a shifted Ackley
+ * function of two dimensions and checks that it finds the minimum.
+ */
+
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "pso.h"
+
+namespace
+{
+
+// Ackley function with its minimum at (trueX, trueY), negated for maximization
+class FixedAckley
+{
+public:
+    FixedAckley(const double trueX, const double trueY)
+        : mTrueX(trueX), mTrueY(trueY)
+    {
+    }
+
+    void operator()(const std::vector< FixedParticle<2> >& particles, std::vector<double>* fitnesses) const
+    {
+        for (size_t i = 0; i < particles.size(); i++)
+        {
+            const double dx = particles[i].getPosition()[0] - mTrueX;
+            const double dy = particles[i].getPosition()[1] - mTrueY;
+            const double value = -20.0 * exp(-0.2 * sqrt(0.5 * (dx*dx + dy*dy)))
+                - exp(0.5 * (cos(2.0*M_PI*dx) + cos(2.0*M_PI*dy))) + M_E + 20.0;
+            (*fitnesses)[i] = -value;
+        }
+    }
+
+private:
+    double mTrueX;
+    double mTrueY;
+};
+
+}
+
+int main()
+{
+    const double trueX = 4.0;
+    const double trueY = 6.8;
+    const unsigned int numParticles = 30;
+    const unsigned int maxIterations = 500;
+
+    constexpr std::array<Dim, 2> dims = {{ Dim(-10, 10), Dim(-10, 10) }};
+    FixedAckley ff( trueX, trueY );
+    PSO<FixedAckley, 2> pso( numParticles, dims, 0, ff, maxIterations );
+
+    const FixedParticle<2>& best = pso.iterate();
+    const double errorX = fabs(best.getPBestPosition()[0] - trueX);
+    const double errorY = fabs(best.getPBestPosition()[1] - trueY);
+
+    std::cout << "Fixed-dimension PSO best: (x,y) = (" << best.getPBestPosition()[0] << ","
+              << best.getPBestPosition()[1] << "), fitness " << best.getPBestFitness() << std::endl;
+    if (pso.getIteration() != maxIterations || errorX > 1e-6 || errorY > 1e-6)
+    {
+        std::cout << "FAILED" << std::endl;
+        return 1;
+    }
+    std::cout << "PASSED" << std::endl;
+    return 0;
+}
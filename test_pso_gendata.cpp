@@ -25,53 +25,41 @@
 #include <cmath>
 #include <cstdlib>
 #include <ctime>
-#include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
 #include <vector>
 
 #include <gsl/gsl_math.h>
-#include <gsl/gsl_randist.h>
 #include <gsl/gsl_sf_exp.h>
 #include <gsl/gsl_sf_trig.h>
 
+#include "batch_objectives.h"
+#include "parallel_evaluator.h"
 #include "pso.h"
 #include "rng.h"
+#include "swarm.h"
+#include "thread_pool.h"
+#include "trajectory.h"
 
 class GaussianFunction
 {
 public:
     GaussianFunction(const double mean, const double std, const gslseed_t seed)
-        : mMean(mean), mStd(std), mRng(seed)
+        : mMean(mean), mStd(std), mRng(seed), mData(generateData(1000)), mLikelihood(mData, mStd)
     {
-        // Generate data from the true distribution
-        const unsigned int numDataPoints = 1000;
-        for (unsigned int i = 0; i < numDataPoints; i++)
-        {
-            double x = mMean + mRng.gaussian( mStd );
-            mData.push_back( x );
-        }
     }
 
-    void operator()(const std::vector<Particle>& particleSet, std::vector<double>* particleFitnesses)
+    // The likelihood only needs the sufficient statistics of the data, so
+    // each particle costs O(1) rather than a pass over the data.
+    void operator()(const Swarm& particleSet, std::vector<double>* particleFitnesses)
 	{
-		for(unsigned int particleNum = 0; particleNum < particleSet.size(); ++particleNum)
-		{
-			(*particleFitnesses)[ particleNum ] = operator()( particleSet[ particleNum ] );
-		}
+		mLikelihood(particleSet, particleFitnesses);
 	}
 
     double operator()(const Particle& p) const
     {
-        const double mean = p.getPosition()[0];
-        double totalProb = 0.0;
-        for (unsigned int i = 0; i < mData.size(); i++)
-        {
-            double prob = gsl_ran_gaussian_pdf( mData[i] - mean, mStd);
-            totalProb += log(prob);
-        }
-        return totalProb;
+        return mLikelihood(p);
     }
 
     double computeSampleMean() const
@@ -86,12 +74,25 @@ public:
     }
 
 private:
+    // Generate data from the true distribution
+    std::vector<double> generateData(const unsigned int numDataPoints)
+    {
+        std::vector<double> data;
+        for (unsigned int i = 0; i < numDataPoints; i++)
+        {
+            double x = mMean + mRng.gaussian( mStd );
+            data.push_back( x );
+        }
+        return data;
+    }
+
     double mMean;
     double mStd;
 
     RandomNumberGenerator mRng;
 
     std::vector<double> mData;
+    GaussianLogLikelihood mLikelihood;
 };
 
 class AckleyFunction
@@ -104,12 +105,33 @@ public:
     {
     }
 
-    void operator()(const std::vector<Particle>& particleSet, std::vector<double>* particleFitnesses)
+    // The whole swarm at once, with the exponentials and cosines of all the
+    // particles computed by the vectorized math of batch_objectives.h
+    void operator()(const Swarm& particleSet, std::vector<double>* particleFitnesses)
 	{
-		for(unsigned int particleNum = 0; particleNum < particleSet.size(); ++particleNum)
-		{
-			(*particleFitnesses)[ particleNum ] = operator()( particleSet[ particleNum ] );
-		}
+        const size_t n = particleSet.size();
+        mCosArgs.resize(2 * n);
+        mExpArgs.resize(2 * n);
+        for (size_t i = 0; i < n; i++)
+        {
+            const double dx = particleSet.position(i)[0] - mTrueX;
+            const double dy = particleSet.position(i)[1] - mTrueY;
+            mCosArgs[2*i] = 2.0*M_PI*dx;
+            mCosArgs[2*i + 1] = 2.0*M_PI*dy;
+            mExpArgs[2*i] = -0.5 * (dx*dx + dy*dy);
+        }
+        vectorCos(mCosArgs.data(), mCosArgs.data(), 2 * n);
+        for (size_t i = 0; i < n; i++)
+        {
+            mExpArgs[2*i + 1] = 0.5 * (mCosArgs[2*i] + mCosArgs[2*i + 1]);
+        }
+        vectorExp(mExpArgs.data(), mExpArgs.data(), 2 * n);
+
+        // Flip the Ackely function because PSO looks for a maximum.
+        for (size_t i = 0; i < n; i++)
+        {
+            (*particleFitnesses)[ i ] = -1.0 * (20.0 + M_E - 20.0 * mExpArgs[2*i] - mExpArgs[2*i + 1]);
+        }
 	}
 
     double operator()(const Particle& p) const
@@ -137,6 +159,10 @@ public:
 private:
     double mTrueX;
     double mTrueY;
+
+    // Scratch space of the batch operator
+    std::vector<double> mCosArgs;
+    std::vector<double> mExpArgs;
 };
 
 void evaluateGaussian1D(const unsigned int numParticles, const unsigned int maxIterations,
@@ -145,8 +171,7 @@ void evaluateGaussian1D(const unsigned int numParticles, const unsigned int maxI
     std::cout << "\nEvaluating: One-dimensional Gaussian with unknown mean.\n";
 
     std::ostringstream oss;
-    oss << fn.c_str() << "_gaussian_1d.part";
-    std::ofstream out( oss.str().c_str() );
+    oss << fn.c_str() << "_gaussian_1d.traj";
 
     std::vector<Dim> dims;
     dims.push_back( Dim(-100, 100) );
@@ -156,11 +181,14 @@ void evaluateGaussian1D(const unsigned int numParticles, const unsigned int maxI
     const gslseed_t gaussianSeed = 0;
     const gslseed_t psoSeed = 0;
 
-    GaussianFunction ff( trueMean, trueStd, gaussianSeed );
-    PSO pso( numParticles, dims, psoSeed );
-    Particle p = pso.compute(ff, maxIterations, &out);
+    GaussianFunction gaussian( trueMean, trueStd, gaussianSeed );
+
+    PSO<GaussianFunction> pso( numParticles, dims, psoSeed, gaussian, maxIterations );
+    TrajectoryWriter trajectory( oss.str(), dims, numParticles );
+    pso.setTrajectoryWriter( &trajectory );
+    const Particle& p = pso.iterate();
     std::cout << "True mean = " << trueMean << std::endl;
-    std::cout << "Standard sample mean = " << ff.computeSampleMean() << std::endl;
+    std::cout << "Standard sample mean = " << gaussian.computeSampleMean() << std::endl;
     std::cout << "Best PSO mean found = " << p.getPosition()[0] << std::endl;
 }
 
@@ -170,8 +198,7 @@ void evaluateAckley(const unsigned int numParticles, const unsigned int maxItera
     std::cout << "\nEvaluating: Two-dimensional Ackley.\n";
 
     std::ostringstream oss;
-    oss << fn.c_str() << "_ackley.part";
-    std::ofstream out( oss.str().c_str() );
+    oss << fn.c_str() << "_ackley.traj";
 
     std::vector<Dim> dims;
     dims.push_back( Dim(-10, 10) );
@@ -182,15 +209,25 @@ void evaluateAckley(const unsigned int numParticles, const unsigned int maxItera
     AckleyFunction ff( trueX, trueY );
 
     const gslseed_t psoSeed = 0;
-    PSO pso( numParticles, dims, psoSeed );
+    PSO<AckleyFunction> pso( numParticles, dims, psoSeed, ff, maxIterations );
+    TrajectoryWriter trajectory( oss.str(), dims, numParticles );
+    pso.setTrajectoryWriter( &trajectory );
 
-    Particle p = pso.compute(ff, maxIterations, &out);
+    const Particle& p = pso.iterate();
     const double psoBestX = p.getPosition()[0];
     const double psoBestY = p.getPosition()[1];
 
 
     std::cout << "True: (x,y) = (" << trueX << "," << trueY << ")" << std::endl;
     std::cout << "PSO best: (x,y) = (" << psoBestX << "," << psoBestY << ")" << std::endl;
+
+    // Again through the per-particle operator, evaluated on a thread pool
+    ThreadPool pool;
+    ParallelEvaluator<AckleyFunction> parallelFf( ff, pool );
+    PSO< ParallelEvaluator<AckleyFunction> > parallelPso( numParticles, dims, psoSeed, parallelFf, maxIterations );
+    const Particle& q = parallelPso.iterate();
+    std::cout << "PSO best, per particle on " << pool.size() << " threads: (x,y) = ("
+              << q.getPosition()[0] << "," << q.getPosition()[1] << ")" << std::endl;
 }
 
 
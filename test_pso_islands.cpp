@@ -0,0 +1,226 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * test_pso_islands.cpp
+ *
+ * Runs the island model without migrations, which must be deterministic,
+ * then with migrations over a ring and between all the islands. The
+ * fitness function checks, at every call, that no island's global best has
+ * gone down since its last call, migrations included, counts the
+ * evaluations, which getNumEvaluations() must match, and counts the
+ * migrants that arrived. A last test runs the same model twice with the
+ * fitness function shifted down, and checks that the second run doesn't
+ * receive particles, with their fitnesses, from the first one.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "islands.h"
+#include "objectives.h"
+
+namespace
+{
+
+// Rastrigin, called by the islands at the same time
+class CheckedRastrigin
+{
+public:
+    CheckedRastrigin() : mOffset(0.0), mNumEvaluations(0), mNumDecreases(0), mNumArrivals(0) {}
+
+    void operator()(const Swarm& particleSet, std::vector<double>* particleFitnesses)
+    {
+        mObjective(particleSet, particleFitnesses);
+        for (size_t i = 0; i < particleSet.size(); i++)
+        {
+            (*particleFitnesses)[i] += mOffset;
+        }
+
+        // The global best row of the island's swarm
+        const prob_t gbest = particleSet.pbestFitnesses()[particleSet.size()];
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::map<const Swarm*, prob_t>::iterator last = mLastGBest.find(&particleSet);
+        if (last != mLastGBest.end())
+        {
+            if (gbest < last->second)
+            {
+                mNumDecreases++;
+            }
+
+            // Particles start at rest, and after that only a migrant, which
+            // arrives at rest, has no velocity at all
+            for (size_t i = 0; i < particleSet.size(); i++)
+            {
+                const dim_t* vel = particleSet.velocity(i);
+                if (std::count(vel, vel + particleSet.numDims(), 0.0) == static_cast<long>(particleSet.numDims()))
+                {
+                    mNumArrivals++;
+                }
+            }
+        }
+        mLastGBest[&particleSet] = gbest;
+        mNumEvaluations += particleSet.size();
+    }
+
+    // Added to every fitness
+    void setOffset(const double offset)
+    {
+        mOffset = offset;
+    }
+
+    void reset()
+    {
+        mLastGBest.clear();
+        mNumEvaluations = 0;
+        mNumDecreases = 0;
+        mNumArrivals = 0;
+    }
+
+    unsigned long getNumEvaluations() const
+    {
+        return mNumEvaluations;
+    }
+
+    unsigned long getNumDecreases() const
+    {
+        return mNumDecreases;
+    }
+
+    // Migrants evaluated after their arrival
+    unsigned long getNumArrivals() const
+    {
+        return mNumArrivals;
+    }
+
+private:
+    Objective<Rastrigin>            mObjective;
+    std::mutex                      mMutex;
+    std::map<const Swarm*, prob_t>  mLastGBest;
+    double                          mOffset;
+    unsigned long                   mNumEvaluations;
+    unsigned long                   mNumDecreases;
+    unsigned long                   mNumArrivals;
+};
+
+const unsigned int kNumIslands = 4;
+const unsigned int kParticlesPerIsland = 20;
+const unsigned int kNumDims = 10;
+const unsigned int kNumIterations = 200;
+
+unsigned int gNumFailures = 0;
+
+void check(const bool ok, const char* what)
+{
+    std::cout << what << ": " << (ok ? "ok" : "wrong") << std::endl;
+    if (!ok)
+    {
+        gNumFailures++;
+    }
+}
+
+// Checks common to every run
+void checkRun(const IslandModel<CheckedRastrigin>& islands, const CheckedRastrigin& ff)
+{
+    unsigned long sum = 0;
+    prob_t best = islands.getIsland(0).getGBest().getPBestFitness();
+    for (unsigned int i = 0; i < islands.getNumIslands(); i++)
+    {
+        sum += islands.getIsland(i).getNumEvaluations();
+        best = std::max(best, islands.getIsland(i).getGBest().getPBestFitness());
+    }
+    check(islands.getNumEvaluations() == sum && sum == ff.getNumEvaluations(),
+          "  evaluations are the sum over the islands");
+    check(islands.getGBest().getPBestFitness() == best, "  global best is the best island's");
+    check(ff.getNumDecreases() == 0, "  no global best ever went down");
+}
+
+}
+
+int main()
+{
+    std::vector<Dim> dims(kNumDims, Rastrigin::bounds());
+    CheckedRastrigin ff;
+
+    // No migrations: the islands are independent and the run deterministic
+    IslandOptions isolated;
+    isolated.migrationInterval = 0;
+    std::vector<prob_t> firstRun(kNumIslands);
+    for (unsigned int run = 0; run < 2; run++)
+    {
+        std::cout << "No migration, run " << run + 1 << std::endl;
+        ff.reset();
+        IslandModel<CheckedRastrigin> islands(kNumIslands, kParticlesPerIsland, dims, 7, ff, kNumIterations, isolated);
+        islands.iterate();
+        checkRun(islands, ff);
+        bool same = true;
+        for (unsigned int i = 0; i < kNumIslands; i++)
+        {
+            const prob_t fitness = islands.getIsland(i).getGBest().getPBestFitness();
+            same = same && (run == 0 || fitness == firstRun[i]);
+            firstRun[i] = fitness;
+        }
+        check(same, "  same global bests as the first run");
+        check(islands.getNumEvaluations() == 1ul * kNumIslands * kParticlesPerIsland * kNumIterations,
+              "  every island ran every iteration");
+        check(ff.getNumArrivals() == 0, "  no migrants");
+    }
+
+    const IslandTopology topologies[] = { kIslandRing, kIslandFullyConnected };
+    const char* names[] = { "ring", "fully connected" };
+    for (unsigned int t = 0; t < 2; t++)
+    {
+        std::cout << "Migration every 5 iterations, " << names[t] << std::endl;
+        IslandOptions options;
+        options.migrationInterval = 5;
+        options.numMigrants = 3;
+        options.topology = topologies[t];
+        ff.reset();
+        IslandModel<CheckedRastrigin> islands(kNumIslands, kParticlesPerIsland, dims, 7, ff, kNumIterations, options);
+        islands.iterate();
+        checkRun(islands, ff);
+        check(ff.getNumArrivals() > 0, "  migrants arrived");
+    }
+
+    // The last migration of a run is sent after the last step and never
+    // received. The next run must not take it in: its fitnesses are all
+    // below -1000, so a particle from the first run would be its best.
+    {
+        std::cout << "Two runs, migrating at the end of each" << std::endl;
+        const unsigned int numIterations = 10;
+        IslandOptions options;
+        options.migrationInterval = numIterations;
+        IslandModel<CheckedRastrigin> islands(kNumIslands, kParticlesPerIsland, dims, 7, ff, numIterations, options);
+        ff.reset();
+        islands.iterate();
+        ff.setOffset(-1000.0);
+        ff.reset();
+        const prob_t best = islands.iterate().getPBestFitness();
+        ff.setOffset(0.0);
+        check(best < -1000.0 && ff.getNumArrivals() == 0, "  nothing carried over from the first run");
+    }
+
+    if (gNumFailures != 0)
+    {
+        std::cout << "FAILED" << std::endl;
+        return 1;
+    }
+    std::cout << "PASSED" << std::endl;
+    return 0;
+}
@@ -29,6 +29,7 @@ from matplotlib import rc
 from matplotlib import animation
 
 from config import settings
+from trajectory import Trajectory
 FIG_FORMAT = settings['figure.format']
 FIG_DPI = int( settings['figure.dpi'] )
 
@@ -47,25 +48,21 @@ fn = args[1];
 
 print "Processing", fn
 
-#FIXME: Find dimension dynamically
-dim = 2
+trajectory = Trajectory(fn)
+dim = trajectory.numDims
 print "Particle dimension =", dim
+if dim < 2:
+	sys.exit("Need at least two dimensions to plot")
 
-data = pylab.loadtxt(fn, skiprows=1);
-
-#data = data[1:-1,:] # remove the first line containing the particle dimension
-numFrames = data.shape[0] # Subtract one because the first line has the particle dimension
-numParticles = data.shape[1] / dim
+numFrames = trajectory.numFrames
+numParticles = trajectory.numRows
 print "Particles used", numParticles
 print "Frames =", numFrames
 
-# FIXME: We should get two or more sets of these for each axis
-minValue = min(data.reshape(numFrames*numParticles*dim,1))
-maxValue = max(data.reshape(numFrames*numParticles*dim,1))
 
 # First set up the figure, the axis, and the plot element we want to animate
 fig = plt.figure()
-ax = plt.axes(xlim=(minValue[0], maxValue[0]), ylim=(minValue[0], maxValue[0]))
+ax = plt.axes(xlim=(trajectory.lower[0], trajectory.upper[0]), ylim=(trajectory.lower[1], trajectory.upper[1]))
 plt.grid(True)
 
 line, = ax.plot([], [], 'ro', lw=2)
@@ -79,8 +76,7 @@ def init():
 # animation function.  This is called sequentially
 def animate(i):
 	#print "i =", i
-	D = data[i,:];
-	D = D.reshape(numParticles,dim);
+	(iteration, gbestFitness, D, fitnesses) = trajectory.frame(i);
 	x = D[:,0];
 	y = D[:,1];
 	minX = min(x);
@@ -91,7 +87,7 @@ def animate(i):
 	#print "X =", x
 	#print "Y =", y
 	line.set_data(x, y)
-	s = "Ackely Benchmark: Step %s" % i
+	s = "Ackely Benchmark: Step %s" % iteration
 	plt.title(s)
 	return line,
 
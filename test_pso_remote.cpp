@@ -0,0 +1,219 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * test_pso_remote.cpp
+ *
+ * Runs PSO with its fitness evaluated by worker processes over a Unix
+ * socket on this machine and checks that the result is the same as a
+ * purely local run. One worker is slow, to exercise straggler handling,
+ * and one exits partway through, to exercise recovery; a last run kills
+ * every worker to exercise the local fallback. Finally rows are evaluated
+ * again unchanged, which must not be sent to the worker a second time.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "objectives.h"
+#include "pso.h"
+#include "remote.h"
+#include "swarm.h"
+
+namespace
+{
+
+enum WorkerKind
+{
+    kWorkerNormal,
+    kWorkerSlow,    // Sleeps on some evaluations
+    kWorkerDying    // Exits after a number of evaluations
+};
+
+class WorkerObjective
+{
+public:
+    explicit WorkerObjective(const WorkerKind kind) : mKind(kind), mNumEvaluations(0) {}
+
+    double operator()(const Particle& p) const
+    {
+        mNumEvaluations++;
+        if (mKind == kWorkerSlow && mNumEvaluations % 500 == 0)
+        {
+            usleep(30000);
+        }
+        if (mKind == kWorkerDying && mNumEvaluations == 3000)
+        {
+            _exit(0);
+        }
+        return mObjective(p);
+    }
+
+private:
+    WorkerKind              mKind;
+    mutable unsigned long   mNumEvaluations;
+    Objective<Rastrigin>    mObjective;
+};
+
+pid_t startWorker(const std::string& address, const WorkerKind kind)
+{
+    const pid_t pid = fork();
+    if (pid == 0)
+    {
+        const int fd = remoteConnect(address);
+        WorkerObjective objective(kind);
+        _exit(serveRemoteWorker(fd, objective) ? 0 : 1);
+    }
+    return pid;
+}
+
+struct Best
+{
+    double              fitness;
+    std::vector<double> position;
+};
+
+Best copyBest(const Particle& p)
+{
+    Best best = { p.getPBestFitness(), p.getPosition().toVector() };
+    return best;
+}
+
+bool sameBest(const Particle& a, const Best& b)
+{
+    return a.getPBestFitness() == b.fitness && a.getPosition().toVector() == b.position;
+}
+
+} // namespace
+
+int main()
+{
+    const unsigned int numParticles = 100;
+    const unsigned int numDims = 10;
+    const unsigned int numIterations = 200;
+    const std::string address = "unix:/tmp/test_pso_remote." + std::to_string(getpid());
+
+    std::vector<Dim> dims(numDims, Rastrigin::bounds());
+    Objective<Rastrigin> objective;
+
+    // Every run of a PSO has its own random streams, so compare run by run
+    PSO< Objective<Rastrigin> > localPso( numParticles, dims, 0, objective, numIterations );
+    const Best localBest = copyBest( localPso.iterate() );
+    const Best localBest2 = copyBest( localPso.iterate() );
+
+    const int listenFd = remoteListen(address);
+    const WorkerKind kinds[] = { kWorkerNormal, kWorkerNormal, kWorkerSlow, kWorkerDying };
+    std::vector<pid_t> pids;
+    std::vector<int> workers;
+    for (unsigned int w = 0; w < 4; w++)
+    {
+        pids.push_back(startWorker(address, kinds[w]));
+        workers.push_back(remoteAccept(listenFd));
+    }
+
+    RemoteOptions options;
+    options.batchSize = 8;
+    options.stragglerSeconds = 0.01;
+    bool passed = true;
+    {
+        RemoteCoordinator coordinator( workers, numParticles, numDims, options );
+        RemoteEvaluator< Objective<Rastrigin> > ff( coordinator, objective );
+        PSO< RemoteEvaluator< Objective<Rastrigin> > > pso( numParticles, dims, 0, ff, numIterations );
+        const Particle& best = pso.iterate();
+
+        std::cout << "Workers left: " << coordinator.getNumLiveWorkers() << " of 4" << std::endl;
+        std::cout << "Rows sent: " << coordinator.getNumRowsSent()
+                  << ", unchanged rows not sent: " << coordinator.getNumRowsUnchanged()
+                  << ", duplicated batches: " << coordinator.getNumDuplicates()
+                  << ", bytes sent: " << coordinator.getNumBytesSent() << std::endl;
+        if (!sameBest(best, localBest) || coordinator.getNumLiveWorkers() != 3)
+        {
+            std::cout << "Remote run differs from the local run" << std::endl;
+            passed = false;
+        }
+
+        // Without workers everything is evaluated locally
+        for (unsigned int w = 0; w < pids.size(); w++)
+        {
+            kill(pids[w], SIGKILL);
+        }
+        const Particle& fallbackBest = pso.iterate();
+        if (!sameBest(fallbackBest, localBest2) || coordinator.getNumLiveWorkers() != 0)
+        {
+            std::cout << "Local fallback run differs from the local run" << std::endl;
+            passed = false;
+        }
+    }
+    for (unsigned int w = 0; w < pids.size(); w++)
+    {
+        waitpid(pids[w], 0, 0);
+    }
+
+    // Rows that are the same as in the previous call are not sent again.
+    // One worker, so that every row goes back to the worker that has it.
+    {
+        const pid_t pid = startWorker(address, kWorkerNormal);
+        std::vector<int> worker(1, remoteAccept(listenFd));
+        {
+            RemoteCoordinator coordinator( worker, numParticles, numDims );
+            RemoteEvaluator< Objective<Rastrigin> > ff( coordinator, objective );
+            Swarm swarm( numParticles, numDims );
+            std::vector<double> fitnesses( numParticles );
+            std::vector<double> expected( numParticles );
+            bool same = true;
+            for (unsigned int call = 0; call < 3; call++)
+            {
+                // Every row, then the same rows, then every other row moved
+                for (unsigned int i = 0; i < numParticles; i++)
+                {
+                    if (call == 0 || (call == 2 && i % 2 == 0))
+                    {
+                        for (unsigned int d = 0; d < numDims; d++)
+                        {
+                            swarm.position(i)[d] = 0.01 * (call + 1) * (i + d) - 2.0;
+                        }
+                    }
+                }
+                ff( swarm, &fitnesses );
+                objective( swarm, &expected );
+                same = same && fitnesses == expected;
+            }
+            std::cout << "Repeated rows: " << coordinator.getNumRowsSent() << " sent, "
+                      << coordinator.getNumRowsUnchanged() << " unchanged not sent" << std::endl;
+            // All rows, none, then the moved half; the unchanged rows are
+            // the whole second call and the other half of the third
+            const unsigned long numExpected = numParticles + numParticles / 2;
+            if (!same || coordinator.getNumRowsSent() != numExpected ||
+                coordinator.getNumRowsUnchanged() != numExpected)
+            {
+                std::cout << "Unchanged rows were sent again or evaluated wrongly" << std::endl;
+                passed = false;
+            }
+        }
+        waitpid(pid, 0, 0);
+    }
+    close(listenFd);
+    unlink(address.substr(5).c_str());
+
+    std::cout << (passed ? "PASSED" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
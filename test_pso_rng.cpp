@@ -0,0 +1,73 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+
+/*
+ * test_pso_rng.cpp
+ *
+ * Checks CounterRNG against the known-answer vectors of Philox4x32-10
+ * published with Random123. The key of the generator is its seed, low
+ * word first.
+ */
+
+#include <iostream>
+#include <stdint.h>
+
+#include "counter_rng.h"
+
+namespace
+{
+
+struct KnownAnswer
+{
+    uint32_t    key[2];
+    uint32_t    ctr[4];
+    uint32_t    expected[4];
+};
+
+const KnownAnswer kKnownAnswers[3] =
+{
+    { { 0, 0 }, { 0, 0, 0, 0 },
+      { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 } },
+    { { 0xffffffff, 0xffffffff }, { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff },
+      { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd } },
+    { { 0xa4093822, 0x299f31d0 }, { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 },
+      { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 } }
+};
+
+}
+
+int main()
+{
+    bool passed = true;
+    for (unsigned int v = 0; v < 3; v++)
+    {
+        const KnownAnswer& answer = kKnownAnswers[v];
+        const CounterRNG rng((static_cast<uint64_t>(answer.key[1]) << 32) | answer.key[0]);
+        uint32_t ctr[4] = { answer.ctr[0], answer.ctr[1], answer.ctr[2], answer.ctr[3] };
+        rng.block(ctr);
+        bool same = true;
+        for (unsigned int k = 0; k < 4; k++)
+        {
+            same = same && ctr[k] == answer.expected[k];
+        }
+        std::cout << "Vector " << v << ": " << (same ? "ok" : "wrong") << std::endl;
+        passed = passed && same;
+    }
+
+    std::cout << (passed ? "PASSED" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+
+/*
+ * test_pso_store.cpp
+ *
+ * Checks the SolutionStore: which records nearest() returns and in what
+ * order, the replacement of a record of the same problem, the eviction of
+ * the oldest records past maxRecords and the save/load round trip. Then
+ * checks that a second PSO run of a problem is seeded from the first.
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "objectives.h"
+#include "pso.h"
+#include "solution_store.h"
+
+namespace
+{
+
+const char* kFilename = "test_pso_store.dat";
+const unsigned int kNumDims = 2;
+
+unsigned int gNumFailures = 0;
+
+void check(const bool ok, const char* what)
+{
+    std::cout << what << ": " << (ok ? "ok" : "wrong") << std::endl;
+    if (!ok)
+    {
+        gNumFailures++;
+    }
+}
+
+// Personal bests that tell the runs apart: particle i of run value is at
+// (value + i, value - i) with fitness value - i
+void fill(Swarm* swarm, const double value)
+{
+    for (size_t i = 0; i < swarm->size(); i++)
+    {
+        for (unsigned int d = 0; d < kNumDims; d++)
+        {
+            swarm->pbestPosition(i)[d] = (d == 0) ? value + i : value - i;
+            swarm->velocity(i)[d] = 0.5 * value;
+        }
+        swarm->pbestFitnesses()[i] = value - i;
+    }
+}
+
+std::vector<double> features(const double x)
+{
+    return std::vector<double>(1, x);
+}
+
+bool sameRecords(const SolutionRecord& a, const SolutionRecord& b)
+{
+    return a.key == b.key && a.features == b.features && a.numDims == b.numDims &&
+        a.positions == b.positions && a.velocities == b.velocities && a.fitnesses == b.fitnesses;
+}
+
+}
+
+int main()
+{
+    remove(kFilename);
+
+    SolutionStoreOptions options;
+    options.numNeighbours = 2;
+    options.solutionsPerRecord = 2;
+    options.maxRecords = 4;
+    SolutionStore store(kFilename, options);
+    check(store.size() == 0, "a missing file is an empty store");
+
+    Swarm swarm(3, kNumDims);
+    fill(&swarm, 10.0);
+    store.add("a", features(0.0), swarm);
+    fill(&swarm, 20.0);
+    store.add("a", features(1.0), swarm);
+    fill(&swarm, 30.0);
+    store.add("a", features(3.0), swarm);
+    check(store.size() == 3 && store.record(0).numSolutions() == 2, "solutionsPerRecord best particles kept");
+    check(store.record(0).fitnesses[0] == 10.0 && store.record(0).fitnesses[1] == 9.0 &&
+          store.record(0).positions[2] == 11.0 && store.record(0).positions[3] == 9.0, "best first");
+
+    // Same key and features: the record is replaced and becomes the newest
+    fill(&swarm, 40.0);
+    store.add("a", features(1.0), swarm);
+    check(store.size() == 3 && store.record(2).features == features(1.0) && store.record(2).fitnesses[0] == 40.0 &&
+          store.record(1).features == features(3.0), "same problem replaces its record");
+
+    // Records of other keys or numbers of dimensions are never neighbours
+    Swarm wide(3, kNumDims + 1);
+    for (size_t i = 0; i < wide.size(); i++)
+    {
+        wide.pbestFitnesses()[i] = 60.0;
+    }
+    store.add("a", features(1.9), wide);
+    std::vector<const SolutionRecord*> neighbours;
+    store.nearest("a", features(1.9), kNumDims, &neighbours);
+    check(neighbours.size() == 2 && neighbours[0]->features == features(1.0) &&
+          neighbours[1]->features == features(3.0), "nearest first, other dimensions skipped");
+
+    // 1.0 and 3.0 are equally far from 2.0: the most recent record wins
+    store.nearest("a", features(2.0), kNumDims, &neighbours);
+    check(neighbours.size() == 2 && neighbours[0]->fitnesses[0] == 40.0 &&
+          neighbours[1]->fitnesses[0] == 30.0, "ties go to the most recent record");
+    store.nearest("b", features(2.0), kNumDims, &neighbours);
+    check(neighbours.empty(), "no neighbours for another key");
+
+    // Seeds interleave the neighbours: best of each, then second best
+    std::vector<dim_t> positions;
+    std::vector<dim_t> velocities;
+    const size_t numSeeds = store.seeds("a", features(2.0), kNumDims, 3, &positions, &velocities);
+    check(numSeeds == 3 && positions.size() == 3 * kNumDims && positions[0] == 40.0 && positions[2] == 30.0 &&
+          positions[4] == 41.0 && velocities[0] == 20.0, "seeds");
+
+    // One more record than maxRecords: the oldest one goes
+    check(store.size() == 4 && store.record(0).features == features(0.0), "store full");
+    fill(&swarm, 50.0);
+    store.add("b", features(0.0), swarm);
+    check(store.size() == 4 && store.record(0).features == features(3.0) &&
+          store.record(3).key == "b", "oldest record evicted past maxRecords");
+
+    store.save();
+    {
+        SolutionStore loaded(kFilename, options);
+        bool same = loaded.size() == store.size();
+        for (size_t r = 0; same && r < store.size(); r++)
+        {
+            same = sameRecords(loaded.record(r), store.record(r));
+        }
+        check(same, "save/load round trip");
+    }
+    remove(kFilename);
+
+    // The second run of a problem starts from the solutions of the first
+    SolutionStore warmStore(kFilename);
+    std::vector<Dim> dims(5, Sphere::bounds());
+    Objective<Sphere> ff;
+    PSO< Objective<Sphere> > first( 40, dims, 1, ff, 50 );
+    first.setWarmStart(&warmStore, "sphere", features(1.0));
+    first.iterate();
+    check(first.getNumSeeded() == 0 && warmStore.size() == 1, "first run stored");
+
+    PSO< Objective<Sphere> > second( 40, dims, 2, ff, 50 );
+    second.setWarmStart(&warmStore, "sphere", features(1.0));
+    second.iterate();
+    std::cout << "Seeded particles: " << second.getNumSeeded() << std::endl;
+    check(second.getNumSeeded() > 0 && warmStore.size() == 1, "second run seeded");
+    remove(kFilename);
+
+    if (gNumFailures != 0)
+    {
+        std::cout << "FAILED" << std::endl;
+        return 1;
+    }
+    std::cout << "PASSED" << std::endl;
+    return 0;
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * test_pso_streaming.cpp
+ *
+ * Writes a data set with ColumnarDataWriter and checks that the
+ * StreamingLikelihood of a Gaussian model gives the same log-likelihoods
+ * as GaussianLogLikelihood on the data held in memory, serially and on a
+ * thread pool, and that the subsampling schedule reads the expected
+ * fraction of the data and ends up using all of it.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "batch_objectives.h"
+#include "columnar_data.h"
+#include "streaming_likelihood.h"
+#include "swarm.h"
+#include "thread_pool.h"
+
+namespace
+{
+
+const size_t kNumRows = 100003;    // Not a whole number of blocks
+const size_t kBlockRows = 1024;
+const unsigned int kNumParticles = 20;
+
+unsigned int gNumFailures = 0;
+
+void check(const bool ok, const char* what)
+{
+    std::cout << what << ": " << (ok ? "ok" : "wrong") << std::endl;
+    if (!ok)
+    {
+        gNumFailures++;
+    }
+}
+
+double maxRelativeError(const std::vector<double>& a, const std::vector<double>& b)
+{
+    double error = 0.0;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        error = std::max(error, fabs(a[i] - b[i]) / fabs(b[i]));
+    }
+    return error;
+}
+
+}
+
+int main()
+{
+    // Column 0 is noise, column 1 the data fitted
+    const std::string filename = "test_pso_streaming.psd";
+    std::mt19937_64 generator(5);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    std::normal_distribution<double> normal(3.0, 2.0);
+    std::vector<double> noiseColumn(kNumRows);
+    std::vector<double> data(kNumRows);
+    for (size_t r = 0; r < kNumRows; r++)
+    {
+        noiseColumn[r] = noise(generator);
+        data[r] = normal(generator);
+    }
+    {
+        ColumnarDataWriter writer(filename, 2, kNumRows);
+        writer.write(0, 0, noiseColumn.data(), kNumRows);
+        writer.write(1, 0, data.data(), 50000);
+        writer.write(1, 50000, data.data() + 50000, kNumRows - 50000);
+        writer.close();
+    }
+    ColumnarData columns(filename);
+
+    // Particles are (mean, std) pairs around the truth
+    Swarm swarm(kNumParticles, 2);
+    GaussianLogLikelihood inMemory(data, 0.0);
+    std::vector<double> expected(kNumParticles);
+    for (unsigned int i = 0; i < kNumParticles; i++)
+    {
+        swarm.position(i)[0] = 2.0 + 0.1 * i;
+        swarm.position(i)[1] = 1.5 + 0.05 * i;
+        expected[i] = inMemory.value(swarm.position(i)[0], swarm.position(i)[1]);
+    }
+
+    StreamingOptions options;
+    options.blockRows = kBlockRows;
+    StreamingLikelihood<GaussianModel> serial(columns, GaussianModel(), std::vector<size_t>(1, 1), options);
+    std::vector<double> serialFitnesses(kNumParticles);
+    serial(swarm, &serialFitnesses);
+    check(maxRelativeError(serialFitnesses, expected) < 1e-12 && serial.getLastFraction() == 1.0,
+          "serial streaming matches the in-memory likelihood");
+
+    ThreadPool pool(3);
+    StreamingLikelihood<GaussianModel> parallel(columns, GaussianModel(), std::vector<size_t>(1, 1), options);
+    parallel.setThreadPool(&pool);
+    std::vector<double> parallelFitnesses(kNumParticles);
+    parallel(swarm, &parallelFitnesses);
+    check(parallelFitnesses == serialFitnesses, "pool gives the same sums as serial");
+
+    // Subsampled: an eighth of the blocks, doubling at each call until all
+    // are read, and again from the start after reset()
+    options.initialFraction = 1.0 / 8;
+    StreamingLikelihood<GaussianModel> subsampled(columns, GaussianModel(), std::vector<size_t>(1, 1), options);
+    subsampled.setThreadPool(&pool);
+    std::vector<double> fitnesses(kNumParticles);
+    const double fractions[] = { 1.0 / 8, 1.0 / 4, 1.0 / 2, 1.0, 1.0 };
+    bool scheduleOk = true;
+    bool estimatesOk = true;
+    for (unsigned int call = 0; call < 5; call++)
+    {
+        subsampled(swarm, &fitnesses);
+        scheduleOk = scheduleOk && fabs(subsampled.getLastFraction() - fractions[call]) < 0.01;
+        estimatesOk = estimatesOk && maxRelativeError(fitnesses, expected) < 0.05;
+    }
+    check(scheduleOk, "subsampled fractions 1/8, 1/4, 1/2, 1");
+    check(estimatesOk, "subsampled estimates within 5%");
+    check(fitnesses == serialFitnesses, "subsampling ends on the whole data set");
+
+    subsampled.reset();
+    subsampled(swarm, &fitnesses);
+    check(fabs(subsampled.getLastFraction() - 1.0 / 8) < 0.01, "reset() starts the schedule again");
+
+    remove(filename.c_str());
+    if (gNumFailures != 0)
+    {
+        std::cout << "FAILED" << std::endl;
+        return 1;
+    }
+    std::cout << "PASSED" << std::endl;
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * test_pso_surrogate.cpp
+ *
+ * Fills a Surrogate past its capacity, so that the oldest evaluations are
+ * replaced through the rank-one downdates and updates of the inverse, and
+ * checks its predictions against a surrogate refactorized exactly at every
+ * insert. Then checks that a PSO run screened by a surrogate makes fewer
+ * true evaluations than one without.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "objectives.h"
+#include "pso.h"
+#include "surrogate.h"
+
+namespace
+{
+
+const unsigned int kNumDims = 3;
+
+unsigned int gNumFailures = 0;
+
+void check(const bool ok, const char* what)
+{
+    std::cout << what << ": " << (ok ? "ok" : "wrong") << std::endl;
+    if (!ok)
+    {
+        gNumFailures++;
+    }
+}
+
+double smooth(const std::vector<double>& x)
+{
+    double sum = 0.0;
+    for (size_t d = 0; d < x.size(); d++)
+    {
+        sum += sin(x[d]) + 0.1 * x[d] * x[d];
+    }
+    return -sum;
+}
+
+}
+
+int main()
+{
+    std::vector<Dim> dims(kNumDims, Dim(-5, 5));
+    std::mt19937_64 generator(3);
+    std::uniform_real_distribution<double> uniform(-5.0, 5.0);
+
+    // Same evaluations into an incrementally updated surrogate and one
+    // refactorized at every insert
+    SurrogateOptions options;
+    options.capacity = 32;
+    options.minPoints = 8;
+    Surrogate incremental(dims, options);
+    options.rebuildInterval = 1;
+    Surrogate exact(dims, options);
+
+    std::vector<double> x(kNumDims);
+    const unsigned int numInserts = 200;
+    for (unsigned int n = 0; n < numInserts; n++)
+    {
+        for (unsigned int d = 0; d < kNumDims; d++)
+        {
+            x[d] = uniform(generator);
+        }
+        incremental.insert(x.data(), smooth(x));
+        exact.insert(x.data(), smooth(x));
+    }
+    check(incremental.size() == options.capacity && incremental.ready(), "archive full, oldest points replaced");
+
+    // The last point inserted is still in the archive: the model goes
+    // through it
+    double mean = 0.0;
+    double stddev = 0.0;
+    incremental.predict(x.data(), &mean, &stddev);
+    check(fabs(mean - smooth(x)) < 1e-3 * (1.0 + fabs(smooth(x))), "prediction at the newest point");
+
+    double meanError = 0.0;
+    double stddevError = 0.0;
+    for (unsigned int q = 0; q < 100; q++)
+    {
+        for (unsigned int d = 0; d < kNumDims; d++)
+        {
+            x[d] = uniform(generator);
+        }
+        double exactMean = 0.0;
+        double exactStddev = 0.0;
+        incremental.predict(x.data(), &mean, &stddev);
+        exact.predict(x.data(), &exactMean, &exactStddev);
+        meanError = std::max(meanError, fabs(mean - exactMean) / (1.0 + fabs(exactMean)));
+        stddevError = std::max(stddevError, fabs(stddev - exactStddev) / (1.0 + exactStddev));
+    }
+    std::cout << "Largest difference from the exact model: mean " << meanError
+              << ", standard deviation " << stddevError << std::endl;
+    check(meanError < 1e-8 && stddevError < 1e-8, "incremental inverse matches the exact one");
+
+    // Screening saves true evaluations
+    const unsigned int numParticles = 40;
+    const unsigned int numIterations = 100;
+    std::vector<Dim> sphereDims(5, Sphere::bounds());
+    Objective<Sphere> ff;
+    PSO< Objective<Sphere> > plain( numParticles, sphereDims, 1, ff, numIterations );
+    plain.iterate();
+
+    Surrogate surrogate(sphereDims);
+    PSO< Objective<Sphere> > screened( numParticles, sphereDims, 1, ff, numIterations );
+    screened.setSurrogate(&surrogate);
+    screened.iterate();
+
+    std::cout << "True evaluations: " << plain.getNumEvaluations() << " without a surrogate, "
+              << screened.getNumEvaluations() << " with one (" << surrogate.getNumScreenedOut()
+              << " screened out)" << std::endl;
+    check(screened.getNumEvaluations() < plain.getNumEvaluations() && surrogate.getNumScreenedOut() > 0,
+          "fewer true evaluations with the surrogate");
+
+    if (gNumFailures != 0)
+    {
+        std::cout << "FAILED" << std::endl;
+        return 1;
+    }
+    std::cout << "PASSED" << std::endl;
+    return 0;
+}
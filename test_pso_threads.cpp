@@ -0,0 +1,106 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * test_pso_threads.cpp
+ *
+ * Runs 64 independent optimizations from the loop of a 4 thread pool:
+ * half of them without a pool of their own, half with a smaller 2 thread
+ * pool. Each PSO picks its scratch space by its own pool's thread index,
+ * not the outer one, and every result must equal the same run made
+ * serially.
+ */
+
+#include <iostream>
+#include <vector>
+
+#include "objectives.h"
+#include "pso.h"
+#include "thread_pool.h"
+
+namespace
+{
+
+const unsigned int kNumRuns = 64;
+const unsigned int kNumParticles = 40;
+const unsigned int kNumDims = 30;
+const unsigned int kNumIterations = 50;
+
+double runOne(const unsigned int seed, ThreadPool* pool)
+{
+    std::vector<Dim> dims(kNumDims, Sphere::bounds());
+    Objective<Sphere> ff;
+    PSO< Objective<Sphere> > pso( kNumParticles, dims, seed, ff, kNumIterations );
+    pso.setThreadPool(pool);
+    pso.iterate();
+    return pso.getGBest().getFitness();
+}
+
+struct Runs
+{
+    std::vector<double>* fitnesses;
+
+    void operator()(const size_t begin, const size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            if (i % 2)
+            {
+                ThreadPool inner(2);
+                (*fitnesses)[i] = runOne(i, &inner);
+            }
+            else
+            {
+                (*fitnesses)[i] = runOne(i, 0);
+            }
+        }
+    }
+};
+
+}
+
+int main()
+{
+    std::vector<double> serial(kNumRuns);
+    for (unsigned int i = 0; i < kNumRuns; i++)
+    {
+        serial[i] = runOne(i, 0);
+    }
+
+    std::vector<double> nested(kNumRuns);
+    ThreadPool pool(4);
+    Runs runs = { &nested };
+    pool.parallelFor(kNumRuns, 1, runs);
+
+    unsigned int numDifferent = 0;
+    for (unsigned int i = 0; i < kNumRuns; i++)
+    {
+        if (nested[i] != serial[i])
+        {
+            numDifferent++;
+        }
+    }
+
+    std::cout << "Runs inside the pool different from serial: " << numDifferent
+              << " of " << kNumRuns << std::endl;
+    if (numDifferent != 0)
+    {
+        std::cout << "FAILED" << std::endl;
+        return 1;
+    }
+    std::cout << "PASSED" << std::endl;
+    return 0;
+}
@@ -0,0 +1,224 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+
+/*
+ * test_pso_topology.cpp
+ *
+ * Checks the neighbourhoods Topology builds and its local best sweep
+ * against brute force. Topology only exposes the local bests, so the
+ * neighbours of every particle are read back by giving one particle at a
+ * time the best fitness: it is the local best of exactly the particles
+ * that have it as a neighbour, and of itself.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "counter_rng.h"
+#include "topology.h"
+
+namespace
+{
+
+typedef std::vector< std::set<unsigned int> > Neighbourhoods;
+
+unsigned int gNumFailures = 0;
+
+void check(const bool ok, const char* what)
+{
+    std::cout << what << ": " << (ok ? "ok" : "wrong") << std::endl;
+    if (!ok)
+    {
+        gNumFailures++;
+    }
+}
+
+// i + offset, wrapped around a swarm of n
+unsigned int wrap(const unsigned int i, const int offset, const unsigned int n)
+{
+    const int m = static_cast<int>(n);
+    return ((static_cast<int>(i) + offset) % m + m) % m;
+}
+
+// Particle i and the particles it learns from, as topology.h describes them
+Neighbourhoods ring(const unsigned int n, const unsigned int k)
+{
+    Neighbourhoods expected(n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        for (int r = -static_cast<int>(k / 2); r <= static_cast<int>(k / 2); r++)
+        {
+            expected[i].insert(wrap(i, r, n));
+        }
+    }
+    return expected;
+}
+
+Neighbourhoods vonNeumann(const unsigned int n)
+{
+    const int cols = static_cast<int>(ceil(sqrt(1.0 * n)));
+    const int offsets[5] = { 0, -cols, cols, -1, 1 };
+    Neighbourhoods expected(n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        for (unsigned int o = 0; o < 5; o++)
+        {
+            expected[i].insert(wrap(i, offsets[o], n));
+        }
+    }
+    return expected;
+}
+
+Neighbourhoods random(const unsigned int n, const unsigned int k, const CounterRNG& rng,
+                      const uint32_t stream, const uint32_t epoch)
+{
+    Neighbourhoods expected(n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        expected[i].insert(i);
+        for (unsigned int j = 0; j < k; j++)
+        {
+            expected[i].insert(std::min<unsigned int>(rng.uniform(epoch, i, j, stream) * n, n - 1));
+        }
+    }
+    return expected;
+}
+
+// Neighbourhoods read back through localBests()
+Neighbourhoods probe(const Topology& topology, const unsigned int n)
+{
+    Neighbourhoods found(n);
+    std::vector<prob_t> fitness(n);
+    std::vector<unsigned int> best(n);
+    for (unsigned int j = 0; j < n; j++)
+    {
+        std::fill(fitness.begin(), fitness.end(), 0.0);
+        fitness[j] = 1.0;
+        topology.localBests(fitness.data(), best.data());
+        for (unsigned int i = 0; i < n; i++)
+        {
+            if (best[i] == j)
+            {
+                found[i].insert(j);
+            }
+        }
+    }
+    return found;
+}
+
+// localBests() against the best of each expected neighbourhood, on
+// distinct random fitnesses; with all fitnesses equal every particle is
+// its own local best
+bool sameLocalBests(const Topology& topology, const Neighbourhoods& expected, std::mt19937_64* generator)
+{
+    const unsigned int n = expected.size();
+    std::vector<prob_t> fitness(n);
+    std::vector<unsigned int> best(n);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    for (unsigned int trial = 0; trial < 20; trial++)
+    {
+        for (unsigned int i = 0; i < n; i++)
+        {
+            fitness[i] = uniform(*generator);
+        }
+        topology.localBests(fitness.data(), best.data());
+        for (unsigned int i = 0; i < n; i++)
+        {
+            unsigned int b = i;
+            for (std::set<unsigned int>::const_iterator j = expected[i].begin(); j != expected[i].end(); ++j)
+            {
+                if (fitness[*j] > fitness[b])
+                {
+                    b = *j;
+                }
+            }
+            if (best[i] != b)
+            {
+                return false;
+            }
+        }
+    }
+    std::fill(fitness.begin(), fitness.end(), 0.5);
+    topology.localBests(fitness.data(), best.data());
+    for (unsigned int i = 0; i < n; i++)
+    {
+        if (best[i] != i)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+int main()
+{
+    std::mt19937_64 generator(5);
+
+    // Small swarms wrap around more than once; 10 and 30 leave a short
+    // last row in the von Neumann grid
+    const unsigned int sizes[5] = { 3, 10, 16, 30, 49 };
+    bool ringOk = true;
+    bool vonNeumannOk = true;
+    bool randomOk = true;
+    bool sweepOk = true;
+    for (unsigned int s = 0; s < 5; s++)
+    {
+        const unsigned int n = sizes[s];
+        for (unsigned int k = 2; k <= 6; k += 2)
+        {
+            Topology topology(kTopologyRing, k);
+            topology.resize(n);
+            ringOk = ringOk && probe(topology, n) == ring(n, k);
+            sweepOk = sweepOk && sameLocalBests(topology, ring(n, k), &generator);
+        }
+
+        Topology grid(kTopologyVonNeumann);
+        grid.resize(n);
+        vonNeumannOk = vonNeumannOk && probe(grid, n) == vonNeumann(n);
+        sweepOk = sweepOk && sameLocalBests(grid, vonNeumann(n), &generator);
+
+        // Every epoch draws its own neighbours, the same ones every time
+        const CounterRNG rng(17);
+        Topology informants(kTopologyRandom, 3);
+        informants.resize(n);
+        for (uint32_t epoch = 0; epoch < 4; epoch++)
+        {
+            informants.rewire(rng, CounterRNG::kTopologyStream, epoch);
+            const Neighbourhoods expected = random(n, 3, rng, CounterRNG::kTopologyStream, epoch);
+            randomOk = randomOk && informants.getEpoch() == epoch && probe(informants, n) == expected;
+            sweepOk = sweepOk && sameLocalBests(informants, expected, &generator);
+        }
+    }
+    check(ringOk, "ring neighbours");
+    check(vonNeumannOk, "von Neumann neighbours");
+    check(randomOk, "random neighbours of each epoch");
+    check(sweepOk, "local best sweep");
+
+    if (gNumFailures != 0)
+    {
+        std::cout << "FAILED" << std::endl;
+        return 1;
+    }
+    std::cout << "PASSED" << std::endl;
+    return 0;
+}
@@ -0,0 +1,206 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * thread_pool.cpp
+ */
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+// The pool whose loop the current thread is running, and its index there
+thread_local const ThreadPool* tCurrentPool = 0;
+thread_local unsigned int tCurrentThread = 0;
+}
+
+unsigned int ThreadPool::currentThread(const ThreadPool* pool)
+{
+    return (pool && pool == tCurrentPool) ? tCurrentThread : 0;
+}
+
+ThreadPool::ThreadPool(const unsigned int numThreads)
+    : mNumThreads(numThreads), mFunction(0), mContext(0), mChunkSize(1),
+    mGeneration(0), mNumBusy(0), mStop(false)
+{
+    if (mNumThreads == 0)
+    {
+        mNumThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    mSlices = std::vector<Slice>(mNumThreads);
+
+    // Thread 0 is the caller of parallelFor
+    for (unsigned int t = 1; t < mNumThreads; t++)
+    {
+        mThreads.push_back( std::thread(&ThreadPool::workerLoop, this, t) );
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mStart.notify_all();
+    for (unsigned int t = 0; t < mThreads.size(); t++)
+    {
+        mThreads[t].join();
+    }
+}
+
+void ThreadPool::parallelFor(const size_t n, const size_t chunkSize, RangeFunction fn, void* context)
+{
+    if (n == 0)
+    {
+        return;
+    }
+
+    const ThreadPool* callerPool = tCurrentPool;
+    const unsigned int callerThread = tCurrentThread;
+
+    // Not worth waking anyone up
+    if (mNumThreads == 1 || n <= chunkSize)
+    {
+        tCurrentPool = this;
+        tCurrentThread = 0;
+        try
+        {
+            fn(context, 0, n);
+        }
+        catch (...)
+        {
+            tCurrentPool = callerPool;
+            tCurrentThread = callerThread;
+            throw;
+        }
+        tCurrentPool = callerPool;
+        tCurrentThread = callerThread;
+        return;
+    }
+
+    // Give every thread an equal contiguous slice
+    for (unsigned int t = 0; t < mNumThreads; t++)
+    {
+        mSlices[t].next.store( n * t / mNumThreads, std::memory_order_relaxed );
+        mSlices[t].end = n * (t + 1) / mNumThreads;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFunction = fn;
+        mContext = context;
+        mChunkSize = std::max<size_t>(1, chunkSize);
+        mError = std::exception_ptr();
+        mNumBusy = mNumThreads - 1;
+        mGeneration++;
+    }
+    mStart.notify_all();
+
+    try
+    {
+        runSlices(0);
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mError)
+        {
+            mError = std::current_exception();
+        }
+    }
+    tCurrentPool = callerPool;
+    tCurrentThread = callerThread;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (mNumBusy > 0)
+    {
+        mDone.wait(lock);
+    }
+    if (mError)
+    {
+        std::exception_ptr error = mError;
+        mError = std::exception_ptr();
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::runSlices(const unsigned int thread)
+{
+    tCurrentPool = this;
+    tCurrentThread = thread;
+
+    // Start with our own slice, then steal from the others in turn
+    for (unsigned int k = 0; k < mNumThreads; k++)
+    {
+        Slice& slice = mSlices[(thread + k) % mNumThreads];
+        while (true)
+        {
+            const size_t begin = slice.next.fetch_add(mChunkSize, std::memory_order_relaxed);
+            if (begin >= slice.end)
+            {
+                break;
+            }
+            mFunction(mContext, begin, std::min(begin + mChunkSize, slice.end));
+        }
+    }
+}
+
+void ThreadPool::workerLoop(const unsigned int thread)
+{
+    unsigned long generation = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            while (!mStop && mGeneration == generation)
+            {
+                mStart.wait(lock);
+            }
+            if (mStop)
+            {
+                return;
+            }
+            generation = mGeneration;
+        }
+
+        try
+        {
+            runSlices(thread);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!mError)
+            {
+                mError = std::current_exception();
+            }
+        }
+
+        bool last = false;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            last = (--mNumBusy == 0);
+        }
+        if (last)
+        {
+            mDone.notify_one();
+        }
+    }
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * thread_pool.h
+ */
+
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that run parallel loops. The range of a loop
+// is split into one contiguous slice per thread and each thread takes
+// chunks from the front of its own slice. A thread that runs out of work
+// steals chunks from the other slices, so uneven work is balanced without
+// any locking. The calling thread takes part in the loop as thread 0.
+//
+// Running a loop does not allocate memory.
+class ThreadPool
+{
+public:
+    // Called with [begin, end) for each chunk
+    typedef void (*RangeFunction)(void* context, size_t begin, size_t end);
+
+    // numThreads includes the calling thread. 0 means one per hardware thread.
+    explicit ThreadPool(const unsigned int numThreads = 0);
+
+    ~ThreadPool();
+
+    // Number of threads working on a loop, including the calling thread
+    unsigned int size() const
+    {
+        return mNumThreads;
+    }
+
+    // Index, in [0, size()), of the thread of pool running the current
+    // chunk. Lets a loop body pick per-thread scratch space sized for that
+    // pool. 0 outside of a loop of pool, including inside a loop of another
+    // pool and when pool is 0.
+    static unsigned int currentThread(const ThreadPool* pool);
+
+    // Run fn over [0, n) in chunks of at most chunkSize and wait for it to
+    // finish. An exception thrown by fn is rethrown here.
+    void parallelFor(const size_t n, const size_t chunkSize, RangeFunction fn, void* context);
+
+    // Same, for any callable with operator()(size_t begin, size_t end)
+    template<class Function>
+    void parallelFor(const size_t n, const size_t chunkSize, Function& f)
+    {
+        parallelFor(n, chunkSize, &callRange<Function>, &f);
+    }
+
+private:
+    // Prevent copying and assignment
+    ThreadPool(const ThreadPool&);
+    void operator=(const ThreadPool&);
+
+    template<class Function>
+    static void callRange(void* context, size_t begin, size_t end)
+    {
+        (*static_cast<Function*>(context))(begin, end);
+    }
+
+    // One slice of the loop range, on its own cache line so that threads
+    // taking chunks from different slices don't share lines.
+    struct alignas(64) Slice
+    {
+        std::atomic<size_t>     next;
+        size_t                  end;
+    };
+
+    void workerLoop(const unsigned int thread);
+    void runSlices(const unsigned int thread);
+
+    unsigned int                mNumThreads;
+    std::vector<std::thread>    mThreads;
+    std::vector<Slice>          mSlices;
+
+    // The loop being run
+    RangeFunction               mFunction;
+    void*                       mContext;
+    size_t                      mChunkSize;
+
+    std::mutex                  mMutex;
+    std::condition_variable     mStart;
+    std::condition_variable     mDone;
+    unsigned long               mGeneration;
+    unsigned int                mNumBusy;
+    bool                        mStop;
+    std::exception_ptr          mError;
+};
+
+#endif /* THREAD_POOL_H_ */
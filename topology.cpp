@@ -0,0 +1,130 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * topology.cpp
+ */
+#include "topology.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+Topology::Topology(const TopologyKind kind, const unsigned int k)
+    : mKind(kind), mK(k), mNumParticles(0), mEpoch(0)
+{
+    switch (mKind)
+    {
+    case kTopologyGlobal:
+        mK = 0;
+        break;
+    case kTopologyRing:
+        assert(k % 2 == 0);
+        break;
+    case kTopologyVonNeumann:
+        mK = 4;
+        break;
+    case kTopologyRandom:
+        break;
+    }
+}
+
+void Topology::resize(const size_t numParticles)
+{
+    mNumParticles = numParticles;
+    mNeighbours.resize(numParticles * mK);
+    const size_t n = numParticles;
+    unsigned int* out = mNeighbours.data();
+
+    switch (mKind)
+    {
+    case kTopologyGlobal:
+        break;
+
+    case kTopologyRing:
+        for (size_t i = 0; i < n; i++)
+        {
+            for (unsigned int r = 1; r <= mK / 2; r++)
+            {
+                *out++ = (i + n - r % n) % n;
+                *out++ = (i + r) % n;
+            }
+        }
+        break;
+
+    case kTopologyVonNeumann:
+    {
+        // Rows of about sqrt(N) particles; the last row may be short, in
+        // which case the neighbours simply wrap around the swarm
+        const size_t cols = std::max<size_t>(1, static_cast<size_t>(ceil(sqrt(1.0 * n))));
+        for (size_t i = 0; i < n; i++)
+        {
+            *out++ = (i + n - cols % n) % n;
+            *out++ = (i + cols) % n;
+            *out++ = (i + n - 1) % n;
+            *out++ = (i + 1) % n;
+        }
+        break;
+    }
+
+    case kTopologyRandom:
+        // Until the first rewire(), the particles on the right
+        for (size_t i = 0; i < n; i++)
+        {
+            for (unsigned int r = 1; r <= mK; r++)
+            {
+                *out++ = (i + r) % n;
+            }
+        }
+        break;
+    }
+}
+
+void Topology::rewire(const CounterRNG& rng, const uint32_t stream, const uint32_t epoch)
+{
+    mEpoch = epoch;
+    if (mKind != kTopologyRandom)
+    {
+        return;
+    }
+    for (size_t i = 0; i < mNumParticles; i++)
+    {
+        for (unsigned int j = 0; j < mK; j++)
+        {
+            const double u = rng.uniform(epoch, i, j, stream);
+            mNeighbours[i * mK + j] = std::min<size_t>(static_cast<size_t>(u * mNumParticles), mNumParticles - 1);
+        }
+    }
+}
+
+void Topology::localBests(const prob_t* pbestFitness, unsigned int* best) const
+{
+    assert(mKind != kTopologyGlobal);
+    const unsigned int* neighbours = mNeighbours.data();
+    for (size_t i = 0; i < mNumParticles; i++)
+    {
+        unsigned int b = i;
+        for (unsigned int j = 0; j < mK; j++)
+        {
+            const unsigned int other = *neighbours++;
+            if (pbestFitness[other] > pbestFitness[b])
+            {
+                b = other;
+            }
+        }
+        best[i] = b;
+    }
+}
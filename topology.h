@@ -0,0 +1,85 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * topology.h
+ */
+
+#ifndef TOPOLOGY_H_
+#define TOPOLOGY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "counter_rng.h"
+#include "dim.h"
+
+// Which particles a particle learns from
+enum TopologyKind
+{
+    kTopologyGlobal = 0,    // Everyone, through the global best (star)
+    kTopologyRing,          // The k/2 particles on each side, wrapping around
+    kTopologyVonNeumann,    // Up, down, left and right on a wrapped 2-D grid
+    kTopologyRandom         // k random informants, redrawn whenever the
+                            // global best fails to improve
+};
+
+// Neighbourhood structure of a swarm. Every particle has the same number
+// of neighbours, stored in one flat array, so finding all the local bests
+// is a single O(N*k) sweep over the personal best fitnesses.
+class Topology
+{
+public:
+    explicit Topology(const TopologyKind kind = kTopologyGlobal, const unsigned int k = 2);
+
+    TopologyKind getKind() const
+    {
+        return mKind;
+    }
+
+    bool isGlobal() const
+    {
+        return mKind == kTopologyGlobal;
+    }
+
+    // Build the neighbourhoods of a swarm of numParticles
+    void resize(const size_t numParticles);
+
+    // Number of times the random topology was redrawn
+    uint32_t getEpoch() const
+    {
+        return mEpoch;
+    }
+
+    // Draw the random neighbourhoods of an epoch. The neighbours are a
+    // function of the epoch and the stream, so a run restored from a
+    // checkpoint gets the same ones back.
+    void rewire(const CounterRNG& rng, const uint32_t stream, const uint32_t epoch);
+
+    // best[i] = index of the best personal best among particle i and its
+    // neighbours
+    void localBests(const prob_t* pbestFitness, unsigned int* best) const;
+
+private:
+    TopologyKind                mKind;
+    unsigned int                mK;
+    size_t                      mNumParticles;
+    uint32_t                    mEpoch;
+    std::vector<unsigned int>   mNeighbours;    // numParticles x mK
+};
+
+#endif /* TOPOLOGY_H_ */
@@ -0,0 +1,302 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * trajectory.cpp
+ */
+#include "trajectory.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#include <zlib.h>
+
+TrajectoryOptions::TrajectoryOptions()
+    : decimation(1), gbestOnly(false), compress(false), compressionLevel(0),
+    chunkBytes(4 << 20), numBuffers(4)
+{
+}
+
+TrajectoryWriter::TrajectoryWriter(const std::string& filename, const std::vector<Dim>& dims,
+                                   const unsigned int numParticles, const TrajectoryOptions& options)
+    : mOptions(options), mNumDims(dims.size()), mNumRows(options.gbestOnly ? 1 : numParticles),
+    mNumFrames(0), mFile(0), mOffset(0), mFailed(false), mQueueHead(0), mQueueCount(0),
+    mCurrent(-1), mDeflate(0), mClosing(false)
+{
+    assert(mOptions.decimation > 0);
+    assert(mOptions.numBuffers > 0);
+
+    mFrameBytes = 2 * sizeof(uint64_t) + mNumRows * (mNumDims + 1) * sizeof(double);
+    mFramesPerChunk = std::max<size_t>(1, mOptions.chunkBytes / mFrameBytes);
+
+    mFile = fopen(filename.c_str(), "wb");
+    if (!mFile)
+    {
+        throw std::runtime_error("TrajectoryWriter: can't create " + filename);
+    }
+
+    TrajectoryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kTrajectoryMagic, sizeof(header.magic));
+    header.version = kTrajectoryVersion;
+    header.flags = kTrajectoryFitnesses | (mOptions.compress ? kTrajectoryCompressed : 0) |
+        (mOptions.gbestOnly ? kTrajectoryGBestOnly : 0);
+    header.numDims = mNumDims;
+    header.numRows = mNumRows;
+    header.numParticles = numParticles;
+    header.decimation = mOptions.decimation;
+    header.framesPerChunk = mFramesPerChunk;
+    write(&header, sizeof(header));
+
+    std::vector<double> bounds(2 * mNumDims);
+    for (size_t d = 0; d < mNumDims; d++)
+    {
+        bounds[d] = dims[d].min();
+        bounds[mNumDims + d] = dims[d].max();
+    }
+    write(bounds.data(), bounds.size() * sizeof(double));
+
+    const size_t chunkBytes = mFramesPerChunk * mFrameBytes;
+    mChunks.resize(mOptions.numBuffers);
+    for (unsigned int i = 0; i < mOptions.numBuffers; i++)
+    {
+        mChunks[i].data.resize(chunkBytes);
+        mChunks[i].numFrames = 0;
+        mFree.push_back(i);
+    }
+    mQueue.resize(mOptions.numBuffers);
+    if (mOptions.compress)
+    {
+        z_stream* stream = new z_stream;
+        memset(stream, 0, sizeof(*stream));
+        const int level = mOptions.compressionLevel > 0 ? mOptions.compressionLevel : Z_BEST_SPEED;
+        const int strategy = mOptions.compressionLevel > 0 ? Z_DEFAULT_STRATEGY : Z_HUFFMAN_ONLY;
+        if (deflateInit2(stream, level, Z_DEFLATED, 15, 8, strategy) != Z_OK)
+        {
+            delete stream;
+            fclose(mFile);
+            throw std::runtime_error("TrajectoryWriter: can't initialize zlib");
+        }
+        mDeflate = stream;
+        mShuffled.resize(chunkBytes);
+        mCompressed.resize(deflateBound(stream, chunkBytes));
+    }
+
+    mThread = std::thread(&TrajectoryWriter::run, this);
+}
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+    try
+    {
+        close();
+    }
+    catch (const std::exception&)
+    {
+    }
+}
+
+template<class T>
+void TrajectoryWriter::record(const unsigned int iteration, const BasicSwarm<T>& swarm)
+{
+    assert(mFile);
+    assert(swarm.numDims() == mNumDims);
+    assert(mOptions.gbestOnly || swarm.size() == mNumRows);
+    if (!wants(iteration))
+    {
+        return;
+    }
+
+    if (mCurrent < 0)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (mFree.empty())
+        {
+            mChunkFree.wait(lock);
+        }
+        mCurrent = mFree.back();
+        mFree.pop_back();
+        mChunks[mCurrent].firstIteration = iteration;
+        mChunks[mCurrent].numFrames = 0;
+    }
+
+    Chunk& chunk = mChunks[mCurrent];
+    char* frame = chunk.data.data() + chunk.numFrames * mFrameBytes;
+    const uint64_t it = iteration;
+    const double gbestFitness = swarm.gbest().getPBestFitness();
+    memcpy(frame, &it, sizeof(it));
+    memcpy(frame + sizeof(uint64_t), &gbestFitness, sizeof(gbestFitness));
+
+    double* rows = reinterpret_cast<double*>(frame + 2 * sizeof(uint64_t));
+    double* fitnesses = rows + mNumRows * mNumDims;
+    if (mOptions.gbestOnly)
+    {
+        std::copy(swarm.gbestPosition(), swarm.gbestPosition() + mNumDims, rows);
+        fitnesses[0] = gbestFitness;
+    }
+    else
+    {
+        for (size_t i = 0; i < mNumRows; i++)
+        {
+            std::copy(swarm.position(i), swarm.position(i) + mNumDims, rows + i * mNumDims);
+        }
+        memcpy(fitnesses, swarm.fitnesses(), mNumRows * sizeof(double));
+    }
+
+    mNumFrames++;
+    if (++chunk.numFrames == mFramesPerChunk)
+    {
+        submit();
+    }
+}
+
+template void TrajectoryWriter::record(const unsigned int, const Swarm&);
+template void TrajectoryWriter::record(const unsigned int, const FloatSwarm&);
+
+void TrajectoryWriter::submit()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mQueue[(mQueueHead + mQueueCount) % mQueue.size()] = mCurrent;
+    mQueueCount++;
+    mCurrent = -1;
+    mChunkQueued.notify_one();
+}
+
+void TrajectoryWriter::close()
+{
+    if (!mFile)
+    {
+        return;
+    }
+
+    if (mCurrent >= 0)
+    {
+        submit();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mClosing = true;
+        mChunkQueued.notify_one();
+    }
+    mThread.join();
+
+    if (mDeflate)
+    {
+        deflateEnd(static_cast<z_stream*>(mDeflate));
+        delete static_cast<z_stream*>(mDeflate);
+        mDeflate = 0;
+    }
+
+    if (!mChunkOffsets.empty())
+    {
+        write(mChunkOffsets.data(), mChunkOffsets.size() * sizeof(uint64_t));
+    }
+    TrajectoryFooter footer;
+    footer.numChunks = mChunkOffsets.size();
+    footer.numFrames = mNumFrames;
+    memcpy(footer.magic, kTrajectoryIndexMagic, sizeof(footer.magic));
+    write(&footer, sizeof(footer));
+
+    const bool failed = (fclose(mFile) != 0) || mFailed;
+    mFile = 0;
+    if (failed)
+    {
+        throw std::runtime_error("TrajectoryWriter: write failed");
+    }
+}
+
+// Writer thread: write the queued chunks in order until closed
+void TrajectoryWriter::run()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;)
+    {
+        while (mQueueCount == 0 && !mClosing)
+        {
+            mChunkQueued.wait(lock);
+        }
+        if (mQueueCount == 0)
+        {
+            return;
+        }
+
+        const int i = mQueue[mQueueHead];
+        mQueueHead = (mQueueHead + 1) % mQueue.size();
+        mQueueCount--;
+
+        lock.unlock();
+        writeChunk(mChunks[i]);
+        lock.lock();
+
+        mFree.push_back(i);
+        mChunkFree.notify_one();
+    }
+}
+
+void TrajectoryWriter::writeChunk(const Chunk& chunk)
+{
+    TrajectoryChunkHeader header;
+    memset(&header, 0, sizeof(header));
+    header.firstIteration = chunk.firstIteration;
+    header.numFrames = chunk.numFrames;
+    header.rawBytes = chunk.numFrames * mFrameBytes;
+
+    const char* data = chunk.data.data();
+    header.storedBytes = header.rawBytes;
+    if (mOptions.compress)
+    {
+        // Group the bytes by significance: the exponent bytes of nearby
+        // values are mostly equal, which zlib picks up
+        const size_t numWords = header.rawBytes / sizeof(double);
+        for (size_t k = 0; k < sizeof(double); k++)
+        {
+            char* out = mShuffled.data() + k * numWords;
+            for (size_t w = 0; w < numWords; w++)
+            {
+                out[w] = data[w * sizeof(double) + k];
+            }
+        }
+
+        z_stream* stream = static_cast<z_stream*>(mDeflate);
+        deflateReset(stream);
+        stream->next_in = reinterpret_cast<Bytef*>(mShuffled.data());
+        stream->avail_in = header.rawBytes;
+        stream->next_out = reinterpret_cast<Bytef*>(mCompressed.data());
+        stream->avail_out = mCompressed.size();
+        if (deflate(stream, Z_FINISH) != Z_STREAM_END)
+        {
+            mFailed = true;
+            return;
+        }
+        data = mCompressed.data();
+        header.storedBytes = stream->total_out;
+    }
+
+    mChunkOffsets.push_back(mOffset);
+    write(&header, sizeof(header));
+    write(data, header.storedBytes);
+}
+
+void TrajectoryWriter::write(const void* data, const size_t size)
+{
+    if (fwrite(data, 1, size, mFile) != size)
+    {
+        mFailed = true;
+    }
+    mOffset += size;
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * trajectory.h
+ */
+
+#ifndef TRAJECTORY_H_
+#define TRAJECTORY_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dim.h"
+#include "swarm.h"
+#include "trajectory_format.h"
+
+struct TrajectoryOptions
+{
+    TrajectoryOptions();
+
+    unsigned int    decimation;         // Record every Nth iteration
+    bool            gbestOnly;          // Record the global best rather than the swarm
+    bool            compress;           // Off by default: positions compress poorly
+    int             compressionLevel;   // zlib level 1 to 9, or 0 for Huffman coding
+                                        // only (fastest, and as small on positions)
+    size_t          chunkBytes;         // Target size of a chunk before compression
+    unsigned int    numBuffers;         // Chunks queued before record() has to wait
+};
+
+// Writes a trajectory file from a background thread. record() only copies
+// the positions into one of a few preallocated chunk buffers; full chunks
+// are compressed and written by the writer thread. If the writer falls
+// behind by numBuffers chunks, record() waits for it, which bounds the
+// memory used.
+class TrajectoryWriter
+{
+public:
+    // Throws std::runtime_error if the file can't be created
+    TrajectoryWriter(const std::string& filename, const std::vector<Dim>& dims,
+                     const unsigned int numParticles, const TrajectoryOptions& options = TrajectoryOptions());
+    ~TrajectoryWriter();
+
+    // Whether record() keeps this iteration
+    bool wants(const unsigned int iteration) const
+    {
+        return iteration % mOptions.decimation == 0;
+    }
+
+    // Record the positions, fitnesses and global best of an iteration.
+    // Doesn't allocate memory. Float positions are widened to double, the
+    // type of the file. Instantiated for Swarm and FloatSwarm.
+    template<class T>
+    void record(const unsigned int iteration, const BasicSwarm<T>& swarm);
+
+    // Write the remaining frames and the index and close the file. Throws
+    // std::runtime_error if anything couldn't be written.
+    void close();
+
+    unsigned long getNumFrames() const
+    {
+        return mNumFrames;
+    }
+
+private:
+    TrajectoryWriter(const TrajectoryWriter&);
+    void operator=(const TrajectoryWriter&);
+
+    struct Chunk
+    {
+        std::vector<char>   data;
+        uint64_t            firstIteration;
+        uint32_t            numFrames;
+    };
+
+    void submit();
+    void run();
+    void writeChunk(const Chunk& chunk);
+    void write(const void* data, const size_t size);
+
+    TrajectoryOptions       mOptions;
+    size_t                  mNumDims;
+    size_t                  mNumRows;
+    size_t                  mFrameBytes;
+    unsigned int            mFramesPerChunk;
+    unsigned long           mNumFrames;
+
+    FILE*                   mFile;
+    uint64_t                mOffset;
+    std::vector<uint64_t>   mChunkOffsets;
+    bool                    mFailed;
+
+    // mFree holds the chunks that are free to fill and mQueue (a ring
+    // buffer) the full ones, in order. mCurrent is the chunk record() is
+    // filling (-1 if none).
+    std::vector<Chunk>      mChunks;
+    std::vector<int>        mFree;
+    std::vector<int>        mQueue;
+    size_t                  mQueueHead;
+    size_t                  mQueueCount;
+    int                     mCurrent;
+
+    // Writer thread buffers
+    void*                   mDeflate;
+    std::vector<char>       mShuffled;
+    std::vector<char>       mCompressed;
+
+    std::mutex              mMutex;
+    std::condition_variable mChunkFree;
+    std::condition_variable mChunkQueued;
+    bool                    mClosing;
+    std::thread             mThread;
+};
+
+#endif /* TRAJECTORY_H_ */
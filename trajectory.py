@@ -0,0 +1,114 @@
+# Copyright 2014 Marc Normandin
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+
+# ctypes binding of TrajectoryReader (trajectory_reader.h), for reading the
+# trajectory files written by TrajectoryWriter. Needs the shared library
+# built from trajectory_capi.cpp, looked up next to this file or in
+# $PSO_TRAJECTORY_LIB:
+#
+#   g++ -O2 -shared -fPIC -o libpsotrajectory.so trajectory_reader.cpp trajectory_capi.cpp -lz
+
+import ctypes
+import os
+import numpy as np
+
+_libPath = os.environ.get('PSO_TRAJECTORY_LIB',
+	os.path.join(os.path.dirname(os.path.abspath(__file__)), 'libpsotrajectory.so'))
+_lib = ctypes.CDLL(_libPath)
+
+_double_p = np.ctypeslib.ndpointer(dtype=np.float64, flags='C_CONTIGUOUS')
+_uint64_p = np.ctypeslib.ndpointer(dtype=np.uint64, flags='C_CONTIGUOUS')
+
+_lib.pso_trajectory_error.restype = ctypes.c_char_p
+_lib.pso_trajectory_open.restype = ctypes.c_void_p
+_lib.pso_trajectory_open.argtypes = [ctypes.c_char_p]
+_lib.pso_trajectory_close.argtypes = [ctypes.c_void_p]
+_lib.pso_trajectory_info.argtypes = [ctypes.c_void_p, _uint64_p]
+_lib.pso_trajectory_bounds.argtypes = [ctypes.c_void_p, _double_p, _double_p]
+_lib.pso_trajectory_frame.argtypes = [ctypes.c_void_p, ctypes.c_uint64, _uint64_p, _double_p, _double_p, _double_p]
+_lib.pso_trajectory_find_iteration.restype = ctypes.c_uint64
+_lib.pso_trajectory_find_iteration.argtypes = [ctypes.c_void_p, ctypes.c_uint64]
+_lib.pso_trajectory_iterations.argtypes = [ctypes.c_void_p, _uint64_p]
+for _name in ['gbest_fitnesses', 'diameters', 'variances']:
+	getattr(_lib, 'pso_trajectory_' + _name).argtypes = [ctypes.c_void_p, _double_p]
+
+COMPRESSED = 1
+GBEST_ONLY = 2
+FITNESSES = 4
+
+def _check(status):
+	if status != 0:
+		raise IOError(_lib.pso_trajectory_error().decode())
+
+class Trajectory(object):
+	"""Memory-mapped trajectory file. Frames are read on demand."""
+
+	def __init__(self, fn):
+		self._handle = _lib.pso_trajectory_open(fn.encode())
+		if not self._handle:
+			raise IOError(_lib.pso_trajectory_error().decode())
+		info = np.zeros(6, dtype=np.uint64)
+		_lib.pso_trajectory_info(self._handle, info)
+		(self.numDims, self.numRows, self.numParticles, self.numFrames, self.decimation, self.flags) = [int(v) for v in info]
+		self.lower = np.zeros(self.numDims)
+		self.upper = np.zeros(self.numDims)
+		_lib.pso_trajectory_bounds(self._handle, self.lower, self.upper)
+
+	def close(self):
+		if self._handle:
+			_lib.pso_trajectory_close(self._handle)
+			self._handle = None
+
+	def __del__(self):
+		self.close()
+
+	def __len__(self):
+		return self.numFrames
+
+	def frame(self, i):
+		"""(iteration, gbest fitness, numRows x numDims positions, numRows fitnesses or None) of frame i"""
+		iteration = np.zeros(1, dtype=np.uint64)
+		gbestFitness = np.zeros(1)
+		positions = np.zeros((self.numRows, self.numDims))
+		fitnesses = np.zeros(self.numRows)
+		_check(_lib.pso_trajectory_frame(self._handle, i, iteration, gbestFitness, positions, fitnesses))
+		return (int(iteration[0]), gbestFitness[0], positions, fitnesses if self.flags & FITNESSES else None)
+
+	def findIteration(self, iteration):
+		"""Frame that recorded this iteration, or None"""
+		f = _lib.pso_trajectory_find_iteration(self._handle, iteration)
+		return f if f < self.numFrames else None
+
+	def iterations(self):
+		out = np.zeros(self.numFrames, dtype=np.uint64)
+		_check(_lib.pso_trajectory_iterations(self._handle, out))
+		return out
+
+	def gbestFitnesses(self):
+		out = np.zeros(self.numFrames)
+		_check(_lib.pso_trajectory_gbest_fitnesses(self._handle, out))
+		return out
+
+	def diameters(self):
+		"""Diagonal of the bounding box of the particles, per frame"""
+		out = np.zeros(self.numFrames)
+		_check(_lib.pso_trajectory_diameters(self._handle, out))
+		return out
+
+	def variances(self):
+		"""numFrames x numDims variances of the positions"""
+		out = np.zeros((self.numFrames, self.numDims))
+		_check(_lib.pso_trajectory_variances(self._handle, out))
+		return out
@@ -0,0 +1,200 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * trajectory_capi.cpp
+ *
+ * C interface to TrajectoryReader, for the ctypes binding in
+ * trajectory.py. Build it as a shared library:
+ *
+ *   g++ -O2 -shared -fPIC -o libpsotrajectory.so trajectory_reader.cpp trajectory_capi.cpp -lz
+ *
+ * Functions returning int return 0 on success and -1 on error; the error
+ * message is then available from pso_trajectory_error().
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "trajectory_reader.h"
+
+namespace
+{
+
+std::string gError;
+
+int fail(const std::exception& e)
+{
+    gError = e.what();
+    return -1;
+}
+
+} // namespace
+
+extern "C"
+{
+
+const char* pso_trajectory_error()
+{
+    return gError.c_str();
+}
+
+// Returns 0 on error
+void* pso_trajectory_open(const char* filename)
+{
+    try
+    {
+        return new TrajectoryReader(filename);
+    }
+    catch (const std::exception& e)
+    {
+        fail(e);
+        return 0;
+    }
+}
+
+void pso_trajectory_close(void* handle)
+{
+    delete static_cast<TrajectoryReader*>(handle);
+}
+
+// numDims, numRows, numParticles, numFrames, decimation, flags
+void pso_trajectory_info(void* handle, uint64_t* info)
+{
+    TrajectoryReader* reader = static_cast<TrajectoryReader*>(handle);
+    info[0] = reader->numDims();
+    info[1] = reader->numRows();
+    info[2] = reader->numParticles();
+    info[3] = reader->numFrames();
+    info[4] = reader->decimation();
+    info[5] = reader->flags();
+}
+
+void pso_trajectory_bounds(void* handle, double* lower, double* upper)
+{
+    TrajectoryReader* reader = static_cast<TrajectoryReader*>(handle);
+    std::copy(reader->lower().begin(), reader->lower().end(), lower);
+    std::copy(reader->upper().begin(), reader->upper().end(), upper);
+}
+
+// Copies frame f. positions receives numRows x numDims values and
+// fitnesses (if the file has them) numRows values.
+int pso_trajectory_frame(void* handle, uint64_t f, uint64_t* iteration, double* gbestFitness,
+                         double* positions, double* fitnesses)
+{
+    try
+    {
+        TrajectoryReader* reader = static_cast<TrajectoryReader*>(handle);
+        const size_t numValues = reader->numRows() * reader->numDims();
+        *iteration = reader->iteration(f);
+        *gbestFitness = reader->gbestFitness(f);
+        memcpy(positions, reader->positions(f), numValues * sizeof(double));
+        if (reader->hasFitnesses())
+        {
+            memcpy(fitnesses, reader->fitnesses(f), reader->numRows() * sizeof(double));
+        }
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        return fail(e);
+    }
+}
+
+// Frame of an iteration, or numFrames if it wasn't recorded
+uint64_t pso_trajectory_find_iteration(void* handle, uint64_t iteration)
+{
+    try
+    {
+        return static_cast<TrajectoryReader*>(handle)->findIteration(iteration);
+    }
+    catch (const std::exception& e)
+    {
+        fail(e);
+        return static_cast<TrajectoryReader*>(handle)->numFrames();
+    }
+}
+
+// The iterations and the global best fitnesses of every frame
+int pso_trajectory_iterations(void* handle, uint64_t* out)
+{
+    try
+    {
+        TrajectoryReader* reader = static_cast<TrajectoryReader*>(handle);
+        for (size_t f = 0; f < reader->numFrames(); f++)
+        {
+            out[f] = reader->iteration(f);
+        }
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        return fail(e);
+    }
+}
+
+int pso_trajectory_gbest_fitnesses(void* handle, double* out)
+{
+    try
+    {
+        std::vector<double> values;
+        static_cast<TrajectoryReader*>(handle)->gbestFitnesses(&values);
+        std::copy(values.begin(), values.end(), out);
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        return fail(e);
+    }
+}
+
+// One value per frame
+int pso_trajectory_diameters(void* handle, double* out)
+{
+    try
+    {
+        std::vector<double> values;
+        static_cast<TrajectoryReader*>(handle)->diameters(&values);
+        std::copy(values.begin(), values.end(), out);
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        return fail(e);
+    }
+}
+
+// numFrames x numDims values
+int pso_trajectory_variances(void* handle, double* out)
+{
+    try
+    {
+        std::vector<double> values;
+        static_cast<TrajectoryReader*>(handle)->variances(&values);
+        std::copy(values.begin(), values.end(), out);
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        return fail(e);
+    }
+}
+
+} // extern "C"
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * trajectory_format.h
+ */
+
+#ifndef TRAJECTORY_FORMAT_H_
+#define TRAJECTORY_FORMAT_H_
+
+#include <cstdint>
+
+// Binary trajectory file. All values are in the byte order of the machine
+// that wrote the file.
+//
+//   TrajectoryHeader
+//   double lower[numDims], upper[numDims]      Search bounds
+//   Chunks, each a TrajectoryChunkHeader followed by storedBytes of frames
+//   uint64_t chunkOffsets[numChunks]           Index, written by close()
+//   TrajectoryFooter
+//
+// A frame is a uint64_t iteration, the double global best fitness,
+// numRows * numDims doubles of positions, one row after the other, and with
+// kTrajectoryFitnesses the numRows double fitnesses of the rows (the
+// lowest double for particles a surrogate screened out, which were not
+// evaluated). With
+// kTrajectoryCompressed the frames of a chunk are byte-shuffled (byte k of
+// every 8-byte word, then byte k+1, ...) and zlib-compressed as a whole.
+// A file without a footer (the writer crashed) can still be read by
+// walking the chunk headers.
+
+static const char kTrajectoryMagic[8] = { 'P', 'S', 'O', 'T', 'R', 'J', '0', '1' };
+static const char kTrajectoryIndexMagic[8] = { 'P', 'S', 'O', 'I', 'D', 'X', '0', '1' };
+static const uint32_t kTrajectoryVersion = 1;
+
+enum TrajectoryFlags
+{
+    kTrajectoryCompressed = 1,  // Shuffled and zlib-compressed chunks
+    kTrajectoryGBestOnly = 2,   // The only row of a frame is the global best
+    kTrajectoryFitnesses = 4    // Frames end with the fitness of each row
+};
+
+struct TrajectoryHeader
+{
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    flags;
+    uint32_t    numDims;
+    uint32_t    numRows;        // Rows per frame: the swarm size, or 1
+    uint32_t    numParticles;   // Swarm size
+    uint32_t    decimation;     // Every decimation-th iteration was recorded
+    uint32_t    framesPerChunk;
+    uint32_t    reserved;
+};
+
+struct TrajectoryChunkHeader
+{
+    uint64_t    firstIteration;
+    uint32_t    numFrames;
+    uint32_t    reserved;
+    uint64_t    rawBytes;       // Size of the frames
+    uint64_t    storedBytes;    // Size in the file
+};
+
+struct TrajectoryFooter
+{
+    uint64_t    numChunks;
+    uint64_t    numFrames;
+    char        magic[8];
+};
+
+#endif /* TRAJECTORY_FORMAT_H_ */
@@ -0,0 +1,341 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * trajectory_reader.cpp
+ */
+#include "trajectory_reader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+TrajectoryReader::TrajectoryReader(const std::string& filename)
+    : mFd(-1), mMap(0), mSize(0), mCachedChunk(std::numeric_limits<size_t>::max())
+{
+    mFd = open(filename.c_str(), O_RDONLY);
+    if (mFd < 0)
+    {
+        throw std::runtime_error("TrajectoryReader: can't open " + filename);
+    }
+    struct stat st;
+    if (fstat(mFd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(TrajectoryHeader))
+    {
+        close(mFd);
+        throw std::runtime_error("TrajectoryReader: not a trajectory file: " + filename);
+    }
+    mSize = st.st_size;
+    void* map = mmap(0, mSize, PROT_READ, MAP_SHARED, mFd, 0);
+    if (map == MAP_FAILED)
+    {
+        close(mFd);
+        throw std::runtime_error("TrajectoryReader: can't map " + filename);
+    }
+    mMap = static_cast<const char*>(map);
+
+    try
+    {
+        readHeader(filename);
+        readIndex();
+    }
+    catch (...)
+    {
+        unmap();
+        throw;
+    }
+}
+
+TrajectoryReader::~TrajectoryReader()
+{
+    unmap();
+}
+
+void TrajectoryReader::unmap()
+{
+    if (mMap)
+    {
+        munmap(const_cast<char*>(mMap), mSize);
+        mMap = 0;
+    }
+    if (mFd >= 0)
+    {
+        close(mFd);
+        mFd = -1;
+    }
+}
+
+void TrajectoryReader::readHeader(const std::string& filename)
+{
+    memcpy(&mHeader, mMap, sizeof(mHeader));
+    const size_t boundsBytes = 2 * mHeader.numDims * sizeof(double);
+    if (memcmp(mHeader.magic, kTrajectoryMagic, sizeof(mHeader.magic)) != 0 ||
+        mHeader.version != kTrajectoryVersion || sizeof(mHeader) + boundsBytes > mSize)
+    {
+        throw std::runtime_error("TrajectoryReader: not a trajectory file: " + filename);
+    }
+
+    const double* bounds = reinterpret_cast<const double*>(mMap + sizeof(mHeader));
+    mLower.assign(bounds, bounds + mHeader.numDims);
+    mUpper.assign(bounds + mHeader.numDims, bounds + 2 * mHeader.numDims);
+
+    mFrameBytes = 2 * sizeof(uint64_t) + mHeader.numRows * mHeader.numDims * sizeof(double);
+    if (hasFitnesses())
+    {
+        mFrameBytes += mHeader.numRows * sizeof(double);
+    }
+}
+
+// Find the chunks from the index at the end of the file, or by walking the
+// chunk headers if the writer didn't get to write it
+void TrajectoryReader::readIndex()
+{
+    const size_t begin = sizeof(mHeader) + 2 * mHeader.numDims * sizeof(double);
+    size_t end = mSize;
+    std::vector<uint64_t> offsets;
+
+    TrajectoryFooter footer;
+    if (mSize >= begin + sizeof(footer))
+    {
+        memcpy(&footer, mMap + mSize - sizeof(footer), sizeof(footer));
+        const size_t indexBytes = footer.numChunks * sizeof(uint64_t);
+        if (memcmp(footer.magic, kTrajectoryIndexMagic, sizeof(footer.magic)) == 0 &&
+            indexBytes <= mSize - begin - sizeof(footer))
+        {
+            end = mSize - sizeof(footer) - indexBytes;
+            // Chunks are packed, so the index and the chunk headers after
+            // compressed chunks are not aligned: copy them out
+            offsets.resize(footer.numChunks);
+            memcpy(offsets.data(), mMap + end, indexBytes);
+        }
+    }
+    if (end == mSize)
+    {
+        for (size_t offset = begin; offset + sizeof(TrajectoryChunkHeader) <= mSize; )
+        {
+            TrajectoryChunkHeader header;
+            memcpy(&header, mMap + offset, sizeof(header));
+            const size_t next = offset + sizeof(TrajectoryChunkHeader) + header.storedBytes;
+            if (next > mSize)
+            {
+                break; // Cut off in the middle of a chunk
+            }
+            offsets.push_back(offset);
+            offset = next;
+        }
+    }
+
+    mFirstFrame.push_back(0);
+    for (size_t c = 0; c < offsets.size(); c++)
+    {
+        ChunkInfo chunk;
+        if (offsets[c] < begin || offsets[c] + sizeof(TrajectoryChunkHeader) > end)
+        {
+            throw std::runtime_error("TrajectoryReader: corrupt chunk index");
+        }
+        memcpy(&chunk.header, mMap + offsets[c], sizeof(chunk.header));
+        chunk.data = mMap + offsets[c] + sizeof(TrajectoryChunkHeader);
+        if (chunk.data + chunk.header.storedBytes > mMap + end ||
+            chunk.header.rawBytes != chunk.header.numFrames * mFrameBytes)
+        {
+            throw std::runtime_error("TrajectoryReader: corrupt chunk index");
+        }
+        mChunks.push_back(chunk);
+        mFirstFrame.push_back(mFirstFrame.back() + chunk.header.numFrames);
+    }
+}
+
+// Frames of a chunk, inflated if need be
+const char* TrajectoryReader::chunkFrames(const size_t chunk)
+{
+    const ChunkInfo& info = mChunks[chunk];
+    if (!(mHeader.flags & kTrajectoryCompressed))
+    {
+        return info.data;
+    }
+    if (chunk == mCachedChunk)
+    {
+        return mFrames.data();
+    }
+
+    const size_t rawBytes = info.header.rawBytes;
+    mShuffled.resize(rawBytes);
+    mFrames.resize(rawBytes);
+    uLongf size = rawBytes;
+    if (uncompress(reinterpret_cast<Bytef*>(mShuffled.data()), &size,
+                   reinterpret_cast<const Bytef*>(info.data), info.header.storedBytes) != Z_OK ||
+        size != rawBytes)
+    {
+        throw std::runtime_error("TrajectoryReader: corrupt chunk");
+    }
+
+    // Undo the byte shuffle
+    const size_t numWords = rawBytes / sizeof(double);
+    for (size_t k = 0; k < sizeof(double); k++)
+    {
+        const char* in = mShuffled.data() + k * numWords;
+        for (size_t w = 0; w < numWords; w++)
+        {
+            mFrames[w * sizeof(double) + k] = in[w];
+        }
+    }
+    mCachedChunk = chunk;
+    return mFrames.data();
+}
+
+const char* TrajectoryReader::frame(const size_t frame)
+{
+    if (frame >= numFrames())
+    {
+        throw std::out_of_range("TrajectoryReader: no such frame");
+    }
+    const size_t chunk = std::upper_bound(mFirstFrame.begin(), mFirstFrame.end(), frame) - mFirstFrame.begin() - 1;
+    return chunkFrames(chunk) + (frame - mFirstFrame[chunk]) * mFrameBytes;
+}
+
+uint64_t TrajectoryReader::iteration(const size_t f)
+{
+    uint64_t it;
+    memcpy(&it, frame(f), sizeof(it));
+    return it;
+}
+
+double TrajectoryReader::gbestFitness(const size_t f)
+{
+    double fitness;
+    memcpy(&fitness, frame(f) + sizeof(uint64_t), sizeof(fitness));
+    return fitness;
+}
+
+const double* TrajectoryReader::positions(const size_t f)
+{
+    return reinterpret_cast<const double*>(frame(f) + 2 * sizeof(uint64_t));
+}
+
+const double* TrajectoryReader::fitnesses(const size_t f)
+{
+    if (!hasFitnesses())
+    {
+        return 0;
+    }
+    return positions(f) + numRows() * numDims();
+}
+
+size_t TrajectoryReader::findIteration(const uint64_t it)
+{
+    // Chunks and the frames in them are in iteration order
+    size_t lo = 0;
+    size_t hi = numFrames();
+    while (lo < hi)
+    {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (iteration(mid) < it)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return (lo < numFrames() && iteration(lo) == it) ? lo : numFrames();
+}
+
+void TrajectoryReader::gbestFitnesses(std::vector<double>* out)
+{
+    out->resize(numFrames());
+    for (size_t f = 0; f < numFrames(); f++)
+    {
+        (*out)[f] = gbestFitness(f);
+    }
+}
+
+void TrajectoryReader::diameters(std::vector<double>* out)
+{
+    const size_t numDims = this->numDims();
+    std::vector<double> low(numDims);
+    std::vector<double> high(numDims);
+    out->resize(numFrames());
+    for (size_t f = 0; f < numFrames(); f++)
+    {
+        const double* pos = positions(f);
+        std::copy(pos, pos + numDims, low.begin());
+        std::copy(pos, pos + numDims, high.begin());
+        for (size_t i = 1; i < numRows(); i++)
+        {
+            const double* row = pos + i * numDims;
+            for (size_t d = 0; d < numDims; d++)
+            {
+                low[d] = std::min(low[d], row[d]);
+                high[d] = std::max(high[d], row[d]);
+            }
+        }
+
+        double sum = 0.0;
+        for (size_t d = 0; d < numDims; d++)
+        {
+            sum += (high[d] - low[d]) * (high[d] - low[d]);
+        }
+        (*out)[f] = sqrt(sum);
+    }
+}
+
+void TrajectoryReader::variances(std::vector<double>* out)
+{
+    const size_t numDims = this->numDims();
+    const size_t n = numRows();
+    std::vector<double> mean(numDims);
+    out->resize(numFrames() * numDims);
+    for (size_t f = 0; f < numFrames(); f++)
+    {
+        // Two passes: the mean, then the squared deviations from it
+        const double* pos = positions(f);
+        std::fill(mean.begin(), mean.end(), 0.0);
+        for (size_t i = 0; i < n; i++)
+        {
+            for (size_t d = 0; d < numDims; d++)
+            {
+                mean[d] += pos[i * numDims + d];
+            }
+        }
+        for (size_t d = 0; d < numDims; d++)
+        {
+            mean[d] /= n;
+        }
+
+        double* var = out->data() + f * numDims;
+        std::fill(var, var + numDims, 0.0);
+        for (size_t i = 0; i < n; i++)
+        {
+            for (size_t d = 0; d < numDims; d++)
+            {
+                const double delta = pos[i * numDims + d] - mean[d];
+                var[d] += delta * delta;
+            }
+        }
+        for (size_t d = 0; d < numDims; d++)
+        {
+            var[d] /= n;
+        }
+    }
+}
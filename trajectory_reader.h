@@ -0,0 +1,140 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * trajectory_reader.h
+ */
+
+#ifndef TRAJECTORY_READER_H_
+#define TRAJECTORY_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "trajectory_format.h"
+
+// Reads a trajectory file written by TrajectoryWriter through a read-only
+// memory map, so only the frames that are looked at are paged in. Frames of
+// uncompressed files are used in place; compressed chunks are inflated one
+// at a time into an internal buffer. Not safe to use from several threads.
+class TrajectoryReader
+{
+public:
+    // Throws std::runtime_error if the file can't be mapped or isn't a
+    // trajectory file
+    explicit TrajectoryReader(const std::string& filename);
+    ~TrajectoryReader();
+
+    size_t numDims() const
+    {
+        return mHeader.numDims;
+    }
+
+    // Rows per frame: the number of particles, or 1 for the global best only
+    size_t numRows() const
+    {
+        return mHeader.numRows;
+    }
+
+    size_t numParticles() const
+    {
+        return mHeader.numParticles;
+    }
+
+    size_t numFrames() const
+    {
+        return mFirstFrame.back();
+    }
+
+    unsigned int decimation() const
+    {
+        return mHeader.decimation;
+    }
+
+    uint32_t flags() const
+    {
+        return mHeader.flags;
+    }
+
+    bool hasFitnesses() const
+    {
+        return (mHeader.flags & kTrajectoryFitnesses) != 0;
+    }
+
+    const std::vector<double>& lower() const
+    {
+        return mLower;
+    }
+
+    const std::vector<double>& upper() const
+    {
+        return mUpper;
+    }
+
+    // Random access to a frame. The pointers stay valid until a frame of
+    // another chunk is accessed.
+    uint64_t iteration(const size_t frame);
+    double gbestFitness(const size_t frame);
+    const double* positions(const size_t frame);   // numRows x numDims
+    const double* fitnesses(const size_t frame);   // numRows, 0 if not recorded
+
+    // Frame that recorded this iteration, or numFrames() if none did
+    size_t findIteration(const uint64_t iteration);
+
+    // Reductions over every frame, computed in a single pass over the file.
+    // Each fills one value per frame, or numDims values per frame for the
+    // variances.
+    void gbestFitnesses(std::vector<double>* out);
+    void diameters(std::vector<double>* out);      // Diagonal of the bounding box of the rows
+    void variances(std::vector<double>* out);      // Variance of each dimension over the rows
+
+private:
+    TrajectoryReader(const TrajectoryReader&);
+    void operator=(const TrajectoryReader&);
+
+    struct ChunkInfo
+    {
+        TrajectoryChunkHeader           header;  // Copied out, chunks are not aligned
+        const char*                     data;
+    };
+
+    void unmap();
+    void readHeader(const std::string& filename);
+    void readIndex();
+    const char* frame(const size_t frame);
+    const char* chunkFrames(const size_t chunk);
+
+    int                     mFd;
+    const char*             mMap;
+    size_t                  mSize;
+
+    TrajectoryHeader        mHeader;
+    std::vector<double>     mLower;
+    std::vector<double>     mUpper;
+    size_t                  mFrameBytes;
+
+    std::vector<ChunkInfo>  mChunks;
+    std::vector<size_t>     mFirstFrame;    // Index of the first frame of each chunk, then numFrames
+
+    // Inflated frames of chunk mCachedChunk (compressed files only)
+    size_t                  mCachedChunk;
+    std::vector<char>       mShuffled;
+    std::vector<char>       mFrames;
+};
+
+#endif /* TRAJECTORY_READER_H_ */
@@ -0,0 +1,373 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * update_kernel.cpp
+ */
+#include "update_kernel.h"
+
+#include <algorithm>
+#include <cassert>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && defined(__GNUC__)
+#define PSO_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+template<class T>
+static void updateKernelScalarT(const BasicUpdateArgs<T>& a)
+{
+    const T w = static_cast<T>(a.inertiaWeight);
+    const T c1 = static_cast<T>(a.c1);
+    const T c2 = static_cast<T>(a.c2);
+    for (size_t i = 0; i < a.n; i++)
+    {
+        const T x = a.pos[i];
+        T vel = w * a.vel[i];
+        vel += c1 * a.r1[i] * (a.pbest[i] - x);
+        vel += c2 * a.r2[i] * (a.guide[i] - x);
+        vel = (vel == T(0)) ? a.vel[i] + T(2) * a.r1[i] : vel;
+        vel = std::min(std::max(vel, -a.maxVel[i]), a.maxVel[i]);
+        a.vel[i] = vel;
+        a.pos[i] = std::min(std::max(x + vel, a.lower[i]), a.upper[i]);
+    }
+}
+
+void updateKernelScalar(const UpdateArgs& a)
+{
+    updateKernelScalarT(a);
+}
+
+void updateKernelScalar(const FloatUpdateArgs& a)
+{
+    updateKernelScalarT(a);
+}
+
+template<class T>
+static void countUpdateT(const BasicUpdateArgs<T>& a, const size_t numDims, UpdateCounts* counts)
+{
+    assert(numDims <= a.n);
+    const T w = static_cast<T>(a.inertiaWeight);
+    const T c1 = static_cast<T>(a.c1);
+    const T c2 = static_cast<T>(a.c2);
+    for (size_t i = 0; i < numDims; i++)
+    {
+        const T x = a.pos[i];
+        T vel = w * a.vel[i];
+        vel += c1 * a.r1[i] * (a.pbest[i] - x);
+        vel += c2 * a.r2[i] * (a.guide[i] - x);
+        if (vel == T(0))
+        {
+            counts->numKicks++;
+            vel = a.vel[i] + T(2) * a.r1[i];
+        }
+        if (vel < -a.maxVel[i] || vel > a.maxVel[i])
+        {
+            counts->numVelocityClamps++;
+            vel = std::min(std::max(vel, -a.maxVel[i]), a.maxVel[i]);
+        }
+        if (x + vel < a.lower[i] || x + vel > a.upper[i])
+        {
+            counts->numPositionClamps++;
+        }
+    }
+    counts->numCoordinates += numDims;
+}
+
+void countUpdate(const UpdateArgs& a, const size_t numDims, UpdateCounts* counts)
+{
+    countUpdateT(a, numDims, counts);
+}
+
+void countUpdate(const FloatUpdateArgs& a, const size_t numDims, UpdateCounts* counts)
+{
+    countUpdateT(a, numDims, counts);
+}
+
+#ifdef PSO_HAVE_X86
+
+static void updateKernelSSE2(const UpdateArgs& a)
+{
+    assert(a.n % 2 == 0);
+    const __m128d w = _mm_set1_pd(a.inertiaWeight);
+    const __m128d c1 = _mm_set1_pd(a.c1);
+    const __m128d c2 = _mm_set1_pd(a.c2);
+    const __m128d two = _mm_set1_pd(2.0);
+    const __m128d zero = _mm_setzero_pd();
+    for (size_t i = 0; i < a.n; i += 2)
+    {
+        const __m128d x = _mm_load_pd(a.pos + i);
+        const __m128d v0 = _mm_load_pd(a.vel + i);
+        const __m128d r1 = _mm_load_pd(a.r1 + i);
+        const __m128d vmax = _mm_load_pd(a.maxVel + i);
+
+        __m128d v = _mm_mul_pd(w, v0);
+        v = _mm_add_pd(v, _mm_mul_pd(_mm_mul_pd(c1, r1), _mm_sub_pd(_mm_load_pd(a.pbest + i), x)));
+        v = _mm_add_pd(v, _mm_mul_pd(_mm_mul_pd(c2, _mm_load_pd(a.r2 + i)), _mm_sub_pd(_mm_load_pd(a.guide + i), x)));
+
+        const __m128d kick = _mm_add_pd(v0, _mm_mul_pd(two, r1));
+        const __m128d isZero = _mm_cmpeq_pd(v, zero);
+        v = _mm_or_pd(_mm_and_pd(isZero, kick), _mm_andnot_pd(isZero, v));
+
+        v = _mm_min_pd(_mm_max_pd(v, _mm_sub_pd(zero, vmax)), vmax);
+        _mm_store_pd(a.vel + i, v);
+        _mm_store_pd(a.pos + i, _mm_min_pd(_mm_max_pd(_mm_add_pd(x, v), _mm_load_pd(a.lower + i)),
+                                           _mm_load_pd(a.upper + i)));
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void updateKernelAVX2(const UpdateArgs& a)
+{
+    assert(a.n % 4 == 0);
+    const __m256d w = _mm256_set1_pd(a.inertiaWeight);
+    const __m256d c1 = _mm256_set1_pd(a.c1);
+    const __m256d c2 = _mm256_set1_pd(a.c2);
+    const __m256d two = _mm256_set1_pd(2.0);
+    const __m256d zero = _mm256_setzero_pd();
+    for (size_t i = 0; i < a.n; i += 4)
+    {
+        const __m256d x = _mm256_load_pd(a.pos + i);
+        const __m256d v0 = _mm256_load_pd(a.vel + i);
+        const __m256d r1 = _mm256_load_pd(a.r1 + i);
+        const __m256d vmax = _mm256_load_pd(a.maxVel + i);
+
+        __m256d v = _mm256_mul_pd(w, v0);
+        v = _mm256_fmadd_pd(_mm256_mul_pd(c1, r1), _mm256_sub_pd(_mm256_load_pd(a.pbest + i), x), v);
+        v = _mm256_fmadd_pd(_mm256_mul_pd(c2, _mm256_load_pd(a.r2 + i)),
+                            _mm256_sub_pd(_mm256_load_pd(a.guide + i), x), v);
+
+        const __m256d kick = _mm256_fmadd_pd(two, r1, v0);
+        v = _mm256_blendv_pd(v, kick, _mm256_cmp_pd(v, zero, _CMP_EQ_OQ));
+
+        v = _mm256_min_pd(_mm256_max_pd(v, _mm256_sub_pd(zero, vmax)), vmax);
+        _mm256_store_pd(a.vel + i, v);
+        _mm256_store_pd(a.pos + i, _mm256_min_pd(_mm256_max_pd(_mm256_add_pd(x, v), _mm256_load_pd(a.lower + i)),
+                                                 _mm256_load_pd(a.upper + i)));
+    }
+}
+
+// GCC 12 takes the undefined pass-through operand of _mm512_max/min_pd for
+// an uninitialized read, though no lane is taken from it
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+__attribute__((target("avx512f")))
+static void updateKernelAVX512(const UpdateArgs& a)
+{
+    assert(a.n % 8 == 0);
+    const __m512d w = _mm512_set1_pd(a.inertiaWeight);
+    const __m512d c1 = _mm512_set1_pd(a.c1);
+    const __m512d c2 = _mm512_set1_pd(a.c2);
+    const __m512d two = _mm512_set1_pd(2.0);
+    const __m512d zero = _mm512_setzero_pd();
+    for (size_t i = 0; i < a.n; i += 8)
+    {
+        const __m512d x = _mm512_load_pd(a.pos + i);
+        const __m512d v0 = _mm512_load_pd(a.vel + i);
+        const __m512d r1 = _mm512_load_pd(a.r1 + i);
+        const __m512d vmax = _mm512_load_pd(a.maxVel + i);
+
+        __m512d v = _mm512_mul_pd(w, v0);
+        v = _mm512_fmadd_pd(_mm512_mul_pd(c1, r1), _mm512_sub_pd(_mm512_load_pd(a.pbest + i), x), v);
+        v = _mm512_fmadd_pd(_mm512_mul_pd(c2, _mm512_load_pd(a.r2 + i)),
+                            _mm512_sub_pd(_mm512_load_pd(a.guide + i), x), v);
+
+        const __mmask8 isZero = _mm512_cmp_pd_mask(v, zero, _CMP_EQ_OQ);
+        v = _mm512_mask_blend_pd(isZero, v, _mm512_fmadd_pd(two, r1, v0));
+
+        v = _mm512_min_pd(_mm512_max_pd(v, _mm512_sub_pd(zero, vmax)), vmax);
+        _mm512_store_pd(a.vel + i, v);
+        _mm512_store_pd(a.pos + i, _mm512_min_pd(_mm512_max_pd(_mm512_add_pd(x, v), _mm512_load_pd(a.lower + i)),
+                                                 _mm512_load_pd(a.upper + i)));
+    }
+}
+#pragma GCC diagnostic pop
+
+// The float kernels are the same as the double ones, with twice the lanes
+
+static void updateKernelSSE2(const FloatUpdateArgs& a)
+{
+    assert(a.n % 4 == 0);
+    const __m128 w = _mm_set1_ps(static_cast<float>(a.inertiaWeight));
+    const __m128 c1 = _mm_set1_ps(static_cast<float>(a.c1));
+    const __m128 c2 = _mm_set1_ps(static_cast<float>(a.c2));
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 zero = _mm_setzero_ps();
+    for (size_t i = 0; i < a.n; i += 4)
+    {
+        const __m128 x = _mm_load_ps(a.pos + i);
+        const __m128 v0 = _mm_load_ps(a.vel + i);
+        const __m128 r1 = _mm_load_ps(a.r1 + i);
+        const __m128 vmax = _mm_load_ps(a.maxVel + i);
+
+        __m128 v = _mm_mul_ps(w, v0);
+        v = _mm_add_ps(v, _mm_mul_ps(_mm_mul_ps(c1, r1), _mm_sub_ps(_mm_load_ps(a.pbest + i), x)));
+        v = _mm_add_ps(v, _mm_mul_ps(_mm_mul_ps(c2, _mm_load_ps(a.r2 + i)), _mm_sub_ps(_mm_load_ps(a.guide + i), x)));
+
+        const __m128 kick = _mm_add_ps(v0, _mm_mul_ps(two, r1));
+        const __m128 isZero = _mm_cmpeq_ps(v, zero);
+        v = _mm_or_ps(_mm_and_ps(isZero, kick), _mm_andnot_ps(isZero, v));
+
+        v = _mm_min_ps(_mm_max_ps(v, _mm_sub_ps(zero, vmax)), vmax);
+        _mm_store_ps(a.vel + i, v);
+        _mm_store_ps(a.pos + i, _mm_min_ps(_mm_max_ps(_mm_add_ps(x, v), _mm_load_ps(a.lower + i)),
+                                           _mm_load_ps(a.upper + i)));
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void updateKernelAVX2(const FloatUpdateArgs& a)
+{
+    assert(a.n % 8 == 0);
+    const __m256 w = _mm256_set1_ps(static_cast<float>(a.inertiaWeight));
+    const __m256 c1 = _mm256_set1_ps(static_cast<float>(a.c1));
+    const __m256 c2 = _mm256_set1_ps(static_cast<float>(a.c2));
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    for (size_t i = 0; i < a.n; i += 8)
+    {
+        const __m256 x = _mm256_load_ps(a.pos + i);
+        const __m256 v0 = _mm256_load_ps(a.vel + i);
+        const __m256 r1 = _mm256_load_ps(a.r1 + i);
+        const __m256 vmax = _mm256_load_ps(a.maxVel + i);
+
+        __m256 v = _mm256_mul_ps(w, v0);
+        v = _mm256_fmadd_ps(_mm256_mul_ps(c1, r1), _mm256_sub_ps(_mm256_load_ps(a.pbest + i), x), v);
+        v = _mm256_fmadd_ps(_mm256_mul_ps(c2, _mm256_load_ps(a.r2 + i)),
+                            _mm256_sub_ps(_mm256_load_ps(a.guide + i), x), v);
+
+        const __m256 kick = _mm256_fmadd_ps(two, r1, v0);
+        v = _mm256_blendv_ps(v, kick, _mm256_cmp_ps(v, zero, _CMP_EQ_OQ));
+
+        v = _mm256_min_ps(_mm256_max_ps(v, _mm256_sub_ps(zero, vmax)), vmax);
+        _mm256_store_ps(a.vel + i, v);
+        _mm256_store_ps(a.pos + i, _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(x, v), _mm256_load_ps(a.lower + i)),
+                                                 _mm256_load_ps(a.upper + i)));
+    }
+}
+
+// Same spurious GCC 12 warning as the double kernel
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+__attribute__((target("avx512f")))
+static void updateKernelAVX512(const FloatUpdateArgs& a)
+{
+    assert(a.n % 16 == 0);
+    const __m512 w = _mm512_set1_ps(static_cast<float>(a.inertiaWeight));
+    const __m512 c1 = _mm512_set1_ps(static_cast<float>(a.c1));
+    const __m512 c2 = _mm512_set1_ps(static_cast<float>(a.c2));
+    const __m512 two = _mm512_set1_ps(2.0f);
+    const __m512 zero = _mm512_setzero_ps();
+    for (size_t i = 0; i < a.n; i += 16)
+    {
+        const __m512 x = _mm512_load_ps(a.pos + i);
+        const __m512 v0 = _mm512_load_ps(a.vel + i);
+        const __m512 r1 = _mm512_load_ps(a.r1 + i);
+        const __m512 vmax = _mm512_load_ps(a.maxVel + i);
+
+        __m512 v = _mm512_mul_ps(w, v0);
+        v = _mm512_fmadd_ps(_mm512_mul_ps(c1, r1), _mm512_sub_ps(_mm512_load_ps(a.pbest + i), x), v);
+        v = _mm512_fmadd_ps(_mm512_mul_ps(c2, _mm512_load_ps(a.r2 + i)),
+                            _mm512_sub_ps(_mm512_load_ps(a.guide + i), x), v);
+
+        const __mmask16 isZero = _mm512_cmp_ps_mask(v, zero, _CMP_EQ_OQ);
+        v = _mm512_mask_blend_ps(isZero, v, _mm512_fmadd_ps(two, r1, v0));
+
+        v = _mm512_min_ps(_mm512_max_ps(v, _mm512_sub_ps(zero, vmax)), vmax);
+        _mm512_store_ps(a.vel + i, v);
+        _mm512_store_ps(a.pos + i, _mm512_min_ps(_mm512_max_ps(_mm512_add_ps(x, v), _mm512_load_ps(a.lower + i)),
+                                                 _mm512_load_ps(a.upper + i)));
+    }
+}
+#pragma GCC diagnostic pop
+
+#endif // PSO_HAVE_X86
+
+UpdateKernel selectUpdateKernel()
+{
+#ifdef PSO_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return updateKernelAVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+        return updateKernelAVX2;
+    }
+    return updateKernelSSE2;
+#else
+    return updateKernelScalar;
+#endif
+}
+
+const char* updateKernelName()
+{
+    const UpdateKernel kernel = selectUpdateKernel();
+#ifdef PSO_HAVE_X86
+    if (kernel == static_cast<UpdateKernel>(updateKernelAVX512))
+    {
+        return "avx512";
+    }
+    if (kernel == static_cast<UpdateKernel>(updateKernelAVX2))
+    {
+        return "avx2";
+    }
+    if (kernel == static_cast<UpdateKernel>(updateKernelSSE2))
+    {
+        return "sse2";
+    }
+#endif
+    return (kernel == static_cast<UpdateKernel>(updateKernelScalar)) ? "scalar" : "unknown";
+}
+
+FloatUpdateKernel selectFloatUpdateKernel()
+{
+#ifdef PSO_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return updateKernelAVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+        return updateKernelAVX2;
+    }
+    return updateKernelSSE2;
+#else
+    return updateKernelScalar;
+#endif
+}
+
+const char* floatUpdateKernelName()
+{
+    const FloatUpdateKernel kernel = selectFloatUpdateKernel();
+#ifdef PSO_HAVE_X86
+    if (kernel == static_cast<FloatUpdateKernel>(updateKernelAVX512))
+    {
+        return "avx512";
+    }
+    if (kernel == static_cast<FloatUpdateKernel>(updateKernelAVX2))
+    {
+        return "avx2";
+    }
+    if (kernel == static_cast<FloatUpdateKernel>(updateKernelSSE2))
+    {
+        return "sse2";
+    }
+#endif
+    return (kernel == static_cast<FloatUpdateKernel>(updateKernelScalar)) ? "scalar" : "unknown";
+}
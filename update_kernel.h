@@ -0,0 +1,130 @@
+/*
+ * Copyright 2014 Marc Normandin
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ */
+
+/*
+ * update_kernel.h
+ */
+
+#ifndef UPDATE_KERNEL_H_
+#define UPDATE_KERNEL_H_
+
+#include <cstddef>
+
+#include "dim.h"
+
+// Arguments of the velocity/position update of one particle (one row of a
+// Swarm). All arrays must be aligned to kSwarmAlignment and hold n values,
+// where n is the padded row stride. Padding lanes must have
+// lower = upper = maxVel = 0 so that they stay at zero. T is the scalar
+// type of the swarm; the coefficients are rounded to it by the kernel.
+template<class T>
+struct BasicUpdateArgs
+{
+    T*          pos;
+    T*          vel;
+    const T*    pbest;
+    const T*    guide;  // The best position the particle is attracted to (gbest)
+    const T*    r1;     // Uniform random numbers in [0,1) for the cognitive term
+    const T*    r2;     // Uniform random numbers in [0,1) for the social term
+    const T*    lower;
+    const T*    upper;
+    const T*    maxVel;
+    size_t      n;
+    double      c1;
+    double      c2;
+    double      inertiaWeight;
+};
+
+typedef BasicUpdateArgs<dim_t> UpdateArgs;
+typedef BasicUpdateArgs<float> FloatUpdateArgs;
+
+// v = w*v + c1*r1*(pbest - x) + c2*r2*(guide - x)
+// v = (v == 0) ? v_old + 2*r1 : v       (the "kick" of Particle::updatePosition)
+// v = clamp(v, -maxVel, maxVel)
+// x = clamp(x + v, lower, upper)
+//
+// v is only exactly zero when both attraction terms vanish, in which case r1
+// did not contribute and is reused for the kick instead of drawing a third
+// random number.
+typedef void (*UpdateKernel)(const UpdateArgs& args);
+typedef void (*FloatUpdateKernel)(const FloatUpdateArgs& args);
+
+// Portable implementation, also used as the reference for the SIMD versions.
+void updateKernelScalar(const UpdateArgs& args);
+void updateKernelScalar(const FloatUpdateArgs& args);
+
+// The widest implementation supported by the CPU we are running on
+// (AVX-512, AVX2 or SSE2), chosen once at runtime.
+UpdateKernel selectUpdateKernel();
+
+// Same for float rows, which fit twice as many lanes in each register
+FloatUpdateKernel selectFloatUpdateKernel();
+
+// Name of the implementation returned by selectUpdateKernel()
+const char* updateKernelName();
+
+// Name of the implementation returned by selectFloatUpdateKernel()
+const char* floatUpdateKernelName();
+
+// The kernel for rows of type T, for code templated on the scalar type
+template<class T>
+struct UpdateKernelFor;
+
+template<>
+struct UpdateKernelFor<double>
+{
+    typedef UpdateKernel Kernel;
+
+    static Kernel select()
+    {
+        return selectUpdateKernel();
+    }
+    static const char* name()
+    {
+        return updateKernelName();
+    }
+};
+
+template<>
+struct UpdateKernelFor<float>
+{
+    typedef FloatUpdateKernel Kernel;
+
+    static Kernel select()
+    {
+        return selectFloatUpdateKernel();
+    }
+    static const char* name()
+    {
+        return floatUpdateKernelName();
+    }
+};
+
+// What an update does to a row, for the instrumentation (instrument.h)
+struct UpdateCounts
+{
+    unsigned long   numCoordinates;
+    unsigned long   numKicks;           // Velocities replaced by the kick
+    unsigned long   numVelocityClamps;  // Velocities clamped to +-maxVel
+    unsigned long   numPositionClamps;  // Positions clamped to the bounds
+};
+
+// Add to counts what the update of the first numDims lanes of a row will
+// do. Must be called before the kernel, which it doesn't replace.
+void countUpdate(const UpdateArgs& args, const size_t numDims, UpdateCounts* counts);
+void countUpdate(const FloatUpdateArgs& args, const size_t numDims, UpdateCounts* counts);
+
+#endif /* UPDATE_KERNEL_H_ */